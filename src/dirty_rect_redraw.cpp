@@ -0,0 +1,357 @@
+//
+//  dirty_rect_redraw.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "dirty_rect_redraw.h"
+
+#include <cmath>
+
+#include "root.h"
+#include "renderer.h"
+#include "texture_mgr.h"
+#include "scene_mgr.h"
+#include "scene_actor.h"
+#include "transform_system.h"
+
+namespace ERI
+{
+	// filtering and anti-aliased edges may touch pixels just outside bound
+	static const float kRectMargin = 2.0f;
+
+	DirtyRectRedraw::DirtyRectRedraw() :
+		texture_(NULL),
+		frame_buffer_(0),
+		sprite_(NULL),
+		width_(0),
+		height_(0),
+		has_dirty_rect_(false),
+		is_full_dirty_(true),
+		is_buffer_unsupported_(false),
+		redraw_pixel_(0)
+	{
+	}
+
+	DirtyRectRedraw::~DirtyRectRedraw()
+	{
+		ReleaseBuffer();
+	}
+
+	void DirtyRectRedraw::SetActorDirty(SceneActor* actor, SceneLayer* layer)
+	{
+		if (is_full_dirty_)
+			return;
+
+		if (dirty_actors_.insert(actor).second)
+			AddActorRect(actor, layer);
+	}
+
+	void DirtyRectRedraw::RemoveActor(SceneActor* actor, SceneLayer* layer)
+	{
+		if (is_full_dirty_)
+			return;
+
+		// bound before change may be taken already
+		if (dirty_actors_.erase(actor) == 0)
+			AddActorRect(actor, layer);
+	}
+
+	void DirtyRectRedraw::Render(Renderer* renderer)
+	{
+		SceneMgr* scene_mgr = Root::Ins().scene_mgr();
+
+		if (is_buffer_unsupported_ || !CreateBuffer(renderer))
+		{
+			renderer->RenderStart();
+			scene_mgr->Render(renderer);
+			redraw_pixel_ = renderer->backing_width() * renderer->backing_height();
+			return;
+		}
+
+		// layer caches render into their own buffers, do them before binding this one
+		scene_mgr->transform_system()->Update();
+		scene_mgr->UpdateLayerCache(renderer);
+
+		CheckViewChange(renderer);
+
+		if (!is_full_dirty_)
+		{
+			for (std::set<SceneActor*>::iterator it = dirty_actors_.begin(); it != dirty_actors_.end(); ++it)
+			{
+				if ((*it)->layer())
+				{
+					(*it)->GetWorldTransform();
+					AddActorRect(*it, (*it)->layer());
+				}
+
+				if (is_full_dirty_)
+					break;
+			}
+		}
+
+		dirty_actors_.clear();
+
+		int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+
+		if (is_full_dirty_)
+		{
+			max_x = width_;
+			max_y = height_;
+		}
+		else if (has_dirty_rect_)
+		{
+			min_x = static_cast<int>(floorf(dirty_min_.x - kRectMargin));
+			min_y = static_cast<int>(floorf(dirty_min_.y - kRectMargin));
+			max_x = static_cast<int>(ceilf(dirty_max_.x + kRectMargin));
+			max_y = static_cast<int>(ceilf(dirty_max_.y + kRectMargin));
+
+			if (min_x < 0) min_x = 0;
+			if (min_y < 0) min_y = 0;
+			if (max_x > width_) max_x = width_;
+			if (max_y > height_) max_y = height_;
+		}
+
+		is_full_dirty_ = false;
+		has_dirty_rect_ = false;
+
+		redraw_pixel_ = 0;
+
+		if (max_x > min_x && max_y > min_y)
+		{
+			redraw_pixel_ = (max_x - min_x) * (max_y - min_y);
+
+			renderer->EnableRenderToBuffer(0, 0, width_, height_, frame_buffer_);
+			renderer->SetScissor(min_x, min_y, max_x - min_x, max_y - min_y);
+
+			// clear is limited by scissor too
+			renderer->RenderStart();
+			scene_mgr->Render(renderer);
+
+			renderer->SetScissor(0, 0, width_, height_);
+			renderer->RestoreRenderToBuffer();
+		}
+
+		// buffer covers whole screen, no clear needed
+		scene_mgr->ResetCurrentCam();
+		renderer->EnableBlend(false);
+		sprite_->Draw(renderer);
+	}
+
+	bool DirtyRectRedraw::CreateBuffer(Renderer* renderer)
+	{
+		int width = renderer->backing_width();
+		int height = renderer->backing_height();
+
+		if (frame_buffer_ && width == width_ && height == height_)
+			return true;
+
+		ReleaseBuffer();
+
+		if (!renderer->caps().is_support_non_power_of_2_texture)
+		{
+			LOGW("dirty rect redraw disabled, screen size texture is not supported");
+			is_buffer_unsupported_ = true;
+			return false;
+		}
+
+		frame_buffer_ = renderer->GenerateFrameBuffer();
+		if (0 == frame_buffer_)
+		{
+			LOGW("dirty rect redraw disabled, frame buffer is not supported");
+			is_buffer_unsupported_ = true;
+			return false;
+		}
+
+		width_ = width;
+		height_ = height;
+
+		char name[32];
+		sprintf(name, "dirty_rect_%p", this);
+		texture_ = Root::Ins().texture_mgr()->CreateTexture(name, width_, height_, NULL);
+
+		renderer->BindTextureToFrameBuffer(texture_->id, frame_buffer_);
+		renderer->BindDefaultFrameBuffer();
+
+		// frame buffer is bottom up
+		sprite_ = new SpriteActor(static_cast<float>(width_), static_cast<float>(height_));
+		sprite_->SetMaterial(texture_);
+		sprite_->SetTexScaleScroll(Vector2(1.0f, -1.0f), Vector2(0.0f, 1.0f));
+		sprite_->SetDepthTest(false);
+		sprite_->SetDepthWrite(false);
+
+		is_full_dirty_ = true;
+
+		return true;
+	}
+
+	void DirtyRectRedraw::ReleaseBuffer()
+	{
+		if (sprite_)
+		{
+			delete sprite_;
+			sprite_ = NULL;
+		}
+
+		if (frame_buffer_)
+		{
+			Root::Ins().renderer()->ReleaseFrameBuffer(frame_buffer_);
+			frame_buffer_ = 0;
+		}
+
+		if (texture_)
+		{
+			Root::Ins().texture_mgr()->ReleaseTexture(texture_);
+			texture_ = NULL;
+		}
+
+		width_ = height_ = 0;
+	}
+
+	void DirtyRectRedraw::CheckViewChange(Renderer* renderer)
+	{
+		if (bg_color_ != renderer->GetBgColor())
+		{
+			bg_color_ = renderer->GetBgColor();
+			is_full_dirty_ = true;
+		}
+
+		SceneMgr* scene_mgr = Root::Ins().scene_mgr();
+
+		int layer_num = scene_mgr->GetLayerNum();
+		if (static_cast<int>(layer_views_.size()) != layer_num)
+		{
+			layer_views_.resize(layer_num);
+			for (int i = 0; i < layer_num; ++i)
+			{
+				layer_views_[i].cam = NULL;
+			}
+			is_full_dirty_ = true;
+		}
+
+		for (int i = 0; i < layer_num; ++i)
+		{
+			CameraActor* cam = scene_mgr->GetLayerCam(i);
+			if (!cam) cam = scene_mgr->default_cam();
+
+			LayerView& view = layer_views_[i];
+
+			if (cam != view.cam)
+			{
+				view.cam = cam;
+				is_full_dirty_ = true;
+			}
+
+			if (cam)
+			{
+				const Matrix4& view_matrix = cam->GetViewMatrix();
+				const Matrix4& projection_matrix = cam->GetProjectionMatrix();
+
+				if (memcmp(view_matrix.m, view.view_matrix.m, sizeof(view_matrix.m)) != 0
+					|| memcmp(projection_matrix.m, view.projection_matrix.m, sizeof(projection_matrix.m)) != 0)
+				{
+					view.view_matrix = view_matrix;
+					view.projection_matrix = projection_matrix;
+					is_full_dirty_ = true;
+				}
+			}
+		}
+	}
+
+	void DirtyRectRedraw::AddActorRect(SceneActor* actor, SceneLayer* layer)
+	{
+		if (NULL == actor->bounding_sphere_)
+		{
+			is_full_dirty_ = true;
+			return;
+		}
+
+		// world transform not updated yet is the one last drawn
+		const Matrix4& world = actor->render_data_.world_model_matrix;
+
+		Vector3 center = world * actor->bounding_sphere_->center;
+
+		float max_scale_sq = 0.0f;
+		for (int col = 0; col < 3; ++col)
+		{
+			float scale_sq = world.m[col * 4] * world.m[col * 4]
+				+ world.m[col * 4 + 1] * world.m[col * 4 + 1]
+				+ world.m[col * 4 + 2] * world.m[col * 4 + 2];
+
+			if (scale_sq > max_scale_sq) max_scale_sq = scale_sq;
+		}
+
+		float radius = actor->bounding_sphere_->radius * sqrtf(max_scale_sq);
+
+		CameraActor* cam = layer->cam() ? layer->cam() : Root::Ins().scene_mgr()->default_cam();
+
+		Vector2 rect_min, rect_max;
+
+		if (NULL == cam)
+		{
+			// default view, origin at screen center in pixel
+			Vector2 half_size(width_ * 0.5f, height_ * 0.5f);
+
+			rect_min = Vector2(center.x - radius + half_size.x, center.y - radius + half_size.y);
+			rect_max = Vector2(center.x + radius + half_size.x, center.y + radius + half_size.y);
+		}
+		else
+		{
+			const Matrix4& projection = cam->GetProjectionMatrix();
+
+			Vector3 view_center = cam->GetViewMatrix() * center;
+
+			// near face of bounding cube projects to the largest area
+			float z = view_center.z + radius;
+
+			for (int i = 0; i < 4; ++i)
+			{
+				float x = view_center.x + ((i & 1) ? radius : -radius);
+				float y = view_center.y + ((i & 2) ? radius : -radius);
+
+				float clip_x = projection.Get(0, 0) * x + projection.Get(0, 1) * y + projection.Get(0, 2) * z + projection.Get(0, 3);
+				float clip_y = projection.Get(1, 0) * x + projection.Get(1, 1) * y + projection.Get(1, 2) * z + projection.Get(1, 3);
+				float clip_w = projection.Get(3, 0) * x + projection.Get(3, 1) * y + projection.Get(3, 2) * z + projection.Get(3, 3);
+
+				if (clip_w < 0.0001f)
+				{
+					is_full_dirty_ = true;
+					return;
+				}
+
+				Vector2 screen((clip_x / clip_w * 0.5f + 0.5f) * width_,
+							   (clip_y / clip_w * 0.5f + 0.5f) * height_);
+
+				if (0 == i)
+				{
+					rect_min = rect_max = screen;
+				}
+				else
+				{
+					if (screen.x < rect_min.x) rect_min.x = screen.x;
+					if (screen.y < rect_min.y) rect_min.y = screen.y;
+					if (screen.x > rect_max.x) rect_max.x = screen.x;
+					if (screen.y > rect_max.y) rect_max.y = screen.y;
+				}
+			}
+		}
+
+		if (!has_dirty_rect_)
+		{
+			dirty_min_ = rect_min;
+			dirty_max_ = rect_max;
+			has_dirty_rect_ = true;
+		}
+		else
+		{
+			if (rect_min.x < dirty_min_.x) dirty_min_.x = rect_min.x;
+			if (rect_min.y < dirty_min_.y) dirty_min_.y = rect_min.y;
+			if (rect_max.x > dirty_max_.x) dirty_max_.x = rect_max.x;
+			if (rect_max.y > dirty_max_.y) dirty_max_.y = rect_max.y;
+		}
+	}
+}
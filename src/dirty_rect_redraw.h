@@ -0,0 +1,84 @@
+//
+//  dirty_rect_redraw.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_DIRTY_RECT_REDRAW_H
+#define ERI_DIRTY_RECT_REDRAW_H
+
+#include <vector>
+#include <set>
+
+#include "math_helper.h"
+
+namespace ERI
+{
+	class SceneActor;
+	class SceneLayer;
+	class SpriteActor;
+	class CameraActor;
+	class Renderer;
+	struct Texture;
+
+	// Partial redraw for mostly static 2D scene.
+	// Scene is kept in an offscreen buffer between frames, only the bound of screen rects
+	// which changed actors covered before and after change is cleared and redrawn with scissor,
+	// then the buffer is drawn to screen.
+	//
+	// Actor bound comes from its bounding sphere, actors without one dirty the whole screen.
+	// Offscreen buffer has no depth buffer, so it suits 2D layers.
+
+	class DirtyRectRedraw
+	{
+	public:
+		DirtyRectRedraw();
+		~DirtyRectRedraw();
+
+		// take bound before change now, bound after change is taken at next render
+		void SetActorDirty(SceneActor* actor, SceneLayer* layer);
+		void RemoveActor(SceneActor* actor, SceneLayer* layer);
+
+		inline void SetFullDirty() { is_full_dirty_ = true; }
+
+		void Render(Renderer* renderer);
+
+		// pixels redrawn in last frame
+		inline int redraw_pixel() { return redraw_pixel_; }
+
+	private:
+		struct LayerView
+		{
+			CameraActor*	cam;
+			Matrix4			view_matrix;
+			Matrix4			projection_matrix;
+		};
+
+		bool CreateBuffer(Renderer* renderer);
+		void ReleaseBuffer();
+
+		void CheckViewChange(Renderer* renderer);
+		void AddActorRect(SceneActor* actor, SceneLayer* layer);
+
+		std::set<SceneActor*>	dirty_actors_;
+		std::vector<LayerView>	layer_views_;
+
+		const Texture*	texture_;
+		int				frame_buffer_;
+		SpriteActor*	sprite_;
+		int				width_, height_;
+
+		Vector2		dirty_min_, dirty_max_;
+		bool		has_dirty_rect_;
+		bool		is_full_dirty_;
+		bool		is_buffer_unsupported_;
+
+		Color		bg_color_;
+
+		int			redraw_pixel_;
+	};
+}
+
+#endif // ERI_DIRTY_RECT_REDRAW_H
@@ -0,0 +1,283 @@
+//
+//  dynamic_resolution.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "dynamic_resolution.h"
+
+#include "root.h"
+#include "renderer.h"
+#include "texture_mgr.h"
+#include "scene_mgr.h"
+#include "scene_actor.h"
+#include "transform_system.h"
+#include "sys_helper.h"
+
+namespace ERI
+{
+	static const float kFrameMsSmooth = 0.1f;
+	static const float kScaleStep = 0.05f;
+	static const float kScaleUpRatio = 0.85f; // of target frame time
+	static const int kStepFrameInterval = 8; // of frame time samples
+	static const int kSyncFrameInterval = 4;
+
+	DynamicResolution::DynamicResolution(int scaled_layer_num, float target_frame_ms) :
+		scaled_layer_num_(scaled_layer_num),
+		target_frame_ms_(target_frame_ms),
+		min_scale_(0.5f),
+		max_scale_(1.0f),
+		scale_(1.0f),
+		frame_ms_(0.0f),
+		busy_ms_(-1.0f),
+		last_gpu_frame_id_(0),
+		frame_since_sync_(0),
+		frame_since_step_(0),
+		is_fence_unsupported_(false),
+		texture_(NULL),
+		frame_buffer_(0),
+		sprite_(NULL),
+		width_(0),
+		height_(0),
+		scaled_width_(0),
+		scaled_height_(0),
+		is_buffer_unsupported_(false)
+	{
+	}
+
+	DynamicResolution::~DynamicResolution()
+	{
+		ReleaseBuffer();
+	}
+
+	void DynamicResolution::Render(Renderer* renderer)
+	{
+		UpdateScale(renderer);
+
+		void* fence = NULL;
+
+		// gpu timer measures every frame already
+		if (renderer->gpu_timer_stats().results.empty() && !is_fence_unsupported_ && ++frame_since_sync_ >= kSyncFrameInterval)
+		{
+			frame_since_sync_ = 0;
+
+			// earlier frames queued on gpu are not counted
+			fence = renderer->CreateFence();
+			if (fence)
+			{
+				renderer->WaitFence(fence);
+				renderer->DeleteFence(fence);
+			}
+			else
+			{
+				is_fence_unsupported_ = true;
+			}
+		}
+
+		double start = GetTimeStamp();
+
+		RenderLayers(renderer);
+
+		if (fence)
+		{
+			fence = renderer->CreateFence();
+			renderer->WaitFence(fence);
+			renderer->DeleteFence(fence);
+		}
+
+		if (fence || is_fence_unsupported_)
+			busy_ms_ = static_cast<float>((GetTimeStamp() - start) * 1000.0);
+	}
+
+	void DynamicResolution::RenderLayers(Renderer* renderer)
+	{
+		SceneMgr* scene_mgr = Root::Ins().scene_mgr();
+
+		int layer_num = scene_mgr->GetLayerNum();
+		int scaled_layer_num = scaled_layer_num_ < layer_num ? scaled_layer_num_ : layer_num;
+
+		if (scale_ >= 1.0f || scaled_layer_num <= 0 || is_buffer_unsupported_ || !CreateBuffer(renderer))
+		{
+			scene_mgr->Render(renderer);
+			return;
+		}
+
+		scene_mgr->transform_system()->Update();
+
+		// layer caches render into their own buffers, do them before binding this one
+		bool is_cache_updated = scene_mgr->UpdateLayerCache(renderer);
+
+		int scaled_width = static_cast<int>(width_ * scale_ + 0.5f);
+		int scaled_height = static_cast<int>(height_ * scale_ + 0.5f);
+		if (scaled_width < 1) scaled_width = 1;
+		if (scaled_height < 1) scaled_height = 1;
+
+		if (scaled_width != scaled_width_ || scaled_height != scaled_height_)
+		{
+			scaled_width_ = scaled_width;
+			scaled_height_ = scaled_height;
+
+			// frame buffer is bottom up, half texel inset keeps bilinear taps inside rendered area
+			sprite_->SetTexScaleScroll(Vector2((scaled_width_ - 1.0f) / width_, -(scaled_height_ - 1.0f) / height_),
+									   Vector2(0.5f / width_, (scaled_height_ - 0.5f) / height_));
+		}
+
+		renderer->EnableRenderToBuffer(0, 0, width_, height_, frame_buffer_);
+		renderer->SetViewport(0, 0, scaled_width_, scaled_height_);
+		renderer->SetScissor(0, 0, scaled_width_, scaled_height_);
+
+		// clear is limited by scissor too
+		renderer->RenderStart();
+		scene_mgr->RenderLayers(0, scaled_layer_num, renderer);
+
+		renderer->SetScissor(0, 0, width_, height_);
+		renderer->SetViewport(0, 0, width_, height_);
+		renderer->RestoreRenderToBuffer();
+
+		// in case render target was used to render caches
+		if (is_cache_updated)
+			renderer->RenderStart();
+
+		scene_mgr->ResetCurrentCam();
+		renderer->EnableBlend(false);
+		sprite_->Draw(renderer);
+
+		scene_mgr->RenderLayers(scaled_layer_num, layer_num, renderer);
+	}
+
+	void DynamicResolution::ReleaseBuffer()
+	{
+		if (sprite_)
+		{
+			delete sprite_;
+			sprite_ = NULL;
+		}
+
+		if (frame_buffer_)
+		{
+			Root::Ins().renderer()->ReleaseFrameBuffer(frame_buffer_);
+			frame_buffer_ = 0;
+		}
+
+		if (texture_)
+		{
+			Root::Ins().texture_mgr()->ReleaseTexture(texture_);
+			texture_ = NULL;
+		}
+
+		width_ = height_ = 0;
+		scaled_width_ = scaled_height_ = 0;
+	}
+
+	void DynamicResolution::SetScaleRange(float min_scale, float max_scale)
+	{
+		ASSERT(min_scale > 0.0f && min_scale <= max_scale && max_scale <= 1.0f);
+
+		min_scale_ = min_scale;
+		max_scale_ = max_scale;
+
+		if (scale_ < min_scale_) scale_ = min_scale_;
+		if (scale_ > max_scale_) scale_ = max_scale_;
+	}
+
+	void DynamicResolution::UpdateScale(Renderer* renderer)
+	{
+		float ms = -1.0f;
+
+		const GpuTimerStats& gpu_stats = renderer->gpu_timer_stats();
+
+		if (!gpu_stats.results.empty())
+		{
+			// results arrive a few frames late, only count each frame once
+			if (gpu_stats.frame_id != last_gpu_frame_id_)
+			{
+				last_gpu_frame_id_ = gpu_stats.frame_id;
+
+				ms = 0.0f;
+				for (size_t i = 0; i < gpu_stats.results.size(); ++i)
+				{
+					if (0 == gpu_stats.results[i].depth)
+						ms += static_cast<float>(gpu_stats.results[i].elapsed_ms);
+				}
+			}
+		}
+		else
+		{
+			// synced frame, or cpu time without fence, vsync wait is outside render so it doesn't count
+			ms = busy_ms_;
+			busy_ms_ = -1.0f;
+		}
+
+		if (ms < 0.0f)
+			return;
+
+		frame_ms_ = (frame_ms_ > 0.0f) ? frame_ms_ + (ms - frame_ms_) * kFrameMsSmooth : ms;
+
+		if (++frame_since_step_ < kStepFrameInterval)
+			return;
+
+		if (frame_ms_ > target_frame_ms_ && scale_ > min_scale_)
+		{
+			scale_ -= kScaleStep;
+			if (scale_ < min_scale_) scale_ = min_scale_;
+			frame_since_step_ = 0;
+		}
+		else if (frame_ms_ < target_frame_ms_ * kScaleUpRatio && scale_ < max_scale_)
+		{
+			scale_ += kScaleStep;
+			if (scale_ > max_scale_) scale_ = max_scale_;
+			frame_since_step_ = 0;
+		}
+	}
+
+	bool DynamicResolution::CreateBuffer(Renderer* renderer)
+	{
+		int width = renderer->backing_width();
+		int height = renderer->backing_height();
+
+		if (frame_buffer_ && width == width_ && height == height_)
+			return true;
+
+		ReleaseBuffer();
+
+		if (!renderer->caps().is_support_non_power_of_2_texture)
+		{
+			LOGW("dynamic resolution disabled, screen size texture is not supported");
+			is_buffer_unsupported_ = true;
+			return false;
+		}
+
+		frame_buffer_ = renderer->GenerateFrameBuffer();
+		if (0 == frame_buffer_)
+		{
+			LOGW("dynamic resolution disabled, frame buffer is not supported");
+			is_buffer_unsupported_ = true;
+			return false;
+		}
+
+		width_ = width;
+		height_ = height;
+
+		// full size, scaled layers render to its bottom left part
+		char name[32];
+		sprintf(name, "dynamic_res_%p", this);
+		texture_ = Root::Ins().texture_mgr()->CreateTexture(name, width_, height_, NULL);
+
+		renderer->BindTextureToFrameBuffer(texture_->id, frame_buffer_);
+		renderer->BindDepthBufferToFrameBuffer(width_, height_, frame_buffer_);
+		renderer->BindDefaultFrameBuffer();
+
+		// tex area is set by scale at render
+		sprite_ = new SpriteActor(static_cast<float>(width_), static_cast<float>(height_));
+		sprite_->SetMaterial(texture_, FILTER_LINEAR, FILTER_LINEAR);
+		sprite_->SetTextureWrap(WRAP_CLAMP_TO_EDGE, WRAP_CLAMP_TO_EDGE);
+		sprite_->SetDepthTest(false);
+		sprite_->SetDepthWrite(false);
+
+		return true;
+	}
+}
@@ -0,0 +1,84 @@
+//
+//  dynamic_resolution.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_DYNAMIC_RESOLUTION_H
+#define ERI_DYNAMIC_RESOLUTION_H
+
+namespace ERI
+{
+	class SpriteActor;
+	class Renderer;
+	struct Texture;
+
+	// Render world layers below scaled layer num at lower resolution into an offscreen color and depth buffer,
+	// which is upscaled to screen with bilinear filtering, then the other layers like UI are drawn at native resolution.
+	//
+	// Scale adapts to keep target frame time. Frame time is gpu time of the frame if gpu timer is enabled,
+	// otherwise every few frames one is synced with fences, gpu drained before it and waited after it,
+	// so the time includes gpu work and fill rate but not vsync wait, at the cost of a stall in that frame.
+	// Without fence support it falls back to cpu time spent in render, which misses gpu load.
+	// It is smoothed, and scale steps down when it is over target, up when it is well under,
+	// a few samples apart so each step shows in the time before the next.
+	// At full scale layers are drawn to screen directly.
+	//
+	// Only used by Root::Update, pipelined mode renders snapshots at full resolution.
+
+	class DynamicResolution
+	{
+	public:
+		DynamicResolution(int scaled_layer_num, float target_frame_ms);
+		~DynamicResolution();
+
+		void Render(Renderer* renderer);
+
+		// offscreen buffer is created again at next scaled render
+		void ReleaseBuffer();
+
+		// min equal to max keeps a fixed scale
+		void SetScaleRange(float min_scale, float max_scale);
+
+		inline void set_scaled_layer_num(int num) { scaled_layer_num_ = num; }
+		inline int scaled_layer_num() { return scaled_layer_num_; }
+
+		inline void set_target_frame_ms(float ms) { target_frame_ms_ = ms; }
+		inline float target_frame_ms() { return target_frame_ms_; }
+
+		// of scaled layers per axis
+		inline float scale() { return scale_; }
+
+		// smoothed
+		inline float frame_ms() { return frame_ms_; }
+
+	private:
+		void RenderLayers(Renderer* renderer);
+		void UpdateScale(Renderer* renderer);
+
+		bool CreateBuffer(Renderer* renderer);
+
+		int			scaled_layer_num_;
+		float		target_frame_ms_;
+		float		min_scale_, max_scale_;
+		float		scale_;
+
+		float		frame_ms_;
+		float		busy_ms_;	// of last measured render, not counted yet
+		int			last_gpu_frame_id_;
+		int			frame_since_sync_;
+		int			frame_since_step_;
+		bool		is_fence_unsupported_;
+
+		const Texture*	texture_;
+		int				frame_buffer_;
+		SpriteActor*	sprite_;
+		int				width_, height_;
+		int				scaled_width_, scaled_height_;	// of sprite tex area
+		bool			is_buffer_unsupported_;
+	};
+}
+
+#endif // ERI_DYNAMIC_RESOLUTION_H
@@ -0,0 +1,2065 @@
+//
+//  frame_capture.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "frame_capture.h"
+
+#include <cstddef>
+
+#include "root.h"
+#include "render_data.h"
+#include "material_data.h"
+#include "texture_mgr.h"
+#include "sys_helper.h"
+
+#ifdef ERI_RENDERER_ES2
+#include "shader_mgr.h"
+#endif
+
+namespace ERI
+{
+	// capture is written in native byte order, all supported platforms are little endian
+
+	static const unsigned int kCaptureMagic = 0x46495245; // "ERIF"
+	static const int kCaptureVersion = 4;
+
+	struct CaptureHeader
+	{
+		unsigned int	magic;
+		int				version;
+		int				frame_num;
+		int				width, height;
+	};
+
+	enum CaptureCommand
+	{
+		CAP_RESIZE,
+		CAP_VIEW_ORIENTATION,
+		CAP_BG_COLOR,
+		CAP_CLEAR_DEPTH_VALUE,
+		CAP_SCISSOR,
+		CAP_VIEWPORT,
+		CAP_BLEND,
+		CAP_BLEND_SEPARATE_ALPHA,
+		CAP_ALPHA_TEST,
+		CAP_DEPTH_PASS,
+		CAP_FOG,
+		CAP_FOG_DISTANCE,
+		CAP_FOG_COLOR,
+		CAP_VIEW,
+		CAP_VIEW_LOOK_AT,
+		CAP_PROJECTION,
+		CAP_ORTHO,
+		CAP_ORTHO_ZOOM,
+		CAP_PERSPECTIVE,
+		CAP_PERSPECTIVE_AUTO_ASPECT,
+
+		// obtain first, light states are ordered by command
+		CAP_LIGHT_OBTAIN,
+		CAP_LIGHT_RELEASE,
+		CAP_LIGHT_POS,
+		CAP_LIGHT_DIR,
+		CAP_LIGHT_SPOT_DIR,
+		CAP_LIGHT_AMBIENT,
+		CAP_LIGHT_DIFFUSE,
+		CAP_LIGHT_SPECULAR,
+		CAP_LIGHT_ATTENUATION,
+		CAP_LIGHT_SPOT_EXPONENT,
+		CAP_LIGHT_SPOT_CUTOFF,
+
+		CAP_TEXTURE_GENERATE,
+		CAP_TEXTURE_CREATE,
+		CAP_TEXTURE_UPDATE,
+		CAP_TEXTURE_RELEASE,
+		CAP_INVALIDATE_TEXTURE_BINDING,
+
+		CAP_FRAME_BUFFER_BIND_DEFAULT,
+		CAP_FRAME_BUFFER_CREATE,
+		CAP_FRAME_BUFFER_BIND_TEXTURE,
+		CAP_FRAME_BUFFER_BIND_DEPTH,
+		CAP_FRAME_BUFFER_RELEASE,
+
+		CAP_BUFFER_CREATE,
+		CAP_BUFFER_UPDATE,
+		CAP_BUFFER_UPDATE_RANGE,
+		CAP_BUFFER_RELEASE,
+
+		CAP_FRAMES_BEGIN,
+		CAP_RENDER_START,
+		CAP_RENDER_END,
+		CAP_RENDER,
+		CAP_RENDER_INSTANCED,
+		CAP_CLEAR_DEPTH,
+		CAP_SAVE_TRANSFORM,
+		CAP_RECOVER_TRANSFORM,
+		CAP_RENDER_TO_BUFFER,
+		CAP_COPY_TEXTURE,
+		CAP_COPY_PIXELS,
+		CAP_RESTORE_RENDER_TO_BUFFER,
+		CAP_MATERIAL,
+
+		CAP_COMMAND_MAX
+	};
+
+	// states of each light are kept after global states
+	static inline int GetLightStateKey(int idx, int command)
+	{
+		return (idx + 1) * CAP_COMMAND_MAX + command;
+	}
+
+	static int GetPixelDataSize(int width, int height, PixelFormat format)
+	{
+		switch (format)
+		{
+			case RGBA: return width * height * 4;
+			case RGB: return width * height * 2; // 565
+			case ALPHA: return width * height;
+			case RGBA_PVR_4BPP: return width * height / 2;
+			case RGBA_PVR_2BPP: return width * height / 4;
+			default: ASSERT(0); return 0;
+		}
+	}
+
+#pragma mark RendererCapture
+
+	RendererCapture::RendererCapture(Renderer* target) :
+		target_(target),
+		is_capturing_(false),
+		frame_left_(0),
+		captured_frame_num_(0)
+	{
+		ASSERT(target_);
+
+		caps_ = target_->caps();
+		view_orientation_ = target_->view_orientation();
+		set_content_scale(target_->content_scale());
+	}
+
+	RendererCapture::~RendererCapture()
+	{
+		StopCapture();
+
+		delete target_;
+	}
+
+	bool RendererCapture::StartCapture(const std::string& path, int frame_num /*= 1*/)
+	{
+		ASSERT(frame_num > 0);
+
+		StopCapture();
+
+		ofs_.open(path.c_str(), std::ios::out | std::ios::binary);
+
+		if (ofs_.fail())
+		{
+			LOGW("Failed to open frame capture: %s", path.c_str());
+			ofs_.clear();
+			return false;
+		}
+
+		CaptureHeader header;
+		header.magic = kCaptureMagic;
+		header.version = kCaptureVersion;
+		header.frame_num = 0; // filled at stop
+		header.width = target_->width();
+		header.height = target_->height();
+
+		ofs_.write(reinterpret_cast<char*>(&header), sizeof(header));
+
+		is_capturing_ = true;
+		frame_left_ = frame_num;
+		captured_frame_num_ = 0;
+
+		WriteResources();
+
+		BeginCommand(CAP_FRAMES_BEGIN);
+		EndCommand();
+
+		LOGI("Frame capture started: %s", path.c_str());
+
+		return true;
+	}
+
+	void RendererCapture::StopCapture()
+	{
+		if (!is_capturing_)
+			return;
+
+		is_capturing_ = false;
+
+		ofs_.seekp(offsetof(CaptureHeader, frame_num));
+		ofs_.write(reinterpret_cast<char*>(&captured_frame_num_), sizeof(captured_frame_num_));
+
+		bool is_fail = ofs_.fail();
+
+		ofs_.close();
+		ofs_.clear();
+
+		if (is_fail)
+		{
+			LOGW("Frame capture failed to write");
+		}
+		else
+		{
+			LOGI("Frame capture finished, %d frames", captured_frame_num_);
+		}
+	}
+
+	bool RendererCapture::Init(bool use_depth_buffer)
+	{
+		bool is_success = target_->Init(use_depth_buffer);
+
+		caps_ = target_->caps();
+
+		return is_success;
+	}
+
+	void RendererCapture::SetContextAsCurrent()
+	{
+		target_->SetContextAsCurrent();
+	}
+
+	void RendererCapture::BackingLayer(const void* layer)
+	{
+		// platform layer can't be replayed, the size it brings is taken at resize
+		target_->BackingLayer(layer);
+	}
+
+	void RendererCapture::Resize(int width, int height)
+	{
+		target_->Resize(width, height);
+
+		BeginCommand(CAP_RESIZE);
+		WriteInt(width);
+		WriteInt(height);
+		EndCommand();
+		KeepState(CAP_RESIZE);
+	}
+
+	void RendererCapture::RenderStart()
+	{
+		target_->RenderStart();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_RENDER_START);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::RenderEnd()
+	{
+		target_->RenderEnd();
+
+		// stats counted by target are added to those counted by callers on this one
+		target_->EndFrameStats();
+
+		const RenderStats& stats = target_->stats();
+		current_stats_.draw_call += stats.draw_call;
+		current_stats_.pre_pass_draw_call += stats.pre_pass_draw_call;
+		current_stats_.batch_draw_call += stats.batch_draw_call;
+		current_stats_.batched_actor += stats.batched_actor;
+		current_stats_.uniform_issued += stats.uniform_issued;
+		current_stats_.uniform_skipped += stats.uniform_skipped;
+		current_stats_.bind_issued += stats.bind_issued;
+		current_stats_.bind_skipped += stats.bind_skipped;
+		current_stats_.texture_bind_issued += stats.texture_bind_issued;
+		current_stats_.texture_bind_skipped += stats.texture_bind_skipped;
+
+		gpu_timer_stats_ = target_->gpu_timer_stats();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_RENDER_END);
+			EndCommand();
+
+			++captured_frame_num_;
+
+			if (--frame_left_ <= 0)
+				StopCapture();
+		}
+	}
+
+	void RendererCapture::Render(const RenderData* data)
+	{
+		target_->Render(data);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_RENDER);
+			WriteRenderData(data);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num)
+	{
+		target_->RenderInstanced(data, instance_buffer, instance_num);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_RENDER_INSTANCED);
+			WriteRenderData(data);
+			WriteInt(instance_buffer);
+			WriteInt(instance_num);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::RenderMulti(const RenderData* const* datas, int num)
+	{
+		target_->RenderMulti(datas, num);
+
+		// replayed as separate draws
+		if (is_capturing_)
+		{
+			for (int i = 0; i < num; ++i)
+			{
+				BeginCommand(CAP_RENDER);
+				WriteRenderData(datas[i]);
+				EndCommand();
+			}
+		}
+	}
+
+	void RendererCapture::ClearDepth()
+	{
+		target_->ClearDepth();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_CLEAR_DEPTH);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::SaveTransform()
+	{
+		target_->SaveTransform();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_SAVE_TRANSFORM);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::RecoverTransform()
+	{
+		target_->RecoverTransform();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_RECOVER_TRANSFORM);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::EnableRenderToBuffer(int x, int y, int width, int height, int frame_buffer)
+	{
+		target_->EnableRenderToBuffer(x, y, width, height, frame_buffer);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_RENDER_TO_BUFFER);
+			WriteInt(x);
+			WriteInt(y);
+			WriteInt(width);
+			WriteInt(height);
+			WriteInt(frame_buffer);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::CopyTexture(unsigned int texture, PixelFormat format)
+	{
+		target_->CopyTexture(texture, format);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_COPY_TEXTURE);
+			WriteInt(texture);
+			WriteInt(format);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format)
+	{
+		target_->CopyPixels(buffer, x, y, width, height, format);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_COPY_PIXELS);
+			WriteInt(x);
+			WriteInt(y);
+			WriteInt(width);
+			WriteInt(height);
+			WriteInt(format);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::RestoreRenderToBuffer()
+	{
+		target_->RestoreRenderToBuffer();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_RESTORE_RENDER_TO_BUFFER);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::SetScissor(int x, int y, int width, int height)
+	{
+		target_->SetScissor(x, y, width, height);
+
+		BeginCommand(CAP_SCISSOR);
+		WriteInt(x);
+		WriteInt(y);
+		WriteInt(width);
+		WriteInt(height);
+		EndCommand();
+		KeepState(CAP_SCISSOR);
+	}
+
+	void RendererCapture::SetViewport(int x, int y, int width, int height)
+	{
+		target_->SetViewport(x, y, width, height);
+
+		BeginCommand(CAP_VIEWPORT);
+		WriteInt(x);
+		WriteInt(y);
+		WriteInt(width);
+		WriteInt(height);
+		EndCommand();
+		KeepState(CAP_VIEWPORT);
+	}
+
+	void RendererCapture::EnableBlend(bool enable)
+	{
+		target_->EnableBlend(enable);
+
+		BeginCommand(CAP_BLEND);
+		WriteInt(enable);
+		EndCommand();
+		KeepState(CAP_BLEND);
+	}
+
+	void RendererCapture::EnableBlendSeparateAlpha(bool enable)
+	{
+		target_->EnableBlendSeparateAlpha(enable);
+
+		BeginCommand(CAP_BLEND_SEPARATE_ALPHA);
+		WriteInt(enable);
+		EndCommand();
+		KeepState(CAP_BLEND_SEPARATE_ALPHA);
+	}
+
+	void RendererCapture::EnableAlphaTest(bool enable)
+	{
+		target_->EnableAlphaTest(enable);
+
+		BeginCommand(CAP_ALPHA_TEST);
+		WriteInt(enable);
+		EndCommand();
+		KeepState(CAP_ALPHA_TEST);
+	}
+
+	void RendererCapture::SetDepthPass(DepthPass pass)
+	{
+		target_->SetDepthPass(pass);
+
+		BeginCommand(CAP_DEPTH_PASS);
+		WriteInt(pass);
+		EndCommand();
+		KeepState(CAP_DEPTH_PASS);
+	}
+
+	void RendererCapture::EnableMaterial(const MaterialData* data)
+	{
+		target_->EnableMaterial(data);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_MATERIAL);
+			WriteMaterialData(data);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::ObtainLight(int& idx)
+	{
+		target_->ObtainLight(idx);
+
+		if (idx < 0)
+			return;
+
+		BeginCommand(CAP_LIGHT_OBTAIN);
+		WriteInt(idx);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_OBTAIN));
+	}
+
+	void RendererCapture::ReleaseLight(int idx)
+	{
+		target_->ReleaseLight(idx);
+
+		BeginCommand(CAP_LIGHT_RELEASE);
+		WriteInt(idx);
+		EndCommand();
+
+		states_.erase(states_.lower_bound(GetLightStateKey(idx, 0)), states_.lower_bound(GetLightStateKey(idx + 1, 0)));
+	}
+
+	void RendererCapture::SetLightPos(int idx, const Vector3& pos)
+	{
+		target_->SetLightPos(idx, pos);
+
+		BeginCommand(CAP_LIGHT_POS);
+		WriteInt(idx);
+		WriteVector3(pos);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_POS));
+	}
+
+	void RendererCapture::SetLightDir(int idx, const Vector3& dir)
+	{
+		target_->SetLightDir(idx, dir);
+
+		BeginCommand(CAP_LIGHT_DIR);
+		WriteInt(idx);
+		WriteVector3(dir);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_DIR));
+	}
+
+	void RendererCapture::SetLightSpotDir(int idx, const Vector3& dir)
+	{
+		target_->SetLightSpotDir(idx, dir);
+
+		BeginCommand(CAP_LIGHT_SPOT_DIR);
+		WriteInt(idx);
+		WriteVector3(dir);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_SPOT_DIR));
+	}
+
+	void RendererCapture::SetLightAmbient(int idx, const Color& ambient)
+	{
+		target_->SetLightAmbient(idx, ambient);
+
+		BeginCommand(CAP_LIGHT_AMBIENT);
+		WriteInt(idx);
+		WriteColor(ambient);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_AMBIENT));
+	}
+
+	void RendererCapture::SetLightDiffuse(int idx, const Color& diffuse)
+	{
+		target_->SetLightDiffuse(idx, diffuse);
+
+		BeginCommand(CAP_LIGHT_DIFFUSE);
+		WriteInt(idx);
+		WriteColor(diffuse);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_DIFFUSE));
+	}
+
+	void RendererCapture::SetLightSpecular(int idx, const Color& specular)
+	{
+		target_->SetLightSpecular(idx, specular);
+
+		BeginCommand(CAP_LIGHT_SPECULAR);
+		WriteInt(idx);
+		WriteColor(specular);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_SPECULAR));
+	}
+
+	void RendererCapture::SetLightAttenuation(int idx, float constant, float linear, float quadratic)
+	{
+		target_->SetLightAttenuation(idx, constant, linear, quadratic);
+
+		BeginCommand(CAP_LIGHT_ATTENUATION);
+		WriteInt(idx);
+		WriteFloat(constant);
+		WriteFloat(linear);
+		WriteFloat(quadratic);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_ATTENUATION));
+	}
+
+	void RendererCapture::SetLightSpotExponent(int idx, float exponent)
+	{
+		target_->SetLightSpotExponent(idx, exponent);
+
+		BeginCommand(CAP_LIGHT_SPOT_EXPONENT);
+		WriteInt(idx);
+		WriteFloat(exponent);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_SPOT_EXPONENT));
+	}
+
+	void RendererCapture::SetLightSpotCutoff(int idx, float cutoff)
+	{
+		target_->SetLightSpotCutoff(idx, cutoff);
+
+		BeginCommand(CAP_LIGHT_SPOT_CUTOFF);
+		WriteInt(idx);
+		WriteFloat(cutoff);
+		EndCommand();
+		KeepState(GetLightStateKey(idx, CAP_LIGHT_SPOT_CUTOFF));
+	}
+
+	void RendererCapture::SetFog(FogMode mode, float density /*= 1.f*/)
+	{
+		target_->SetFog(mode, density);
+
+		BeginCommand(CAP_FOG);
+		WriteInt(mode);
+		WriteFloat(density);
+		EndCommand();
+		KeepState(CAP_FOG);
+	}
+
+	void RendererCapture::SetFogDistance(float start, float end /*= 1.f*/)
+	{
+		target_->SetFogDistance(start, end);
+
+		BeginCommand(CAP_FOG_DISTANCE);
+		WriteFloat(start);
+		WriteFloat(end);
+		EndCommand();
+		KeepState(CAP_FOG_DISTANCE);
+	}
+
+	void RendererCapture::SetFogColor(const Color& color)
+	{
+		target_->SetFogColor(color);
+
+		BeginCommand(CAP_FOG_COLOR);
+		WriteColor(color);
+		EndCommand();
+		KeepState(CAP_FOG_COLOR);
+	}
+
+	unsigned int RendererCapture::GenerateTexture(const void* buffer, int width, int height, PixelFormat format, int buffer_size /*= 0*/)
+	{
+		unsigned int texture_id = target_->GenerateTexture(buffer, width, height, format, buffer_size);
+
+		if (0 == texture_id)
+			return 0;
+
+		int size = buffer_size > 0 ? buffer_size : GetPixelDataSize(width, height, format);
+
+		TextureShadow& shadow = textures_[texture_id];
+		shadow.width = width;
+		shadow.height = height;
+		shadow.format = format;
+		shadow.is_compressed = buffer_size > 0;
+		shadow.data.clear();
+		if (buffer)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(buffer);
+			shadow.data.assign(bytes, bytes + size);
+		}
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_TEXTURE_GENERATE);
+			WriteInt(texture_id);
+			WriteInt(width);
+			WriteInt(height);
+			WriteInt(format);
+			WriteInt(shadow.is_compressed);
+			WriteBytes(buffer, size);
+			EndCommand();
+		}
+
+		return texture_id;
+	}
+
+	unsigned int RendererCapture::GenerateTexture()
+	{
+		unsigned int texture_id = target_->GenerateTexture();
+
+		if (0 == texture_id)
+			return 0;
+
+		TextureShadow& shadow = textures_[texture_id];
+		shadow.width = shadow.height = 0;
+		shadow.format = RGBA;
+		shadow.is_compressed = false;
+		shadow.data.clear();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_TEXTURE_CREATE);
+			WriteInt(texture_id);
+			EndCommand();
+		}
+
+		return texture_id;
+	}
+
+	void RendererCapture::UpdateTexture(unsigned int texture_id, const void* buffer, int width, int height, PixelFormat format)
+	{
+		target_->UpdateTexture(texture_id, buffer, width, height, format);
+
+		int size = GetPixelDataSize(width, height, format);
+
+		std::map<unsigned int, TextureShadow>::iterator it = textures_.find(texture_id);
+		if (it != textures_.end())
+		{
+			TextureShadow& shadow = it->second;
+			shadow.width = width;
+			shadow.height = height;
+			shadow.format = format;
+			shadow.is_compressed = false;
+			shadow.data.clear();
+			if (buffer)
+			{
+				const unsigned char* bytes = static_cast<const unsigned char*>(buffer);
+				shadow.data.assign(bytes, bytes + size);
+			}
+		}
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_TEXTURE_UPDATE);
+			WriteInt(texture_id);
+			WriteInt(width);
+			WriteInt(height);
+			WriteInt(format);
+			WriteBytes(buffer, size);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::ReleaseTexture(int texture_id)
+	{
+		target_->ReleaseTexture(texture_id);
+
+		textures_.erase(texture_id);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_TEXTURE_RELEASE);
+			WriteInt(texture_id);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::InvalidateTextureBinding()
+	{
+		target_->InvalidateTextureBinding();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_INVALIDATE_TEXTURE_BINDING);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::BindDefaultFrameBuffer()
+	{
+		target_->BindDefaultFrameBuffer();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_FRAME_BUFFER_BIND_DEFAULT);
+			EndCommand();
+		}
+	}
+
+	int RendererCapture::GenerateFrameBuffer()
+	{
+		int frame_buffer = target_->GenerateFrameBuffer();
+
+		if (0 == frame_buffer)
+			return 0;
+
+		frame_buffers_[frame_buffer] = FrameBufferShadow();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_FRAME_BUFFER_CREATE);
+			WriteInt(frame_buffer);
+			EndCommand();
+		}
+
+		return frame_buffer;
+	}
+
+	void RendererCapture::BindTextureToFrameBuffer(unsigned int texture_id, int frame_buffer)
+	{
+		target_->BindTextureToFrameBuffer(texture_id, frame_buffer);
+
+		frame_buffers_[frame_buffer].texture = texture_id;
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_FRAME_BUFFER_BIND_TEXTURE);
+			WriteInt(texture_id);
+			WriteInt(frame_buffer);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer)
+	{
+		target_->BindDepthBufferToFrameBuffer(width, height, frame_buffer);
+
+		FrameBufferShadow& shadow = frame_buffers_[frame_buffer];
+		shadow.depth_width = width;
+		shadow.depth_height = height;
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_FRAME_BUFFER_BIND_DEPTH);
+			WriteInt(width);
+			WriteInt(height);
+			WriteInt(frame_buffer);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::ReleaseFrameBuffer(int frame_buffer)
+	{
+		target_->ReleaseFrameBuffer(frame_buffer);
+
+		frame_buffers_.erase(frame_buffer);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_FRAME_BUFFER_RELEASE);
+			WriteInt(frame_buffer);
+			EndCommand();
+		}
+	}
+
+	unsigned int RendererCapture::GenerateBuffer()
+	{
+		unsigned int buffer = target_->GenerateBuffer();
+
+		if (0 == buffer)
+			return 0;
+
+		BufferShadow& shadow = buffers_[buffer];
+		shadow.type = BUFFER_VERTEX;
+		shadow.usage = BUFFER_USAGE_STATIC;
+		shadow.data.clear();
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_BUFFER_CREATE);
+			WriteInt(buffer);
+			EndCommand();
+		}
+
+		return buffer;
+	}
+
+	void RendererCapture::UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage)
+	{
+		target_->UpdateBuffer(buffer, type, data, size, usage);
+
+		BufferShadow& shadow = buffers_[buffer];
+		shadow.type = type;
+		shadow.usage = usage;
+		shadow.data.resize(size);
+		if (data && size > 0)
+			memcpy(&shadow.data[0], data, size);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_BUFFER_UPDATE);
+			WriteInt(buffer);
+			WriteInt(type);
+			WriteInt(usage);
+			WriteBytes(data, size);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size)
+	{
+		target_->UpdateBufferRange(buffer, type, offset, data, size);
+
+		BufferShadow& shadow = buffers_[buffer];
+		if (offset + size > static_cast<int>(shadow.data.size()))
+			shadow.data.resize(offset + size);
+		if (size > 0)
+			memcpy(&shadow.data[offset], data, size);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_BUFFER_UPDATE_RANGE);
+			WriteInt(buffer);
+			WriteInt(type);
+			WriteInt(offset);
+			WriteBytes(data, size);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::ReleaseBuffer(unsigned int buffer)
+	{
+		target_->ReleaseBuffer(buffer);
+
+		if (0 == buffer)
+			return;
+
+		buffers_.erase(buffer);
+
+		if (is_capturing_)
+		{
+			BeginCommand(CAP_BUFFER_RELEASE);
+			WriteInt(buffer);
+			EndCommand();
+		}
+	}
+
+	void RendererCapture::ReleaseRenderData(RenderData& data)
+	{
+		unsigned int buffers[2] = { data.index_buffer, data.vertex_buffer };
+
+		target_->ReleaseRenderData(data);
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (0 == buffers[i])
+				continue;
+
+			buffers_.erase(buffers[i]);
+
+			if (is_capturing_)
+			{
+				BeginCommand(CAP_BUFFER_RELEASE);
+				WriteInt(buffers[i]);
+				EndCommand();
+			}
+		}
+	}
+
+	void RendererCapture::SetBgColor(const Color& color)
+	{
+		target_->SetBgColor(color);
+
+		BeginCommand(CAP_BG_COLOR);
+		WriteColor(color);
+		EndCommand();
+		KeepState(CAP_BG_COLOR);
+	}
+
+	void RendererCapture::SetClearDepth(float clamped_depth)
+	{
+		target_->SetClearDepth(clamped_depth);
+
+		BeginCommand(CAP_CLEAR_DEPTH_VALUE);
+		WriteFloat(clamped_depth);
+		EndCommand();
+		KeepState(CAP_CLEAR_DEPTH_VALUE);
+	}
+
+	void RendererCapture::UpdateView(const Matrix4& view_matrix)
+	{
+		target_->UpdateView(view_matrix);
+
+		BeginCommand(CAP_VIEW);
+		WriteMatrix(view_matrix);
+		EndCommand();
+		KeepState(CAP_VIEW);
+	}
+
+	void RendererCapture::UpdateView(const Vector3& eye, const Vector3& at, const Vector3& up)
+	{
+		target_->UpdateView(eye, at, up);
+
+		BeginCommand(CAP_VIEW_LOOK_AT);
+		WriteVector3(eye);
+		WriteVector3(at);
+		WriteVector3(up);
+		EndCommand();
+		KeepState(CAP_VIEW);
+	}
+
+	void RendererCapture::UpdateProjection(const Matrix4& projection_matrix)
+	{
+		target_->UpdateProjection(projection_matrix);
+
+		BeginCommand(CAP_PROJECTION);
+		WriteMatrix(projection_matrix);
+		EndCommand();
+		KeepState(CAP_PROJECTION);
+	}
+
+	void RendererCapture::UpdateOrthoProjection(float width, float height, float near_z, float far_z)
+	{
+		target_->UpdateOrthoProjection(width, height, near_z, far_z);
+
+		BeginCommand(CAP_ORTHO);
+		WriteFloat(width);
+		WriteFloat(height);
+		WriteFloat(near_z);
+		WriteFloat(far_z);
+		EndCommand();
+		KeepState(CAP_PROJECTION);
+	}
+
+	void RendererCapture::UpdateOrthoProjection(float zoom, float near_z, float far_z)
+	{
+		target_->UpdateOrthoProjection(zoom, near_z, far_z);
+
+		BeginCommand(CAP_ORTHO_ZOOM);
+		WriteFloat(zoom);
+		WriteFloat(near_z);
+		WriteFloat(far_z);
+		EndCommand();
+		KeepState(CAP_PROJECTION);
+	}
+
+	void RendererCapture::UpdatePerspectiveProjection(float fov_y, float aspect, float near_z, float far_z)
+	{
+		target_->UpdatePerspectiveProjection(fov_y, aspect, near_z, far_z);
+
+		BeginCommand(CAP_PERSPECTIVE);
+		WriteFloat(fov_y);
+		WriteFloat(aspect);
+		WriteFloat(near_z);
+		WriteFloat(far_z);
+		EndCommand();
+		KeepState(CAP_PROJECTION);
+	}
+
+	void RendererCapture::UpdatePerspectiveProjection(float fov_y, float near_z, float far_z)
+	{
+		target_->UpdatePerspectiveProjection(fov_y, near_z, far_z);
+
+		BeginCommand(CAP_PERSPECTIVE_AUTO_ASPECT);
+		WriteFloat(fov_y);
+		WriteFloat(near_z);
+		WriteFloat(far_z);
+		EndCommand();
+		KeepState(CAP_PROJECTION);
+	}
+
+	void RendererCapture::SetViewOrientation(ViewOrientation orientaion)
+	{
+		target_->SetViewOrientation(orientaion);
+		view_orientation_ = orientaion;
+
+		BeginCommand(CAP_VIEW_ORIENTATION);
+		WriteInt(orientaion);
+		EndCommand();
+		KeepState(CAP_VIEW_ORIENTATION);
+	}
+
+	void RendererCapture::BeginCommand(int command)
+	{
+		command_.clear();
+		WriteInt(command);
+	}
+
+	void RendererCapture::EndCommand()
+	{
+		if (is_capturing_)
+			ofs_.write(reinterpret_cast<char*>(&command_[0]), command_.size());
+	}
+
+	void RendererCapture::KeepState(int key)
+	{
+		states_[key] = command_;
+	}
+
+	void RendererCapture::WriteInt(int value)
+	{
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+		command_.insert(command_.end(), bytes, bytes + sizeof(value));
+	}
+
+	void RendererCapture::WriteFloat(float value)
+	{
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+		command_.insert(command_.end(), bytes, bytes + sizeof(value));
+	}
+
+	void RendererCapture::WriteVector2(const Vector2& v)
+	{
+		WriteFloat(v.x);
+		WriteFloat(v.y);
+	}
+
+	void RendererCapture::WriteVector3(const Vector3& v)
+	{
+		WriteFloat(v.x);
+		WriteFloat(v.y);
+		WriteFloat(v.z);
+	}
+
+	void RendererCapture::WriteColor(const Color& color)
+	{
+		WriteFloat(color.r);
+		WriteFloat(color.g);
+		WriteFloat(color.b);
+		WriteFloat(color.a);
+	}
+
+	void RendererCapture::WriteMatrix(const Matrix4& m)
+	{
+		for (int i = 0; i < 16; ++i)
+			WriteFloat(m.m[i]);
+	}
+
+	void RendererCapture::WriteBytes(const void* data, int size)
+	{
+		// size is kept for allocation without data
+		WriteInt(size);
+		WriteInt(data != NULL);
+
+		if (data && size > 0)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			command_.insert(command_.end(), bytes, bytes + size);
+		}
+	}
+
+	void RendererCapture::WriteRenderData(const RenderData* data)
+	{
+		// vertex array and program are per context, not captured
+
+		WriteInt(data->vertex_buffer);
+		WriteInt(data->vertex_offset);
+		WriteInt(data->vertex_type);
+		WriteInt(data->vertex_format);
+		WriteInt(data->vertex_count);
+
+		WriteInt(data->index_buffer);
+		WriteInt(data->index_offset);
+		WriteInt(data->index_count);
+
+		WriteMatrix(data->world_model_matrix);
+		WriteInt(data->apply_identity_model_matrix);
+
+		WriteInt(data->is_tex_transform);
+		WriteVector2(data->tex_scale);
+		WriteVector2(data->tex_translate);
+
+		WriteColor(data->color);
+
+		WriteInt(data->blend_src_factor);
+		WriteInt(data->blend_dst_factor);
+		WriteInt(data->alpha_premultiplied);
+
+		WriteInt(data->alpha_test_func);
+		WriteFloat(data->alpha_test_ref);
+
+		WriteInt(data->depth_test_func);
+	}
+
+	void RendererCapture::WriteMaterialData(const MaterialData* data)
+	{
+		for (int i = 0; i < MAX_TEXTURE_UNIT; ++i)
+		{
+			const TextureUnit& unit = data->texture_units[i];
+
+			WriteInt(unit.texture ? unit.texture->id : 0);
+
+			WriteInt(unit.params.filter_min);
+			WriteInt(unit.params.filter_mag);
+			WriteInt(unit.params.wrap_s);
+			WriteInt(unit.params.wrap_t);
+
+			const TextureEnvs& envs = unit.envs;
+			WriteInt(envs.mode);
+			WriteInt(envs.combine_rgb);
+			WriteInt(envs.combine_alpha);
+			WriteInt(envs.src0_rgb);
+			WriteInt(envs.src1_rgb);
+			WriteInt(envs.src2_rgb);
+			WriteInt(envs.src0_alpha);
+			WriteInt(envs.src1_alpha);
+			WriteInt(envs.src2_alpha);
+			WriteInt(envs.operand0_rgb);
+			WriteInt(envs.operand1_rgb);
+			WriteInt(envs.operand2_rgb);
+			WriteInt(envs.operand0_alpha);
+			WriteInt(envs.operand1_alpha);
+			WriteInt(envs.operand2_alpha);
+
+			WriteInt(unit.coord_idx);
+		}
+
+		WriteInt(data->used_unit);
+		WriteInt(data->opacity_type);
+		WriteInt(data->depth_test);
+		WriteInt(data->depth_write);
+		WriteInt(data->cull_face);
+		WriteInt(data->cull_front);
+		WriteInt(data->accept_light);
+		WriteInt(data->accept_fog);
+
+		WriteInt(data->color_write.r);
+		WriteInt(data->color_write.g);
+		WriteInt(data->color_write.b);
+		WriteInt(data->color_write.a);
+	}
+
+	void RendererCapture::WriteResources()
+	{
+		ASSERT(is_capturing_);
+
+		for (std::map<unsigned int, TextureShadow>::iterator it = textures_.begin(); it != textures_.end(); ++it)
+		{
+			const TextureShadow& shadow = it->second;
+
+			if (!shadow.data.empty())
+			{
+				BeginCommand(CAP_TEXTURE_GENERATE);
+				WriteInt(it->first);
+				WriteInt(shadow.width);
+				WriteInt(shadow.height);
+				WriteInt(shadow.format);
+				WriteInt(shadow.is_compressed);
+				WriteBytes(&shadow.data[0], static_cast<int>(shadow.data.size()));
+				EndCommand();
+				continue;
+			}
+
+			BeginCommand(CAP_TEXTURE_CREATE);
+			WriteInt(it->first);
+			EndCommand();
+
+			// render target or texture filled by copy, allocate only
+			if (shadow.width > 0)
+			{
+				BeginCommand(CAP_TEXTURE_UPDATE);
+				WriteInt(it->first);
+				WriteInt(shadow.width);
+				WriteInt(shadow.height);
+				WriteInt(shadow.format);
+				WriteBytes(NULL, 0);
+				EndCommand();
+			}
+		}
+
+		for (std::map<unsigned int, BufferShadow>::iterator it = buffers_.begin(); it != buffers_.end(); ++it)
+		{
+			const BufferShadow& shadow = it->second;
+
+			BeginCommand(CAP_BUFFER_CREATE);
+			WriteInt(it->first);
+			EndCommand();
+
+			if (!shadow.data.empty())
+			{
+				BeginCommand(CAP_BUFFER_UPDATE);
+				WriteInt(it->first);
+				WriteInt(shadow.type);
+				WriteInt(shadow.usage);
+				WriteBytes(&shadow.data[0], static_cast<int>(shadow.data.size()));
+				EndCommand();
+			}
+		}
+
+		for (std::map<int, FrameBufferShadow>::iterator it = frame_buffers_.begin(); it != frame_buffers_.end(); ++it)
+		{
+			BeginCommand(CAP_FRAME_BUFFER_CREATE);
+			WriteInt(it->first);
+			EndCommand();
+
+			if (it->second.texture)
+			{
+				BeginCommand(CAP_FRAME_BUFFER_BIND_TEXTURE);
+				WriteInt(it->second.texture);
+				WriteInt(it->first);
+				EndCommand();
+			}
+
+			if (it->second.depth_width > 0)
+			{
+				BeginCommand(CAP_FRAME_BUFFER_BIND_DEPTH);
+				WriteInt(it->second.depth_width);
+				WriteInt(it->second.depth_height);
+				WriteInt(it->first);
+				EndCommand();
+			}
+		}
+
+		if (!frame_buffers_.empty())
+		{
+			BeginCommand(CAP_FRAME_BUFFER_BIND_DEFAULT);
+			EndCommand();
+		}
+
+		for (std::map<int, std::vector<unsigned char> >::iterator it = states_.begin(); it != states_.end(); ++it)
+		{
+			ofs_.write(reinterpret_cast<char*>(&it->second[0]), it->second.size());
+		}
+	}
+
+#pragma mark FrameReplay
+
+	FrameReplay::FrameReplay() :
+		frame_num_(0),
+		capture_width_(0),
+		capture_height_(0),
+		renderer_(NULL),
+		render_data_(new RenderData),
+		material_(new MaterialData),
+		is_material_pending_(false),
+		frame_start_time_(0.0),
+		skipped_draw_(0)
+	{
+		// vertex array object is per render data, don't create for the one shared by all draws
+		render_data_->disable_vertex_array = true;
+	}
+
+	FrameReplay::~FrameReplay()
+	{
+		Release();
+
+		// buffers belong to replay and are released already
+		render_data_->vertex_buffer = 0;
+		render_data_->index_buffer = 0;
+
+		delete render_data_;
+		delete material_;
+	}
+
+	bool FrameReplay::Load(const std::string& path)
+	{
+		std::ifstream ifs(path.c_str(), std::ios::in | std::ios::binary);
+
+		if (ifs.fail())
+		{
+			LOGW("Failed to open frame capture: %s", path.c_str());
+			return false;
+		}
+
+		ifs.seekg(0, std::ios::end);
+		size_t size = static_cast<size_t>(ifs.tellg());
+		ifs.seekg(0, std::ios::beg);
+
+		CaptureHeader header;
+
+		if (size < sizeof(header))
+		{
+			LOGW("Frame capture too small: %s", path.c_str());
+			return false;
+		}
+
+		content_.resize(size);
+		ifs.read(reinterpret_cast<char*>(&content_[0]), size);
+
+		if (ifs.fail())
+		{
+			LOGW("Failed to read frame capture: %s", path.c_str());
+			content_.clear();
+			return false;
+		}
+
+		memcpy(&header, &content_[0], sizeof(header));
+
+		if (header.magic != kCaptureMagic || header.version != kCaptureVersion)
+		{
+			LOGW("Frame capture version mismatch: %s", path.c_str());
+			content_.clear();
+			return false;
+		}
+
+		frame_num_ = header.frame_num;
+		capture_width_ = header.width;
+		capture_height_ = header.height;
+
+		return true;
+	}
+
+	bool FrameReplay::Replay(Renderer* renderer)
+	{
+		ASSERT(renderer);
+
+		if (content_.empty())
+			return false;
+
+		Release();
+
+		renderer_ = renderer;
+		frame_ms_.clear();
+		skipped_draw_ = 0;
+		is_material_pending_ = false;
+
+		size_t pos = sizeof(CaptureHeader);
+		while (pos < content_.size())
+		{
+			int command;
+			if (!ReadInt(pos, command) || !ReplayCommand(command, pos))
+			{
+				LOGW("Frame capture corrupted at %d", static_cast<int>(pos));
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void FrameReplay::Release()
+	{
+		if (!renderer_)
+			return;
+
+		for (std::map<unsigned int, Texture*>::iterator it = textures_.begin(); it != textures_.end(); ++it)
+		{
+			renderer_->ReleaseTexture(it->second->id);
+			delete it->second;
+		}
+		textures_.clear();
+
+		for (std::map<unsigned int, unsigned int>::iterator it = buffers_.begin(); it != buffers_.end(); ++it)
+		{
+			renderer_->ReleaseBuffer(it->second);
+		}
+		buffers_.clear();
+
+		for (std::map<int, int>::iterator it = frame_buffers_.begin(); it != frame_buffers_.end(); ++it)
+		{
+			renderer_->ReleaseFrameBuffer(it->second);
+		}
+		frame_buffers_.clear();
+
+		for (std::map<int, int>::iterator it = lights_.begin(); it != lights_.end(); ++it)
+		{
+			renderer_->ReleaseLight(it->second);
+		}
+		lights_.clear();
+
+		renderer_ = NULL;
+	}
+
+	bool FrameReplay::ReplayCommand(int command, size_t& pos)
+	{
+		int x, y, width, height, idx, format, value;
+		float f0, f1, f2, f3;
+		Vector3 v0, v1, v2;
+		Color color;
+		Matrix4 m;
+		const unsigned char* data;
+
+		switch (command)
+		{
+			case CAP_RESIZE:
+				if (!ReadInt(pos, width) || !ReadInt(pos, height)) return false;
+				renderer_->Resize(width, height);
+				break;
+
+			case CAP_VIEW_ORIENTATION:
+				if (!ReadInt(pos, value)) return false;
+				renderer_->SetViewOrientation(static_cast<ViewOrientation>(value));
+				break;
+
+			case CAP_BG_COLOR:
+				if (!ReadColor(pos, color)) return false;
+				renderer_->SetBgColor(color);
+				break;
+
+			case CAP_CLEAR_DEPTH_VALUE:
+				if (!ReadFloat(pos, f0)) return false;
+				renderer_->SetClearDepth(f0);
+				break;
+
+			case CAP_SCISSOR:
+				if (!ReadInt(pos, x) || !ReadInt(pos, y) || !ReadInt(pos, width) || !ReadInt(pos, height)) return false;
+				renderer_->SetScissor(x, y, width, height);
+				break;
+
+			case CAP_VIEWPORT:
+				if (!ReadInt(pos, x) || !ReadInt(pos, y) || !ReadInt(pos, width) || !ReadInt(pos, height)) return false;
+				renderer_->SetViewport(x, y, width, height);
+				break;
+
+			case CAP_BLEND:
+				if (!ReadInt(pos, value)) return false;
+				renderer_->EnableBlend(value != 0);
+				break;
+
+			case CAP_BLEND_SEPARATE_ALPHA:
+				if (!ReadInt(pos, value)) return false;
+				renderer_->EnableBlendSeparateAlpha(value != 0);
+				break;
+
+			case CAP_ALPHA_TEST:
+				if (!ReadInt(pos, value)) return false;
+				renderer_->EnableAlphaTest(value != 0);
+				break;
+
+			case CAP_DEPTH_PASS:
+				if (!ReadInt(pos, value)) return false;
+				renderer_->SetDepthPass(static_cast<DepthPass>(value));
+				break;
+
+			case CAP_FOG:
+				if (!ReadInt(pos, value) || !ReadFloat(pos, f0)) return false;
+				renderer_->SetFog(static_cast<FogMode>(value), f0);
+				break;
+
+			case CAP_FOG_DISTANCE:
+				if (!ReadFloat(pos, f0) || !ReadFloat(pos, f1)) return false;
+				renderer_->SetFogDistance(f0, f1);
+				break;
+
+			case CAP_FOG_COLOR:
+				if (!ReadColor(pos, color)) return false;
+				renderer_->SetFogColor(color);
+				break;
+
+			case CAP_VIEW:
+				if (!ReadMatrix(pos, m)) return false;
+				renderer_->UpdateView(m);
+				break;
+
+			case CAP_VIEW_LOOK_AT:
+				if (!ReadVector3(pos, v0) || !ReadVector3(pos, v1) || !ReadVector3(pos, v2)) return false;
+				renderer_->UpdateView(v0, v1, v2);
+				break;
+
+			case CAP_PROJECTION:
+				if (!ReadMatrix(pos, m)) return false;
+				renderer_->UpdateProjection(m);
+				break;
+
+			case CAP_ORTHO:
+				if (!ReadFloat(pos, f0) || !ReadFloat(pos, f1) || !ReadFloat(pos, f2) || !ReadFloat(pos, f3)) return false;
+				renderer_->UpdateOrthoProjection(f0, f1, f2, f3);
+				break;
+
+			case CAP_ORTHO_ZOOM:
+				if (!ReadFloat(pos, f0) || !ReadFloat(pos, f1) || !ReadFloat(pos, f2)) return false;
+				renderer_->UpdateOrthoProjection(f0, f1, f2);
+				break;
+
+			case CAP_PERSPECTIVE:
+				if (!ReadFloat(pos, f0) || !ReadFloat(pos, f1) || !ReadFloat(pos, f2) || !ReadFloat(pos, f3)) return false;
+				renderer_->UpdatePerspectiveProjection(f0, f1, f2, f3);
+				break;
+
+			case CAP_PERSPECTIVE_AUTO_ASPECT:
+				if (!ReadFloat(pos, f0) || !ReadFloat(pos, f1) || !ReadFloat(pos, f2)) return false;
+				renderer_->UpdatePerspectiveProjection(f0, f1, f2);
+				break;
+
+			case CAP_LIGHT_OBTAIN:
+				if (!ReadInt(pos, idx)) return false;
+				renderer_->ObtainLight(value);
+				lights_[idx] = value;
+				break;
+
+			case CAP_LIGHT_RELEASE:
+				if (!ReadInt(pos, idx)) return false;
+				if (lights_.find(idx) != lights_.end())
+				{
+					renderer_->ReleaseLight(lights_[idx]);
+					lights_.erase(idx);
+				}
+				break;
+
+			case CAP_LIGHT_POS:
+			case CAP_LIGHT_DIR:
+			case CAP_LIGHT_SPOT_DIR:
+				if (!ReadInt(pos, idx) || !ReadVector3(pos, v0)) return false;
+				idx = MapLight(idx);
+				if (idx < 0) break;
+				if (CAP_LIGHT_POS == command) renderer_->SetLightPos(idx, v0);
+				else if (CAP_LIGHT_DIR == command) renderer_->SetLightDir(idx, v0);
+				else renderer_->SetLightSpotDir(idx, v0);
+				break;
+
+			case CAP_LIGHT_AMBIENT:
+			case CAP_LIGHT_DIFFUSE:
+			case CAP_LIGHT_SPECULAR:
+				if (!ReadInt(pos, idx) || !ReadColor(pos, color)) return false;
+				idx = MapLight(idx);
+				if (idx < 0) break;
+				if (CAP_LIGHT_AMBIENT == command) renderer_->SetLightAmbient(idx, color);
+				else if (CAP_LIGHT_DIFFUSE == command) renderer_->SetLightDiffuse(idx, color);
+				else renderer_->SetLightSpecular(idx, color);
+				break;
+
+			case CAP_LIGHT_ATTENUATION:
+				if (!ReadInt(pos, idx) || !ReadFloat(pos, f0) || !ReadFloat(pos, f1) || !ReadFloat(pos, f2)) return false;
+				idx = MapLight(idx);
+				if (idx >= 0) renderer_->SetLightAttenuation(idx, f0, f1, f2);
+				break;
+
+			case CAP_LIGHT_SPOT_EXPONENT:
+			case CAP_LIGHT_SPOT_CUTOFF:
+				if (!ReadInt(pos, idx) || !ReadFloat(pos, f0)) return false;
+				idx = MapLight(idx);
+				if (idx < 0) break;
+				if (CAP_LIGHT_SPOT_EXPONENT == command) renderer_->SetLightSpotExponent(idx, f0);
+				else renderer_->SetLightSpotCutoff(idx, f0);
+				break;
+
+			case CAP_TEXTURE_GENERATE:
+				{
+					int is_compressed;
+					if (!ReadInt(pos, idx) || !ReadInt(pos, width) || !ReadInt(pos, height) ||
+						!ReadInt(pos, format) || !ReadInt(pos, is_compressed) || !ReadInt(pos, value) ||
+						!ReadBytes(pos, value, data))
+						return false;
+
+					unsigned int texture_id = renderer_->GenerateTexture(data, width, height, static_cast<PixelFormat>(format), is_compressed ? value : 0);
+
+					if (textures_.find(idx) != textures_.end()) delete textures_[idx];
+					textures_[idx] = new Texture(texture_id, width, height);
+				}
+				break;
+
+			case CAP_TEXTURE_CREATE:
+				if (!ReadInt(pos, idx)) return false;
+				if (textures_.find(idx) != textures_.end()) delete textures_[idx];
+				textures_[idx] = new Texture(renderer_->GenerateTexture(), 0, 0);
+				break;
+
+			case CAP_TEXTURE_UPDATE:
+				{
+					if (!ReadInt(pos, idx) || !ReadInt(pos, width) || !ReadInt(pos, height) ||
+						!ReadInt(pos, format) || !ReadInt(pos, value) || !ReadBytes(pos, value, data))
+						return false;
+
+					Texture* texture = GetTexture(idx);
+					if (!texture) break;
+
+					renderer_->UpdateTexture(texture->id, data, width, height, static_cast<PixelFormat>(format));
+					texture->width = width;
+					texture->height = height;
+				}
+				break;
+
+			case CAP_TEXTURE_RELEASE:
+				if (!ReadInt(pos, idx)) return false;
+				if (textures_.find(idx) != textures_.end())
+				{
+					renderer_->ReleaseTexture(textures_[idx]->id);
+					delete textures_[idx];
+					textures_.erase(idx);
+				}
+				break;
+
+			case CAP_INVALIDATE_TEXTURE_BINDING:
+				renderer_->InvalidateTextureBinding();
+				break;
+
+			case CAP_FRAME_BUFFER_BIND_DEFAULT:
+				renderer_->BindDefaultFrameBuffer();
+				break;
+
+			case CAP_FRAME_BUFFER_CREATE:
+				if (!ReadInt(pos, idx)) return false;
+				frame_buffers_[idx] = renderer_->GenerateFrameBuffer();
+				break;
+
+			case CAP_FRAME_BUFFER_BIND_TEXTURE:
+				{
+					if (!ReadInt(pos, value) || !ReadInt(pos, idx)) return false;
+
+					Texture* texture = GetTexture(value);
+					if (texture && frame_buffers_.find(idx) != frame_buffers_.end())
+						renderer_->BindTextureToFrameBuffer(texture->id, frame_buffers_[idx]);
+				}
+				break;
+
+			case CAP_FRAME_BUFFER_BIND_DEPTH:
+				if (!ReadInt(pos, width) || !ReadInt(pos, height) || !ReadInt(pos, idx)) return false;
+				if (frame_buffers_.find(idx) != frame_buffers_.end())
+					renderer_->BindDepthBufferToFrameBuffer(width, height, frame_buffers_[idx]);
+				break;
+
+			case CAP_FRAME_BUFFER_RELEASE:
+				if (!ReadInt(pos, idx)) return false;
+				if (frame_buffers_.find(idx) != frame_buffers_.end())
+				{
+					renderer_->ReleaseFrameBuffer(frame_buffers_[idx]);
+					frame_buffers_.erase(idx);
+				}
+				break;
+
+			case CAP_BUFFER_CREATE:
+				if (!ReadInt(pos, idx)) return false;
+				buffers_[idx] = renderer_->GenerateBuffer();
+				break;
+
+			case CAP_BUFFER_UPDATE:
+				{
+					int type, usage;
+					if (!ReadInt(pos, idx) || !ReadInt(pos, type) || !ReadInt(pos, usage) ||
+						!ReadInt(pos, value) || !ReadBytes(pos, value, data))
+						return false;
+
+					unsigned int buffer = MapBuffer(idx);
+					if (buffer)
+						renderer_->UpdateBuffer(buffer, static_cast<BufferType>(type), data, value, static_cast<BufferUsage>(usage));
+				}
+				break;
+
+			case CAP_BUFFER_UPDATE_RANGE:
+				{
+					int type, offset;
+					if (!ReadInt(pos, idx) || !ReadInt(pos, type) || !ReadInt(pos, offset) ||
+						!ReadInt(pos, value) || !ReadBytes(pos, value, data))
+						return false;
+
+					unsigned int buffer = MapBuffer(idx);
+					if (buffer && data)
+						renderer_->UpdateBufferRange(buffer, static_cast<BufferType>(type), offset, data, value);
+				}
+				break;
+
+			case CAP_BUFFER_RELEASE:
+				if (!ReadInt(pos, idx)) return false;
+				if (buffers_.find(idx) != buffers_.end())
+				{
+					renderer_->ReleaseBuffer(buffers_[idx]);
+					buffers_.erase(idx);
+				}
+				break;
+
+			case CAP_FRAMES_BEGIN:
+				frame_start_time_ = GetTimeStamp();
+				break;
+
+			case CAP_RENDER_START:
+				renderer_->RenderStart();
+				break;
+
+			case CAP_RENDER_END:
+				{
+					renderer_->RenderEnd();
+					renderer_->EndFrameStats();
+
+					void* fence = renderer_->CreateFence();
+					if (fence)
+					{
+						renderer_->WaitFence(fence);
+						renderer_->DeleteFence(fence);
+					}
+
+					double now = GetTimeStamp();
+					frame_ms_.push_back((now - frame_start_time_) * 1000.0);
+					frame_start_time_ = now;
+				}
+				break;
+
+			case CAP_RENDER:
+			case CAP_RENDER_INSTANCED:
+				{
+					int instance_buffer = 0, instance_num = 0;
+
+					if (!ReadRenderData(pos, *render_data_)) return false;
+					if (CAP_RENDER_INSTANCED == command && (!ReadInt(pos, instance_buffer) || !ReadInt(pos, instance_num))) return false;
+
+#ifdef ERI_RENDERER_ES2
+					ShaderMgr* shader_mgr = Root::Ins().shader_mgr();
+
+					if (CAP_RENDER_INSTANCED == command && (!shader_mgr || !shader_mgr->instanced_sprite_program()))
+					{
+						++skipped_draw_;
+						break;
+					}
+
+					if (shader_mgr)
+					{
+						if (CAP_RENDER_INSTANCED == command)
+							shader_mgr->Use(shader_mgr->instanced_sprite_program());
+						else
+							shader_mgr->Use(*render_data_);
+					}
+#endif
+
+					if (is_material_pending_)
+					{
+						renderer_->EnableMaterial(material_);
+						is_material_pending_ = false;
+					}
+
+					if (CAP_RENDER_INSTANCED == command)
+						renderer_->RenderInstanced(render_data_, MapBuffer(instance_buffer), instance_num);
+					else
+						renderer_->Render(render_data_);
+				}
+				break;
+
+			case CAP_CLEAR_DEPTH:
+				renderer_->ClearDepth();
+				break;
+
+			case CAP_SAVE_TRANSFORM:
+				renderer_->SaveTransform();
+				break;
+
+			case CAP_RECOVER_TRANSFORM:
+				renderer_->RecoverTransform();
+				break;
+
+			case CAP_RENDER_TO_BUFFER:
+				if (!ReadInt(pos, x) || !ReadInt(pos, y) || !ReadInt(pos, width) || !ReadInt(pos, height) || !ReadInt(pos, idx)) return false;
+				if (frame_buffers_.find(idx) != frame_buffers_.end())
+					renderer_->EnableRenderToBuffer(x, y, width, height, frame_buffers_[idx]);
+				break;
+
+			case CAP_COPY_TEXTURE:
+				{
+					if (!ReadInt(pos, idx) || !ReadInt(pos, format)) return false;
+
+					Texture* texture = GetTexture(idx);
+					if (texture)
+						renderer_->CopyTexture(texture->id, static_cast<PixelFormat>(format));
+				}
+				break;
+
+			case CAP_COPY_PIXELS:
+				{
+					if (!ReadInt(pos, x) || !ReadInt(pos, y) || !ReadInt(pos, width) || !ReadInt(pos, height) || !ReadInt(pos, format)) return false;
+
+					// read back stall is part of the workload
+					std::vector<unsigned char> pixels(GetPixelDataSize(width, height, static_cast<PixelFormat>(format)));
+					if (!pixels.empty())
+						renderer_->CopyPixels(&pixels[0], x, y, width, height, static_cast<PixelFormat>(format));
+				}
+				break;
+
+			case CAP_RESTORE_RENDER_TO_BUFFER:
+				renderer_->RestoreRenderToBuffer();
+				break;
+
+			case CAP_MATERIAL:
+				// texture unit uniforms go to current program, enable after the program of next draw is used
+				if (!ReadMaterialData(pos, *material_)) return false;
+				render_data_->material_ref = material_;
+				is_material_pending_ = true;
+				break;
+
+			default:
+				return false;
+		}
+
+		return true;
+	}
+
+	bool FrameReplay::ReadInt(size_t& pos, int& value)
+	{
+		if (pos + sizeof(value) > content_.size())
+			return false;
+
+		memcpy(&value, &content_[pos], sizeof(value));
+		pos += sizeof(value);
+		return true;
+	}
+
+	bool FrameReplay::ReadFloat(size_t& pos, float& value)
+	{
+		if (pos + sizeof(value) > content_.size())
+			return false;
+
+		memcpy(&value, &content_[pos], sizeof(value));
+		pos += sizeof(value);
+		return true;
+	}
+
+	bool FrameReplay::ReadVector2(size_t& pos, Vector2& v)
+	{
+		return ReadFloat(pos, v.x) && ReadFloat(pos, v.y);
+	}
+
+	bool FrameReplay::ReadVector3(size_t& pos, Vector3& v)
+	{
+		return ReadFloat(pos, v.x) && ReadFloat(pos, v.y) && ReadFloat(pos, v.z);
+	}
+
+	bool FrameReplay::ReadColor(size_t& pos, Color& color)
+	{
+		return ReadFloat(pos, color.r) && ReadFloat(pos, color.g) && ReadFloat(pos, color.b) && ReadFloat(pos, color.a);
+	}
+
+	bool FrameReplay::ReadMatrix(size_t& pos, Matrix4& m)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!ReadFloat(pos, m.m[i]))
+				return false;
+		}
+		return true;
+	}
+
+	bool FrameReplay::ReadBytes(size_t& pos, int size, const unsigned char*& out_data)
+	{
+		int has_data;
+		if (size < 0 || !ReadInt(pos, has_data))
+			return false;
+
+		out_data = NULL;
+
+		if (!has_data)
+			return true;
+
+		if (pos + size > content_.size())
+			return false;
+
+		// keep a valid pointer for empty data
+		out_data = size > 0 ? &content_[pos] : &content_[0];
+		pos += size;
+		return true;
+	}
+
+	bool FrameReplay::ReadRenderData(size_t& pos, RenderData& data)
+	{
+		int vertex_buffer, vertex_type, vertex_format, index_buffer;
+		int apply_identity_model_matrix, is_tex_transform, blend_src_factor, blend_dst_factor, alpha_premultiplied;
+		int alpha_test_func, depth_test_func;
+
+		if (!ReadInt(pos, vertex_buffer) ||
+			!ReadInt(pos, data.vertex_offset) ||
+			!ReadInt(pos, vertex_type) ||
+			!ReadInt(pos, vertex_format) ||
+			!ReadInt(pos, data.vertex_count) ||
+			!ReadInt(pos, index_buffer) ||
+			!ReadInt(pos, data.index_offset) ||
+			!ReadInt(pos, data.index_count) ||
+			!ReadMatrix(pos, data.world_model_matrix) ||
+			!ReadInt(pos, apply_identity_model_matrix) ||
+			!ReadInt(pos, is_tex_transform) ||
+			!ReadVector2(pos, data.tex_scale) ||
+			!ReadVector2(pos, data.tex_translate) ||
+			!ReadColor(pos, data.color) ||
+			!ReadInt(pos, blend_src_factor) ||
+			!ReadInt(pos, blend_dst_factor) ||
+			!ReadInt(pos, alpha_premultiplied) ||
+			!ReadInt(pos, alpha_test_func) ||
+			!ReadFloat(pos, data.alpha_test_ref) ||
+			!ReadInt(pos, depth_test_func))
+			return false;
+
+		data.vertex_buffer = MapBuffer(vertex_buffer);
+		data.vertex_type = vertex_type;
+		data.vertex_format = static_cast<VertexFormat>(vertex_format);
+		data.index_buffer = MapBuffer(index_buffer);
+		data.apply_identity_model_matrix = apply_identity_model_matrix != 0;
+		data.is_tex_transform = is_tex_transform != 0;
+		data.blend_src_factor = blend_src_factor;
+		data.blend_dst_factor = blend_dst_factor;
+		data.alpha_premultiplied = alpha_premultiplied != 0;
+		data.alpha_test_func = alpha_test_func;
+		data.depth_test_func = depth_test_func;
+		data.program = NULL;
+
+		return true;
+	}
+
+	bool FrameReplay::ReadMaterialData(size_t& pos, MaterialData& data)
+	{
+		int values[21];
+
+		for (int i = 0; i < MAX_TEXTURE_UNIT; ++i)
+		{
+			TextureUnit& unit = data.texture_units[i];
+
+			for (int j = 0; j < 21; ++j)
+			{
+				if (!ReadInt(pos, values[j]))
+					return false;
+			}
+
+			unit.texture = values[0] ? GetTexture(values[0]) : NULL;
+
+			unit.params.filter_min = static_cast<TextureFilter>(values[1]);
+			unit.params.filter_mag = static_cast<TextureFilter>(values[2]);
+			unit.params.wrap_s = static_cast<TextureWrap>(values[3]);
+			unit.params.wrap_t = static_cast<TextureWrap>(values[4]);
+
+			TextureEnvs& envs = unit.envs;
+			envs.mode = static_cast<TextureEnvMode>(values[5]);
+			envs.combine_rgb = static_cast<TextureEnvOp>(values[6]);
+			envs.combine_alpha = static_cast<TextureEnvOp>(values[7]);
+			envs.src0_rgb = static_cast<TextureEnvSrc>(values[8]);
+			envs.src1_rgb = static_cast<TextureEnvSrc>(values[9]);
+			envs.src2_rgb = static_cast<TextureEnvSrc>(values[10]);
+			envs.src0_alpha = static_cast<TextureEnvSrc>(values[11]);
+			envs.src1_alpha = static_cast<TextureEnvSrc>(values[12]);
+			envs.src2_alpha = static_cast<TextureEnvSrc>(values[13]);
+			envs.operand0_rgb = static_cast<TextureEnvOperand>(values[14]);
+			envs.operand1_rgb = static_cast<TextureEnvOperand>(values[15]);
+			envs.operand2_rgb = static_cast<TextureEnvOperand>(values[16]);
+			envs.operand0_alpha = static_cast<TextureEnvOperand>(values[17]);
+			envs.operand1_alpha = static_cast<TextureEnvOperand>(values[18]);
+			envs.operand2_alpha = static_cast<TextureEnvOperand>(values[19]);
+
+			unit.coord_idx = values[20];
+		}
+
+		for (int j = 0; j < 12; ++j)
+		{
+			if (!ReadInt(pos, values[j]))
+				return false;
+		}
+
+		data.used_unit = values[0];
+		data.opacity_type = static_cast<OpacityType>(values[1]);
+		data.depth_test = values[2] != 0;
+		data.depth_write = values[3] != 0;
+		data.cull_face = values[4] != 0;
+		data.cull_front = values[5] != 0;
+		data.accept_light = values[6] != 0;
+		data.accept_fog = values[7] != 0;
+
+		data.color_write.r = values[8] != 0;
+		data.color_write.g = values[9] != 0;
+		data.color_write.b = values[10] != 0;
+		data.color_write.a = values[11] != 0;
+
+		return true;
+	}
+
+	Texture* FrameReplay::GetTexture(unsigned int id)
+	{
+		std::map<unsigned int, Texture*>::iterator it = textures_.find(id);
+		if (it == textures_.end())
+		{
+			LOGW("Frame replay missing texture %d", id);
+			return NULL;
+		}
+
+		return it->second;
+	}
+
+	unsigned int FrameReplay::MapBuffer(unsigned int id)
+	{
+		if (0 == id)
+			return 0;
+
+		std::map<unsigned int, unsigned int>::iterator it = buffers_.find(id);
+		if (it == buffers_.end())
+		{
+			LOGW("Frame replay missing buffer %d", id);
+			return 0;
+		}
+
+		return it->second;
+	}
+
+	int FrameReplay::MapLight(int idx)
+	{
+		std::map<int, int>::iterator it = lights_.find(idx);
+		if (it == lights_.end())
+			return -1;
+
+		return it->second;
+	}
+}
@@ -0,0 +1,274 @@
+//
+//  frame_capture.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_FRAME_CAPTURE_H
+#define ERI_FRAME_CAPTURE_H
+
+#include "pch.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+#include "renderer.h"
+
+namespace ERI
+{
+	struct Texture;
+
+	// Renderer wrapping the real one, which forwards every call and can serialize the calls
+	// of following frames into a capture file, to be replayed by FrameReplay.
+	//
+	// Contents of live textures and buffers, and persistent states like lights, fog and view
+	// are kept as they are uploaded or set, and written ahead of captured frames,
+	// so it should wrap the renderer before any resource is created, see Root::EnableFrameCapture.
+	// It costs a system memory copy of all uploads.
+	//
+	// Shader programs are not captured, replay uses the variant or default program instead,
+	// and multi draws are replayed as separate draws. Async pixel reads are not captured.
+
+	class RendererCapture : public Renderer
+	{
+	public:
+		// take ownership of target
+		RendererCapture(Renderer* target);
+		virtual ~RendererCapture();
+
+		// call between frames, capture stops after frame_num frames are finished by RenderEnd
+		bool StartCapture(const std::string& path, int frame_num = 1);
+		void StopCapture();
+
+		inline bool is_capturing() { return is_capturing_; }
+		inline Renderer* target() { return target_; }
+
+		virtual bool Init(bool use_depth_buffer);
+
+		virtual void SetContextAsCurrent();
+
+		virtual void BackingLayer(const void* layer);
+		virtual void Resize(int width, int height);
+
+		virtual int width() { return target_->width(); }
+		virtual int height() { return target_->height(); }
+		virtual int backing_width() { return target_->backing_width(); }
+		virtual int backing_height() { return target_->backing_height(); }
+
+		virtual bool IsReadyToRender() { return target_->IsReadyToRender(); }
+		virtual void RenderStart();
+		virtual void RenderEnd();
+		virtual void Render(const RenderData* data);
+		virtual void RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num);
+		virtual void RenderMulti(const RenderData* const* datas, int num);
+		virtual void ClearDepth();
+
+		virtual void SaveTransform();
+		virtual void RecoverTransform();
+
+		virtual void EnableRenderToBuffer(int x, int y, int width, int height, int frame_buffer);
+		virtual void CopyTexture(unsigned int texture, PixelFormat format);
+		virtual void CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format);
+		virtual void ReadPixelsAsync(int x, int y, int width, int height, PixelFormat format, ReadPixelsFunc func, void* data) { target_->ReadPixelsAsync(x, y, width, height, format, func, data); }
+		virtual void CancelReadPixels(void* data) { target_->CancelReadPixels(data); }
+		virtual void RestoreRenderToBuffer();
+
+		virtual void SetScissor(int x, int y, int width, int height);
+		virtual void SetViewport(int x, int y, int width, int height);
+
+		virtual void EnableBlend(bool enable);
+		virtual void EnableBlendSeparateAlpha(bool enable);
+		virtual void EnableAlphaTest(bool enable);
+		virtual void EnableMaterial(const MaterialData* data);
+		virtual void SetDepthPass(DepthPass pass);
+
+		virtual void ObtainLight(int& idx);
+		virtual void ReleaseLight(int idx);
+		virtual void SetLightPos(int idx, const Vector3& pos);
+		virtual void SetLightDir(int idx, const Vector3& dir);
+		virtual void SetLightSpotDir(int idx, const Vector3& dir);
+		virtual void SetLightAmbient(int idx, const Color& ambient);
+		virtual void SetLightDiffuse(int idx, const Color& diffuse);
+		virtual void SetLightSpecular(int idx, const Color& specular);
+		virtual void SetLightAttenuation(int idx, float constant, float linear, float quadratic);
+		virtual void SetLightSpotExponent(int idx, float exponent);
+		virtual void SetLightSpotCutoff(int idx, float cutoff);
+
+		virtual void SetFog(FogMode mode, float density = 1.f);
+		virtual void SetFogDistance(float start, float end = 1.f);
+		virtual void SetFogColor(const Color& color);
+
+		virtual unsigned int GenerateTexture(const void* buffer, int width, int height, PixelFormat format, int buffer_size = 0);
+		virtual unsigned int GenerateTexture();
+		virtual void UpdateTexture(unsigned int texture_id, const void* buffer, int width, int height, PixelFormat format);
+		virtual void ReleaseTexture(int texture_id);
+		virtual void InvalidateTextureBinding();
+
+		virtual void BindDefaultFrameBuffer();
+		virtual int GenerateFrameBuffer();
+		virtual void BindTextureToFrameBuffer(unsigned int texture_id, int frame_buffer);
+		virtual void BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer);
+		virtual void ReleaseFrameBuffer(int frame_buffer);
+
+		virtual unsigned int GenerateBuffer();
+		virtual void UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage);
+		virtual void UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size);
+		virtual void ReleaseBuffer(unsigned int buffer);
+
+		virtual void ReleaseRenderData(RenderData& data);
+
+		virtual void* CreateFence() { return target_->CreateFence(); }
+		virtual void WaitFence(void* fence) { target_->WaitFence(fence); }
+		virtual void DeleteFence(void* fence) { target_->DeleteFence(fence); }
+
+		virtual void EnableGpuTimer(bool enable) { target_->EnableGpuTimer(enable); }
+		virtual void BeginGpuTimer(GpuTimerScope scope, int id = -1) { target_->BeginGpuTimer(scope, id); }
+		virtual void EndGpuTimer() { target_->EndGpuTimer(); }
+		
+		virtual void EnableOverdrawCounter(bool enable) { target_->EnableOverdrawCounter(enable); }
+		virtual void BeginOverdrawCount() { target_->BeginOverdrawCount(); }
+		virtual void EndOverdrawCount() { target_->EndOverdrawCount(); }
+
+		virtual void SetBgColor(const Color& color);
+		virtual const Color& GetBgColor() { return target_->GetBgColor(); }
+
+		virtual void SetClearDepth(float clamped_depth);
+
+		virtual void UpdateView(const Matrix4& view_matrix);
+		virtual void UpdateView(const Vector3& eye, const Vector3& at, const Vector3& up);
+
+		virtual void UpdateProjection(const Matrix4& projection_matrix);
+		virtual void UpdateOrthoProjection(float width, float height, float near_z, float far_z);
+		virtual void UpdateOrthoProjection(float zoom, float near_z, float far_z);
+		virtual void UpdatePerspectiveProjection(float fov_y, float aspect, float near_z, float far_z);
+		virtual void UpdatePerspectiveProjection(float fov_y, float near_z, float far_z);
+
+		virtual void SetViewOrientation(ViewOrientation orientaion);
+
+	private:
+		struct TextureShadow
+		{
+			int							width, height;
+			PixelFormat					format;
+			bool						is_compressed;	// created with buffer size
+			std::vector<unsigned char>	data;			// empty if not uploaded from system memory
+		};
+
+		struct BufferShadow
+		{
+			BufferType					type;
+			BufferUsage					usage;
+			std::vector<unsigned char>	data;
+		};
+
+		struct FrameBufferShadow
+		{
+			FrameBufferShadow() : texture(0), depth_width(0), depth_height(0) {}
+
+			unsigned int	texture;						// bound texture
+			int				depth_width, depth_height;	// 0 if no depth buffer
+		};
+
+		void BeginCommand(int command);
+		void EndCommand();
+
+		// command just ended is the latest of a state, written ahead of capture
+		void KeepState(int key);
+
+		void WriteInt(int value);
+		void WriteFloat(float value);
+		void WriteVector2(const Vector2& v);
+		void WriteVector3(const Vector3& v);
+		void WriteColor(const Color& color);
+		void WriteMatrix(const Matrix4& m);
+		void WriteBytes(const void* data, int size);
+		void WriteRenderData(const RenderData* data);
+		void WriteMaterialData(const MaterialData* data);
+
+		void WriteResources();
+
+		Renderer*	target_;
+
+		std::ofstream	ofs_;
+		bool			is_capturing_;
+		int				frame_left_;
+		int				captured_frame_num_;
+
+		std::vector<unsigned char>	command_;
+
+		std::map<unsigned int, TextureShadow>	textures_;
+		std::map<unsigned int, BufferShadow>	buffers_;
+		std::map<int, FrameBufferShadow>		frame_buffers_;
+		std::map<int, std::vector<unsigned char> >	states_;
+	};
+
+	// Re-executes a capture file against any renderer, timing each frame.
+
+	class FrameReplay
+	{
+	public:
+		FrameReplay();
+		~FrameReplay();
+
+		bool Load(const std::string& path);
+
+		// resources of last replay are released first, then all are created again and frames are run,
+		// each frame waits for gpu at its end if renderer supports fences
+		bool Replay(Renderer* renderer);
+
+		// release resources created on renderer
+		void Release();
+
+		inline int frame_num() { return frame_num_; }
+		inline int capture_width() { return capture_width_; }
+		inline int capture_height() { return capture_height_; }
+
+		// of last replay
+		inline const std::vector<double>& frame_ms() { return frame_ms_; }
+
+		// instanced draws skipped as shader manager has no instanced sprite program
+		inline int skipped_draw() { return skipped_draw_; }
+
+	private:
+		bool ReplayCommand(int command, size_t& pos);
+
+		bool ReadInt(size_t& pos, int& value);
+		bool ReadFloat(size_t& pos, float& value);
+		bool ReadVector2(size_t& pos, Vector2& v);
+		bool ReadVector3(size_t& pos, Vector3& v);
+		bool ReadColor(size_t& pos, Color& color);
+		bool ReadMatrix(size_t& pos, Matrix4& m);
+		bool ReadBytes(size_t& pos, int size, const unsigned char*& out_data);
+		bool ReadRenderData(size_t& pos, RenderData& data);
+		bool ReadMaterialData(size_t& pos, MaterialData& data);
+
+		Texture* GetTexture(unsigned int id);
+		unsigned int MapBuffer(unsigned int id);
+		int MapLight(int idx);
+
+		std::vector<unsigned char>	content_;
+		int							frame_num_;
+		int							capture_width_, capture_height_;
+
+		Renderer*	renderer_;
+
+		std::map<unsigned int, Texture*>		textures_;
+		std::map<unsigned int, unsigned int>	buffers_;
+		std::map<int, int>						frame_buffers_;
+		std::map<int, int>						lights_;
+
+		RenderData*		render_data_;
+		MaterialData*	material_;
+		bool			is_material_pending_; // enabled after shader program of next draw is used
+
+		std::vector<double>	frame_ms_;
+		double				frame_start_time_;
+		int					skipped_draw_;
+	};
+}
+
+#endif // ERI_FRAME_CAPTURE_H
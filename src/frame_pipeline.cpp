@@ -0,0 +1,425 @@
+//
+//  frame_pipeline.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "frame_pipeline.h"
+
+#include "root.h"
+#include "renderer.h"
+#include "render_data.h"
+#include "material_data.h"
+#include "scene_actor.h"
+
+#ifdef ERI_RENDERER_ES2
+#include "shader_mgr.h"
+#endif
+
+namespace ERI
+{
+#pragma mark FrameSnapshot
+
+	FrameSnapshot::FrameSnapshot() :
+		resize_width_(0),
+		resize_height_(0)
+	{
+	}
+
+	FrameSnapshot::~FrameSnapshot()
+	{
+		size_t num = render_data_pool_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			// buffers belong to actors
+			render_data_pool_[i]->vertex_buffer = 0;
+			render_data_pool_[i]->index_buffer = 0;
+
+			delete render_data_pool_[i];
+			delete material_pool_[i];
+		}
+	}
+
+	void FrameSnapshot::Clear()
+	{
+		layers_.clear();
+		packets_.clear();
+		vertex_uploads_.clear();
+		vertex_data_.clear();
+		release_buffers_.clear();
+		resize_width_ = resize_height_ = 0;
+	}
+
+	void FrameSnapshot::AddLayer(CameraActor* cam, bool is_clear_depth)
+	{
+		FrameLayer layer;
+		layer.is_default_view = (NULL == cam);
+		layer.is_clear_depth = is_clear_depth;
+		layer.packet_begin = layer.packet_end = static_cast<int>(packets_.size());
+
+		if (cam)
+		{
+			layer.view_matrix = cam->GetViewMatrix();
+			layer.projection_matrix = cam->GetProjectionMatrix();
+		}
+
+		layers_.push_back(layer);
+	}
+
+	void FrameSnapshot::AddPackets(const RenderQueue* queue)
+	{
+		ASSERT(!layers_.empty());
+
+		const std::vector<RenderPacket>& queue_packets = queue->packets();
+
+		size_t num = queue_packets.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			size_t idx = packets_.size();
+			if (idx == render_data_pool_.size())
+			{
+				render_data_pool_.push_back(new RenderData);
+				material_pool_.push_back(new MaterialData);
+			}
+
+			SceneActor* actor = queue_packets[i].actor;
+
+			FramePacket packet;
+			packet.pass = static_cast<RenderPass>(queue_packets[i].key >> 62);
+			packet.owner = actor;
+			packet.render_data = render_data_pool_[idx];
+			packet.material = material_pool_[idx];
+
+			*packet.material = actor->material_data_;
+			*packet.render_data = actor->render_data_;
+			packet.render_data->material_ref = packet.material;
+
+			// vertex array object is per context, don't use cached ones of main context for copies
+			packet.render_data->disable_vertex_array = true;
+
+			packets_.push_back(packet);
+		}
+
+		layers_.back().packet_end = static_cast<int>(packets_.size());
+	}
+
+#pragma mark FramePipeline
+
+	FramePipeline::FramePipeline() :
+		build_idx_(0),
+		ready_idx_(-1),
+		rendering_idx_(-1),
+		is_quit_(false)
+	{
+	}
+
+	FramePipeline::~FramePipeline()
+	{
+		// render thread is stopped and its context is current now
+
+		for (int i = 0; i < 2; ++i)
+		{
+			ApplyRelease(snapshots_[i]);
+		}
+
+		for (std::map<const SceneActor*, GLuint>::iterator it = vertex_buffers_.begin(); it != vertex_buffers_.end(); ++it)
+		{
+			Root::Ins().renderer()->ReleaseBuffer(it->second);
+		}
+	}
+
+	void FramePipeline::Submit()
+	{
+		// resources created on update context this frame should be visible to render context
+		glFlush();
+
+		mutex_.Lock();
+
+		while (ready_idx_ >= 0 && !is_quit_)
+			cond_.Wait(mutex_);
+
+		ready_idx_ = build_idx_;
+		build_idx_ = 1 - build_idx_;
+
+		cond_.NotifyAll();
+
+		// next build snapshot may still be drawn
+		while (rendering_idx_ == build_idx_ && !is_quit_)
+			cond_.Wait(mutex_);
+
+		mutex_.Unlock();
+
+		snapshots_[build_idx_].Clear();
+	}
+
+	void FramePipeline::HandoverVertex(const SceneActor* owner, const void* data, size_t size)
+	{
+		ASSERT(owner);
+
+		handover_owners_.insert(owner);
+
+		FrameSnapshot& snapshot = snapshots_[build_idx_];
+
+		FrameSnapshot::VertexUpload upload;
+		upload.owner = owner;
+		upload.offset = snapshot.vertex_data_.size();
+		upload.size = size;
+		upload.is_release = false;
+
+		if (size > 0)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			snapshot.vertex_data_.insert(snapshot.vertex_data_.end(), bytes, bytes + size);
+		}
+
+		snapshot.vertex_uploads_.push_back(upload);
+	}
+
+	void FramePipeline::ReleaseVertex(const SceneActor* owner)
+	{
+		if (handover_owners_.erase(owner) == 0)
+			return;
+
+		FrameSnapshot::VertexUpload upload;
+		upload.owner = owner;
+		upload.offset = upload.size = 0;
+		upload.is_release = true;
+
+		snapshots_[build_idx_].vertex_uploads_.push_back(upload);
+	}
+
+	void FramePipeline::ReleaseRenderData(RenderData& data)
+	{
+		FrameSnapshot& snapshot = snapshots_[build_idx_];
+
+		if (data.index_buffer != 0)
+		{
+			snapshot.release_buffers_.push_back(data.index_buffer);
+			data.index_buffer = 0;
+		}
+		if (data.vertex_buffer != 0)
+		{
+			snapshot.release_buffers_.push_back(data.vertex_buffer);
+			data.vertex_buffer = 0;
+		}
+	}
+
+	void FramePipeline::Resize(int backing_width, int backing_height)
+	{
+		FrameSnapshot& snapshot = snapshots_[build_idx_];
+		snapshot.resize_width_ = backing_width;
+		snapshot.resize_height_ = backing_height;
+	}
+
+	bool FramePipeline::Render(Renderer* renderer)
+	{
+		mutex_.Lock();
+
+		while (ready_idx_ < 0 && !is_quit_)
+			cond_.Wait(mutex_);
+
+		if (is_quit_)
+		{
+			mutex_.Unlock();
+			return false;
+		}
+
+		rendering_idx_ = ready_idx_;
+		ready_idx_ = -1;
+
+		cond_.NotifyAll();
+
+		mutex_.Unlock();
+
+		FrameSnapshot& snapshot = snapshots_[rendering_idx_];
+
+		renderer_mutex_.Lock();
+
+		// previous snapshot which may use released buffers is done
+
+		ApplyRelease(snapshot);
+		ApplyVertexUpload(snapshot);
+
+		// renderer is resized on update thread, only viewport of this context is left
+		if (snapshot.resize_width_ > 0)
+		{
+			glViewport(0, 0, snapshot.resize_width_, snapshot.resize_height_);
+			glScissor(0, 0, snapshot.resize_width_, snapshot.resize_height_);
+		}
+
+		if (renderer->IsReadyToRender())
+		{
+			renderer->RenderStart();
+			RenderSnapshot(snapshot, renderer);
+			renderer->RenderEnd();
+			renderer->EndFrameStats();
+		}
+
+		RenderStats stats = renderer->stats();
+
+		renderer_mutex_.Unlock();
+
+		mutex_.Lock();
+		rendering_idx_ = -1;
+		stats_ = stats;
+		cond_.NotifyAll();
+		mutex_.Unlock();
+
+		return true;
+	}
+
+	void FramePipeline::LockRenderer()
+	{
+		renderer_mutex_.Lock();
+	}
+
+	void FramePipeline::UnlockRenderer()
+	{
+		renderer_mutex_.Unlock();
+	}
+
+	RenderStats FramePipeline::GetStats()
+	{
+		mutex_.Lock();
+		RenderStats stats = stats_;
+		mutex_.Unlock();
+
+		return stats;
+	}
+
+	void FramePipeline::Quit()
+	{
+		mutex_.Lock();
+		is_quit_ = true;
+		cond_.NotifyAll();
+		mutex_.Unlock();
+	}
+
+	void FramePipeline::ApplyRelease(FrameSnapshot& snapshot)
+	{
+		Renderer* renderer = Root::Ins().renderer();
+
+		size_t buffer_num = snapshot.release_buffers_.size();
+		for (size_t i = 0; i < buffer_num; ++i)
+		{
+			renderer->ReleaseBuffer(snapshot.release_buffers_[i]);
+		}
+		snapshot.release_buffers_.clear();
+	}
+
+	void FramePipeline::ApplyVertexUpload(FrameSnapshot& snapshot)
+	{
+		Renderer* renderer = Root::Ins().renderer();
+
+		size_t num = snapshot.vertex_uploads_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			const FrameSnapshot::VertexUpload& upload = snapshot.vertex_uploads_[i];
+
+			std::map<const SceneActor*, GLuint>::iterator it = vertex_buffers_.find(upload.owner);
+
+			if (upload.is_release)
+			{
+				if (it != vertex_buffers_.end())
+				{
+					renderer->ReleaseBuffer(it->second);
+					vertex_buffers_.erase(it);
+				}
+				continue;
+			}
+
+			if (it == vertex_buffers_.end())
+			{
+				GLuint buffer = renderer->GenerateBuffer();
+				it = vertex_buffers_.insert(std::make_pair(upload.owner, buffer)).first;
+			}
+
+			renderer->UpdateBuffer(it->second, BUFFER_VERTEX, upload.size > 0 ? &snapshot.vertex_data_[upload.offset] : NULL, static_cast<int>(upload.size), BUFFER_USAGE_DYNAMIC);
+		}
+	}
+
+	void FramePipeline::RenderSnapshot(FrameSnapshot& snapshot, Renderer* renderer)
+	{
+		// textures may be created on update thread, binding cache of renderer is not reliable
+		renderer->InvalidateTextureBinding();
+
+		size_t layer_num = snapshot.layers_.size();
+		for (size_t i = 0; i < layer_num; ++i)
+		{
+			const FrameLayer& layer = snapshot.layers_[i];
+
+			if (layer.is_clear_depth)
+				renderer->ClearDepth();
+
+			if (layer.is_default_view)
+			{
+				renderer->UpdateOrthoProjection(1, -1000, 1000);
+				renderer->UpdateView(Vector3(0, 0, 0), Vector3(0, 0, -1), Vector3(0, 1, 0));
+			}
+			else
+			{
+				renderer->UpdateProjection(layer.projection_matrix);
+				renderer->UpdateView(layer.view_matrix);
+			}
+
+			int now_pass = -1;
+
+			for (int j = layer.packet_begin; j < layer.packet_end; ++j)
+			{
+				FramePacket& packet = snapshot.packets_[j];
+
+				if (packet.pass != now_pass)
+				{
+					if (now_pass == PASS_ALPHA_TEST)
+						renderer->EnableAlphaTest(false);
+
+					renderer->EnableBlend(packet.pass != PASS_OPAQUE);
+
+					if (packet.pass == PASS_ALPHA_TEST)
+						renderer->EnableAlphaTest(true);
+
+					now_pass = packet.pass;
+				}
+
+				if (!vertex_buffers_.empty())
+				{
+					std::map<const SceneActor*, GLuint>::iterator it = vertex_buffers_.find(packet.owner);
+					if (it != vertex_buffers_.end())
+					{
+						packet.render_data->vertex_buffer = it->second;
+						packet.render_data->vertex_offset = 0;
+					}
+				}
+
+#ifdef ERI_RENDERER_ES2
+				if (Root::Ins().shader_mgr())
+					Root::Ins().shader_mgr()->Use(*packet.render_data);
+#endif
+
+				renderer->EnableMaterial(packet.material);
+				renderer->SaveTransform();
+				renderer->Render(packet.render_data);
+				renderer->RecoverTransform();
+			}
+
+			if (now_pass == PASS_ALPHA_TEST)
+				renderer->EnableAlphaTest(false);
+		}
+	}
+
+#pragma mark RendererLock
+
+	RendererLock::RendererLock() : pipeline_(Root::Ins().frame_pipeline())
+	{
+		if (pipeline_) pipeline_->LockRenderer();
+	}
+
+	RendererLock::~RendererLock()
+	{
+		if (pipeline_) pipeline_->UnlockRenderer();
+	}
+}
@@ -0,0 +1,163 @@
+//
+//  frame_pipeline.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_FRAME_PIPELINE_H
+#define ERI_FRAME_PIPELINE_H
+
+#include "pch.h"
+
+#include <vector>
+#include <map>
+#include <set>
+
+#include "math_helper.h"
+#include "render_queue.h"
+#include "renderer.h"
+#include "thread_helper.h"
+
+namespace ERI
+{
+	class Renderer;
+	class CameraActor;
+	struct RenderData;
+	struct MaterialData;
+
+	struct FramePacket
+	{
+		RenderPass			pass;
+		const SceneActor*	owner;
+		RenderData*			render_data;
+		MaterialData*		material;
+	};
+
+	struct FrameLayer
+	{
+		Matrix4	view_matrix;
+		Matrix4	projection_matrix;
+		bool	is_default_view;
+		bool	is_clear_depth;
+		int		packet_begin, packet_end;
+	};
+
+	// Copy of everything one frame draws, render data and material are copied by value
+	// so update thread is free to change actors while render thread draws this.
+
+	class FrameSnapshot
+	{
+	public:
+		FrameSnapshot();
+		~FrameSnapshot();
+
+		void Clear();
+
+		void AddLayer(CameraActor* cam, bool is_clear_depth);
+		void AddPackets(const RenderQueue* queue);
+
+	private:
+		friend class FramePipeline;
+
+		struct VertexUpload
+		{
+			const SceneActor*	owner;
+			size_t				offset;
+			size_t				size;
+			bool				is_release;
+		};
+
+		std::vector<FrameLayer>		layers_;
+		std::vector<FramePacket>	packets_;
+
+		// reused between frames
+		std::vector<RenderData*>	render_data_pool_;
+		std::vector<MaterialData*>	material_pool_;
+
+		std::vector<VertexUpload>	vertex_uploads_;
+		std::vector<unsigned char>	vertex_data_;
+
+		std::vector<GLuint>			release_buffers_;
+
+		int		resize_width_, resize_height_;
+	};
+
+	// Pipelined update and render.
+	// Update thread builds snapshot and submits it, render thread owning GL context draws previous one,
+	// two snapshots are swapped between them.
+	//
+	// Update thread should have a context shared with render one, static resources are still created there.
+	// Dynamic vertex data has to be handed over instead of uploaded directly,
+	// and buffers of released render data are deleted on render thread after it won't draw them.
+	//
+	// Renderer state is shared by both threads, render thread holds renderer lock while drawing a snapshot,
+	// update thread holds it around direct renderer calls, see RendererLock.
+
+	class FramePipeline
+	{
+	public:
+		FramePipeline();
+		~FramePipeline();
+
+		// update thread
+
+		inline FrameSnapshot* build_snapshot() { return &snapshots_[build_idx_]; }
+
+		void Submit();
+
+		void HandoverVertex(const SceneActor* owner, const void* data, size_t size);
+		void ReleaseVertex(const SceneActor* owner);
+		void ReleaseRenderData(RenderData& data);
+		void Resize(int backing_width, int backing_height);
+
+		void LockRenderer();
+		void UnlockRenderer();
+
+		// of last rendered frame, renderer stats are written by render thread
+		RenderStats GetStats();
+
+		// render thread, return false after quit,
+		// snapshot is drawn at full resolution, dynamic resolution and layer cache are not applied
+
+		bool Render(Renderer* renderer);
+
+		void Quit();
+
+	private:
+		void ApplyRelease(FrameSnapshot& snapshot);
+		void ApplyVertexUpload(FrameSnapshot& snapshot);
+		void RenderSnapshot(FrameSnapshot& snapshot, Renderer* renderer);
+
+		FrameSnapshot	snapshots_[2];
+		int				build_idx_;
+		int				ready_idx_;
+		int				rendering_idx_;
+		bool			is_quit_;
+
+		Mutex			mutex_;
+		Condition		cond_;
+
+		Mutex			renderer_mutex_;
+		RenderStats		stats_;
+
+		std::set<const SceneActor*>			handover_owners_;
+		std::map<const SceneActor*, GLuint>	vertex_buffers_;
+	};
+
+	// Hold renderer lock of pipeline in scope, nothing if not pipelined.
+	// For update thread code calling renderer, not nested.
+
+	class RendererLock
+	{
+	public:
+		RendererLock();
+		~RendererLock();
+
+	private:
+		FramePipeline*	pipeline_;
+	};
+}
+
+#endif // ERI_FRAME_PIPELINE_H
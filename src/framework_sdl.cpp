@@ -12,6 +12,7 @@
 
 #include "root.h"
 #include "renderer.h"
+#include "frame_pipeline.h"
 #include "input_mgr.h"
 
 static ERI::InputKeyCode TranslateKeyCode(int event_key_code)
@@ -155,6 +156,11 @@ Framework::Framework(int window_width, int window_height, const char* title /*=
   fullscreen_type_(0),
   log_fps_(false)
 {
+#ifdef ERI_USE_SDL_THREAD
+  update_context_ = NULL;
+  render_thread_ = NULL;
+#endif
+
   ASSERT(window_width_ > 0 && window_height_ > 0);
   ASSERT((flags & (FULL_SCREEN | FULL_SCREEN_DESKTOP)) != (FULL_SCREEN | FULL_SCREEN_DESKTOP));
 
@@ -216,6 +222,10 @@ Framework::Framework(int window_width, int window_height, const char* title /*=
 
 Framework::~Framework()
 {
+#ifdef ERI_USE_SDL_THREAD
+  StopPipeline();
+#endif
+  
   ERI::Root::DestroyIns();
   
 #ifdef ERI_USE_SDL_GAME_CONTROLLER
@@ -233,7 +243,7 @@ Framework::~Framework()
 
 void Framework::Run()
 {
-  ERI::Root::Ins().renderer()->Resize(current_width_, current_height_);
+  ResizeRenderer();
   is_running_ = true;
 }
 
@@ -258,7 +268,7 @@ float Framework::PreUpdate()
                     event.window.data2);
             current_width_ = event.window.data1;
             current_height_ = event.window.data2;
-            ERI::Root::Ins().renderer()->Resize(current_width_, current_height_);
+            ResizeRenderer();
             break;
             
           case SDL_WINDOWEVENT_CLOSE:
@@ -579,6 +589,15 @@ float Framework::PreUpdate()
 
 void Framework::PostUpdate()
 {
+#ifdef ERI_USE_SDL_THREAD
+  if (render_thread_)
+  {
+    ERI::Root::Ins().SubmitFrame(); // render thread swaps
+    SDL_Delay(10);
+    return;
+  }
+#endif
+  
   ERI::Root::Ins().Update();
   
   SDL_GL_SwapWindow(window_); // Swap the window/buffer to display the result.
@@ -601,8 +620,99 @@ void* Framework::CreateThread(int (*thread_func)(void*), const char* name, void*
 
   return thread;
 }
+
+bool Framework::StartPipeline()
+{
+  if (render_thread_)
+    return true;
+  
+  // shared context for resources created by update
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+  update_context_ = SDL_GL_CreateContext(window_);
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+  
+  if (NULL == update_context_)
+  {
+    LOGW("Could not create shared context: %s", SDL_GetError());
+    return false;
+  }
+  
+  ERI::Root::Ins().EnablePipeline(true);
+  
+  if (NULL == ERI::Root::Ins().frame_pipeline())
+  {
+    SDL_GL_MakeCurrent(window_, context_);
+    SDL_GL_DeleteContext(update_context_);
+    update_context_ = NULL;
+    return false;
+  }
+  
+  // context can be current in one thread only, render thread makes it current by itself
+  SDL_GL_MakeCurrent(window_, update_context_);
+  
+  render_thread_ = static_cast<SDL_Thread*>(CreateThread(RenderThreadMain, "render", this));
+  
+  if (NULL == render_thread_)
+  {
+    SDL_GL_MakeCurrent(window_, context_);
+    ERI::Root::Ins().EnablePipeline(false);
+    SDL_GL_DeleteContext(update_context_);
+    update_context_ = NULL;
+    return false;
+  }
+  
+  return true;
+}
+
+void Framework::StopPipeline()
+{
+  if (NULL == render_thread_)
+    return;
+  
+  ERI::Root::Ins().frame_pipeline()->Quit();
+  SDL_WaitThread(render_thread_, NULL);
+  render_thread_ = NULL;
+  
+  SDL_GL_MakeCurrent(window_, context_);
+  
+  ERI::Root::Ins().EnablePipeline(false);
+  
+  SDL_GL_DeleteContext(update_context_);
+  update_context_ = NULL;
+}
+
+int Framework::RenderThreadMain(void* data)
+{
+  Framework* framework = static_cast<Framework*>(data);
+  
+  SDL_GL_MakeCurrent(framework->window_, framework->context_);
+  
+  while (ERI::Root::Ins().RenderFrame())
+  {
+    SDL_GL_SwapWindow(framework->window_);
+  }
+  
+  SDL_GL_MakeCurrent(framework->window_, NULL);
+  
+  return 0;
+}
 #endif
 
+void Framework::ResizeRenderer()
+{
+  ERI::Renderer* renderer = ERI::Root::Ins().renderer();
+  
+  {
+    ERI::RendererLock lock;
+    renderer->Resize(current_width_, current_height_);
+  }
+  
+#ifdef ERI_USE_SDL_THREAD
+  if (ERI::Root::Ins().frame_pipeline())
+    ERI::Root::Ins().frame_pipeline()->Resize(renderer->backing_width(), renderer->backing_height());
+#endif
+}
+
 void Framework::LogFPS(bool enable)
 {
   log_fps_ = enable;
@@ -625,7 +735,7 @@ void Framework::ToggleFullscreen()
     {
       SDL_SetWindowSize(window_, window_width_, window_height_);
       SDL_GetWindowSize(window_, &current_width_, &current_height_);
-      ERI::Root::Ins().renderer()->Resize(current_width_, current_height_);
+      ResizeRenderer();
     }
     else
     {
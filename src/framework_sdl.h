@@ -46,6 +46,10 @@ public:
   
 #ifdef ERI_USE_SDL_THREAD
   void* CreateThread(int (*thread_func)(void*), const char* name, void* data);
+  
+  // render on another thread owning window context, calling thread keeps a shared context for resources
+  bool StartPipeline();
+  void StopPipeline();
 #endif
   
   void LogFPS(bool enable);
@@ -57,6 +61,15 @@ public:
   inline bool is_fullscreen() { return is_fullscreen_; }
   
 private:
+  void ResizeRenderer();
+  
+#ifdef ERI_USE_SDL_THREAD
+  static int RenderThreadMain(void* data);
+  
+  SDL_GLContext update_context_;
+  SDL_Thread* render_thread_;
+#endif
+  
 #ifdef ERI_USE_SDL_GAME_CONTROLLER
   void AddGameController(SDL_GameController* game_controller);
   
@@ -0,0 +1,236 @@
+//
+//  geometry_pool.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "geometry_pool.h"
+
+#include "root.h"
+#include "frame_pipeline.h"
+
+namespace ERI
+{
+	static const int kPageSize = 256 * 1024;
+	static const int kAllocAlign = 16;
+
+	// frames a freed range may still be drawn, same as frames in flight
+	static const unsigned int kFreeDelay = 3;
+
+	struct GeometryPage
+	{
+		GLuint	buffer;
+		BufferType	type;
+		int		slot;
+		int		size;
+		int		used_size;
+
+		// offset -> size, ordered for merging neighbors
+		std::map<int, int>	free_ranges;
+	};
+
+	GeometryPool::GeometryPool() :
+		frame_(0),
+		used_size_(0)
+	{
+	}
+
+	GeometryPool::~GeometryPool()
+	{
+		for (int i = 0; i <= VERTEX_FORMAT_MAX; ++i)
+		{
+			for (size_t j = 0; j < pages_[i].size(); ++j)
+			{
+				Root::Ins().renderer()->ReleaseBuffer(pages_[i][j]->buffer);
+				delete pages_[i][j];
+			}
+		}
+	}
+
+	bool GeometryPool::AllocVertex(VertexFormat format, const void* vertices, int size, GeometryRange& out_range)
+	{
+		ASSERT(format >= 0 && format < VERTEX_FORMAT_MAX);
+
+		return Alloc(format, BUFFER_VERTEX, vertices, size, out_range);
+	}
+
+	bool GeometryPool::AllocIndex(const void* indices, int size, GeometryRange& out_range)
+	{
+		return Alloc(VERTEX_FORMAT_MAX, BUFFER_INDEX, indices, size, out_range);
+	}
+
+	void GeometryPool::Free(GeometryRange& range)
+	{
+		if (NULL == range.page)
+			return;
+
+		PendingFree pending;
+		pending.range = range;
+		pending.frame = frame_;
+		pending_frees_.push_back(pending);
+
+		range = GeometryRange();
+	}
+
+	void GeometryPool::NextFrame()
+	{
+		++frame_;
+
+		size_t num = pending_frees_.size();
+		size_t keep = 0;
+		for (size_t i = 0; i < num; ++i)
+		{
+			if (frame_ - pending_frees_[i].frame >= kFreeDelay)
+				Release(pending_frees_[i].range);
+			else
+				pending_frees_[keep++] = pending_frees_[i];
+		}
+
+		pending_frees_.resize(keep);
+	}
+
+	int GeometryPool::GetBufferNum() const
+	{
+		int num = 0;
+		for (int i = 0; i <= VERTEX_FORMAT_MAX; ++i)
+		{
+			num += static_cast<int>(pages_[i].size());
+		}
+
+		return num;
+	}
+
+	bool GeometryPool::Alloc(int slot, BufferType type, const void* data, int size, GeometryRange& out_range)
+	{
+		ASSERT(size > 0);
+
+		int aligned_size = (size + kAllocAlign - 1) & ~(kAllocAlign - 1);
+
+		std::vector<GeometryPage*>& pages = pages_[slot];
+
+		GeometryPage* page = NULL;
+		std::map<int, int>::iterator it;
+
+		// first fit
+
+		for (size_t i = 0; i < pages.size() && !page; ++i)
+		{
+			for (it = pages[i]->free_ranges.begin(); it != pages[i]->free_ranges.end(); ++it)
+			{
+				if (it->second >= aligned_size)
+				{
+					page = pages[i];
+					break;
+				}
+			}
+		}
+
+		if (!page)
+		{
+			page = new GeometryPage;
+			page->type = type;
+			page->slot = slot;
+			page->size = aligned_size > kPageSize ? aligned_size : kPageSize;
+			page->used_size = 0;
+			page->free_ranges[0] = page->size;
+
+			Renderer* renderer = Root::Ins().renderer();
+
+			RendererLock lock;
+
+			page->buffer = renderer->GenerateBuffer();
+			if (0 == page->buffer)
+			{
+				LOGW("geometry pool create buffer failed");
+				delete page;
+				return false;
+			}
+
+			renderer->UpdateBuffer(page->buffer, type, NULL, page->size, BUFFER_USAGE_STATIC);
+
+			pages.push_back(page);
+
+			it = page->free_ranges.begin();
+		}
+
+		int offset = it->first;
+		int remain_size = it->second - aligned_size;
+
+		page->free_ranges.erase(it);
+		if (remain_size > 0)
+			page->free_ranges[offset + aligned_size] = remain_size;
+
+		page->used_size += aligned_size;
+		used_size_ += aligned_size;
+
+		{
+			RendererLock lock;
+			Root::Ins().renderer()->UpdateBufferRange(page->buffer, type, offset, data, size);
+		}
+
+		out_range.buffer = page->buffer;
+		out_range.offset = offset;
+		out_range.size = aligned_size;
+		out_range.page = page;
+
+		return true;
+	}
+
+	void GeometryPool::Release(const GeometryRange& range)
+	{
+		GeometryPage* page = range.page;
+
+		int offset = range.offset;
+		int size = range.size;
+
+		// merge with neighbors
+
+		std::map<int, int>::iterator next = page->free_ranges.lower_bound(offset);
+		if (next != page->free_ranges.end() && next->first == offset + size)
+		{
+			size += next->second;
+			page->free_ranges.erase(next++);
+		}
+
+		if (next != page->free_ranges.begin())
+		{
+			std::map<int, int>::iterator prev = next;
+			--prev;
+			if (prev->first + prev->second == offset)
+			{
+				offset = prev->first;
+				size += prev->second;
+				page->free_ranges.erase(prev);
+			}
+		}
+
+		page->free_ranges[offset] = size;
+
+		page->used_size -= range.size;
+		used_size_ -= range.size;
+
+		if (0 == page->used_size)
+		{
+			std::vector<GeometryPage*>& pages = pages_[page->slot];
+			for (size_t i = 0; i < pages.size(); ++i)
+			{
+				if (pages[i] == page)
+				{
+					pages.erase(pages.begin() + i);
+					break;
+				}
+			}
+
+			{
+				RendererLock lock;
+				Root::Ins().renderer()->ReleaseBuffer(page->buffer);
+			}
+
+			delete page;
+		}
+	}
+}
@@ -0,0 +1,80 @@
+//
+//  geometry_pool.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_GEOMETRY_POOL_H
+#define ERI_GEOMETRY_POOL_H
+
+#include "pch.h"
+
+#include <vector>
+#include <map>
+
+#include "render_data.h"
+#include "renderer.h"
+
+namespace ERI
+{
+	struct GeometryPage;
+
+	struct GeometryRange
+	{
+		GeometryRange() : buffer(0), offset(0), size(0), page(NULL) {}
+
+		GLuint			buffer;
+		int				offset;	// in bytes
+		int				size;
+		GeometryPage*	page;
+	};
+
+	// Static vertices and indices sub-allocated from few large buffers,
+	// one set of buffers per vertex format so data of same format can share vertex setup.
+	//
+	// Freed ranges are reused after frames in flight are done with them,
+	// adjacent free ranges are merged and buffers become empty are deleted.
+
+	class GeometryPool
+	{
+	public:
+		GeometryPool();
+		~GeometryPool();
+
+		bool AllocVertex(VertexFormat format, const void* vertices, int size, GeometryRange& out_range);
+		bool AllocIndex(const void* indices, int size, GeometryRange& out_range);
+
+		// range is reset
+		void Free(GeometryRange& range);
+
+		// call once per frame
+		void NextFrame();
+
+		int GetBufferNum() const;
+
+		// bytes in use
+		inline int used_size() const { return used_size_; }
+
+	private:
+		struct PendingFree
+		{
+			GeometryRange	range;
+			unsigned int	frame;
+		};
+
+		bool Alloc(int slot, BufferType type, const void* data, int size, GeometryRange& out_range);
+		void Release(const GeometryRange& range);
+
+		// slot per vertex format and last one for indices
+		std::vector<GeometryPage*>	pages_[VERTEX_FORMAT_MAX + 1];
+
+		std::vector<PendingFree>	pending_frees_;
+
+		unsigned int	frame_;
+		int				used_size_;
+	};
+}
+
+#endif // ERI_GEOMETRY_POOL_H
@@ -30,6 +30,11 @@ namespace ERI
 		return path;
 	}
 
+	std::string GetWritePath()
+	{
+		return GetHomePath();
+	}
+
 	int GetUnicodeFromUTF8(const std::string& str, int max_buff_length, uint32_t* buff)
 	{
 		iconv_t cd = iconv_open("UTF-32LE", "UTF-8");
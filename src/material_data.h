@@ -36,8 +36,9 @@ namespace ERI {
 	struct ColorFlags
 	{
 		ColorFlags() : r(true), g(true), b(true), a(true) {}
+		explicit ColorFlags(bool enable) : r(enable), g(enable), b(enable), a(enable) {}
 		
-		inline bool operator == (const ColorFlags& rhs)
+		inline bool operator == (const ColorFlags& rhs) const
 		{
 			return (r == rhs.r &&
 					g == rhs.g &&
@@ -45,7 +46,7 @@ namespace ERI {
 					a == rhs.a);
 		}
 		
-		inline bool operator != (const ColorFlags& rhs)
+		inline bool operator != (const ColorFlags& rhs) const
 		{
 			return (r != rhs.r ||
 					g != rhs.g ||
@@ -93,6 +94,45 @@ namespace ERI {
 			return texture_id;
 		}
 		
+		// same textures and states, so batches can draw with one of them,
+		// combine mode and constant color are never batched
+		bool IsSameState(const MaterialData& other) const
+		{
+			if (used_unit != other.used_unit ||
+				depth_test != other.depth_test ||
+				depth_write != other.depth_write ||
+				cull_face != other.cull_face ||
+				cull_front != other.cull_front ||
+				accept_light != other.accept_light ||
+				accept_fog != other.accept_fog ||
+				color_write != other.color_write)
+			{
+				return false;
+			}
+			
+			for (int i = 0; i < used_unit; ++i)
+			{
+				const TextureUnit& ua = texture_units[i];
+				const TextureUnit& ub = other.texture_units[i];
+				
+				if (ua.texture != ub.texture ||
+					ua.coord_idx != ub.coord_idx ||
+					ua.params.filter_min != ub.params.filter_min ||
+					ua.params.filter_mag != ub.params.filter_mag ||
+					ua.params.wrap_s != ub.params.wrap_s ||
+					ua.params.wrap_t != ub.params.wrap_t ||
+					ua.envs.mode != ub.envs.mode ||
+					ua.envs.mode == MODE_COMBINE ||
+					ua.envs.is_use_constant_color ||
+					ub.envs.is_use_constant_color)
+				{
+					return false;
+				}
+			}
+			
+			return true;
+		}
+		
 		TextureUnit		texture_units[MAX_TEXTURE_UNIT];
 		int				used_unit;
 
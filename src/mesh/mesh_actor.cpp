@@ -11,6 +11,8 @@
 
 #include "mesh_actor.h"
 
+#include "root.h"
+#include "renderer.h"
 #include "collada_loader.h"
 
 namespace ERI
@@ -25,13 +27,13 @@ namespace ERI
 	{
 	}
 	
+	bool MeshActor::IsMultiDrawable()
+	{
+		return vertex_range_.page && index_range_.page && render_data_.index_count > 0;
+	}
+	
 	void MeshActor::UpdateVertexBuffer(MeshLoader* loader)
 	{
-		if (render_data_.vertex_buffer == 0)
-		{
-			glGenBuffers(1, &render_data_.vertex_buffer);
-		}
-		
 		int vertex_buffer_size = loader->GetVertexBufferSize();
 		
 		ASSERT(vertex_buffer_size > 0);
@@ -39,28 +41,43 @@ namespace ERI
 		void* vertex_buffer = malloc(vertex_buffer_size);
 		render_data_.vertex_count = loader->FillVertexBuffer(vertex_buffer);
 		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size, vertex_buffer, GL_STATIC_DRAW);
+		loader->GetVertexInfo(render_data_.vertex_type, render_data_.vertex_format);
+		
+		VertexFormat packed_format = VERTEX_FORMAT_MAX;
+		if (Root::Ins().renderer()->caps().is_support_packed_vertex)
+			packed_format = GetPackedVertexFormat(render_data_.vertex_format);
+		
+		if (packed_format != VERTEX_FORMAT_MAX)
+		{
+			int packed_buffer_size = GetVertexSize(packed_format) * render_data_.vertex_count;
+			void* packed_buffer = malloc(packed_buffer_size);
+			
+			if (PackVertices(render_data_.vertex_format, vertex_buffer, render_data_.vertex_count, packed_buffer))
+			{
+				free(vertex_buffer);
+				vertex_buffer = packed_buffer;
+				vertex_buffer_size = packed_buffer_size;
+				render_data_.vertex_format = packed_format;
+			}
+			else
+			{
+				free(packed_buffer);
+			}
+		}
+		
+		UpdateStaticVertex(vertex_buffer, vertex_buffer_size);
 		
 		free(vertex_buffer);
-
-		loader->GetVertexInfo(render_data_.vertex_type, render_data_.vertex_format);
 		
 		//
 		
 		int index_buffer_size = loader->GetIndexBufferSize();
 		if (index_buffer_size > 0)
 		{
-			if (render_data_.index_buffer == 0)
-			{
-				glGenBuffers(1, &render_data_.index_buffer);
-			}
-			
 			void* index_buffer = malloc(index_buffer_size);
 			render_data_.index_count = loader->FillIndexBuffer(index_buffer);
 			
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, render_data_.index_buffer);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_size, index_buffer, GL_STATIC_DRAW);
+			UpdateStaticIndex(index_buffer, index_buffer_size);
 			
 			free(index_buffer);
 		}
@@ -22,6 +22,8 @@ namespace ERI
 		MeshActor(MeshLoader* loader);
 		virtual ~MeshActor();
 		
+		virtual bool IsMultiDrawable();
+		
 	private:
 		void UpdateVertexBuffer(MeshLoader* loader);
 	};
@@ -11,6 +11,8 @@
 
 #include <fstream>
 
+#include "root.h"
+
 namespace ERI
 {
 	
@@ -350,7 +352,8 @@ namespace ERI
 #pragma mark SkeletonActor
 
 	SkeletonActor::SkeletonActor(const SharedSkeleton* resource_ref) :
-		vertex_buffer_(NULL)
+		vertex_buffer_(NULL),
+		packed_vertex_buffer_(NULL)
 	{
 		skeleton_ins_ = new SkeletonIns(resource_ref);
 		
@@ -370,6 +373,11 @@ namespace ERI
 			free(vertex_buffer_);
 		}
 		
+		if (packed_vertex_buffer_)
+		{
+			free(packed_vertex_buffer_);
+		}
+		
 		delete skeleton_ins_;
 	}
 	
@@ -383,6 +391,12 @@ namespace ERI
 			vertex_buffer_ = NULL;
 		}
 		
+		if (packed_vertex_buffer_)
+		{
+			free(packed_vertex_buffer_);
+			packed_vertex_buffer_ = NULL;
+		}
+		
 		float time_percent = skeleton_ins_->GetTimePercent();
 		
 		delete skeleton_ins_;
@@ -469,11 +483,6 @@ namespace ERI
 	
 	void SkeletonActor::UpdateVertexBuffer()
 	{
-		if (render_data_.vertex_buffer == 0)
-		{
-			glGenBuffers(1, &render_data_.vertex_buffer);
-		}
-		
 		if (!vertex_buffer_)
 		{
 			vertex_buffer_size_ = skeleton_ins_->GetVertexBufferSize();
@@ -487,10 +496,31 @@ namespace ERI
 		
 		render_data_.vertex_count = skeleton_ins_->FillVertexBuffer(vertex_buffer_);
 		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size_, vertex_buffer_, GL_DYNAMIC_DRAW);
-	
 		skeleton_ins_->GetVertexInfo(render_data_.vertex_type, render_data_.vertex_format);
+		
+		VertexFormat packed_format = VERTEX_FORMAT_MAX;
+		if (Root::Ins().renderer()->caps().is_support_packed_vertex)
+			packed_format = GetPackedVertexFormat(render_data_.vertex_format);
+		
+		if (packed_format != VERTEX_FORMAT_MAX)
+		{
+			if (!packed_vertex_buffer_)
+			{
+				packed_vertex_buffer_size_ = GetVertexSize(packed_format) * render_data_.vertex_count;
+				packed_vertex_buffer_ = malloc(packed_vertex_buffer_size_);
+				
+				ASSERT(packed_vertex_buffer_);
+			}
+			
+			if (PackVertices(render_data_.vertex_format, vertex_buffer_, render_data_.vertex_count, packed_vertex_buffer_))
+			{
+				render_data_.vertex_format = packed_format;
+				UpdateDynamicVertex(packed_vertex_buffer_, packed_vertex_buffer_size_);
+				return;
+			}
+		}
+		
+		UpdateDynamicVertex(vertex_buffer_, vertex_buffer_size_);
 	}
 
 }
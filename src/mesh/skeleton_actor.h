@@ -145,6 +145,10 @@ namespace ERI
 		
 		void*			vertex_buffer_;
 		int				vertex_buffer_size_;
+		
+		// skinned vertices converted to packed format for upload
+		void*			packed_vertex_buffer_;
+		int				packed_vertex_buffer_size_;
 
 		AnimSetting		curr_anim_, next_anim_;
 		bool			recover_loop_;
@@ -0,0 +1,130 @@
+//
+//  mesh_batch.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "mesh_batch.h"
+
+#include "root.h"
+#include "scene_actor.h"
+
+#ifdef ERI_RENDERER_ES2
+#include "shader_mgr.h"
+#endif
+
+namespace ERI
+{
+	MeshBatch::MeshBatch() : actor_num_(0)
+	{
+	}
+
+	MeshBatch::~MeshBatch()
+	{
+	}
+
+	void MeshBatch::Add(SceneActor* actor, Renderer* renderer)
+	{
+		ASSERT(actor);
+
+		if (!IsMultiDrawable(actor))
+		{
+			Flush(renderer);
+			actor->Draw(renderer);
+			return;
+		}
+
+		if (actor_num_ > 0 && (actor_num_ >= Renderer::kMaxMultiDraw || !IsSameState(actor, renderer)))
+			Flush(renderer);
+
+		actors_[actor_num_] = actor;
+		++actor_num_;
+	}
+
+	void MeshBatch::Flush(Renderer* renderer)
+	{
+		if (actor_num_ == 0)
+			return;
+
+		if (actor_num_ == 1)
+		{
+			actors_[0]->Draw(renderer);
+			actor_num_ = 0;
+			return;
+		}
+
+#ifdef ERI_RENDERER_ES2
+		for (int i = 0; i < actor_num_; ++i)
+		{
+			actors_[i]->GetWorldTransform();
+			datas_[i] = &actors_[i]->render_data_;
+		}
+
+		if (Root::Ins().shader_mgr()->UseMultiDraw(actors_[0]->render_data_))
+		{
+			renderer->EnableMaterial(&actors_[0]->material_data_);
+			renderer->RenderMulti(datas_, actor_num_);
+
+			RenderStats& stats = renderer->current_stats();
+			++stats.batch_draw_call;
+			stats.batched_actor += actor_num_;
+		}
+		else
+#endif
+		{
+			for (int i = 0; i < actor_num_; ++i)
+			{
+				actors_[i]->Draw(renderer);
+			}
+		}
+
+		actor_num_ = 0;
+	}
+
+	bool MeshBatch::IsMultiDrawable(SceneActor* actor)
+	{
+#ifdef ERI_RENDERER_ES2
+		// fog and tex transform need per draw uniforms, custom program has no multi draw variant
+		return actor->IsMultiDrawable() &&
+			NULL != Root::Ins().shader_mgr() &&
+			NULL == actor->render_data_.program &&
+			!actor->render_data_.apply_identity_model_matrix &&
+			!actor->render_data_.is_tex_transform &&
+			!actor->material_data_.accept_fog;
+#else
+		return false;
+#endif
+	}
+
+	bool MeshBatch::IsSameState(SceneActor* actor, Renderer* renderer)
+	{
+		const RenderData& a = actors_[0]->render_data_;
+		const RenderData& b = actor->render_data_;
+
+		if (a.vertex_buffer != b.vertex_buffer ||
+			a.index_buffer != b.index_buffer ||
+			a.vertex_format != b.vertex_format ||
+			a.vertex_type != b.vertex_type)
+		{
+			return false;
+		}
+
+		// base vertex draws share attribute setup of first one
+		if (renderer->caps().is_support_multi_draw)
+		{
+			int vertex_size = GetVertexSize(a.vertex_format);
+			if (a.vertex_offset % vertex_size != b.vertex_offset % vertex_size)
+				return false;
+		}
+
+		// color of first one is used if not from vertices
+		if (!IsVertexColorFormat(a.vertex_format) && a.color != b.color)
+			return false;
+
+		return a.IsSameState(b) && actors_[0]->material_data_.IsSameState(actor->material_data_);
+	}
+}
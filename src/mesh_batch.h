@@ -0,0 +1,43 @@
+//
+//  mesh_batch.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_MESH_BATCH_H
+#define ERI_MESH_BATCH_H
+
+#include "renderer.h"
+
+namespace ERI
+{
+	class SceneActor;
+
+	// Collect static indexed meshes which share vertex buffer, index buffer and render state,
+	// which is the case for meshes of same vertex format in geometry pool, and draw them by
+	// Renderer::RenderMulti, world transforms go to a uniform array of a multi draw shader variant.
+	// Needs shader manager with variant template, meshes draw one by one otherwise.
+
+	class MeshBatch
+	{
+	public:
+		MeshBatch();
+		~MeshBatch();
+
+		// actor should be visible and in frustum
+		void Add(SceneActor* actor, Renderer* renderer);
+		void Flush(Renderer* renderer);
+
+	private:
+		bool IsMultiDrawable(SceneActor* actor);
+		bool IsSameState(SceneActor* actor, Renderer* renderer);
+
+		SceneActor*			actors_[Renderer::kMaxMultiDraw];
+		const RenderData*	datas_[Renderer::kMaxMultiDraw];
+		int					actor_num_;
+	};
+}
+
+#endif // ERI_MESH_BATCH_H
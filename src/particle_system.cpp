@@ -10,7 +10,9 @@
 #include "pch.h"
 
 #include "particle_system.h"
+#include "root.h"
 #include "scene_mgr.h"
+#include "frame_pipeline.h"
 #include "sys_helper.h"
 #include "xml_helper.h"
 
@@ -503,6 +505,7 @@ namespace ERI
 		life_(-1.0f),
 		emitter_(NULL),
 		vertices_(NULL),
+		packed_vertices_(NULL),
 		indices_(NULL),
 		lived_time_(-1.0f),
 		delay_timer_(0.0f),
@@ -517,6 +520,7 @@ namespace ERI
 	{
 		if (indices_) delete [] indices_;
 		if (vertices_) delete [] vertices_;
+		if (packed_vertices_) delete [] packed_vertices_;
 		
 		size_t num = particles_.size();
 		for (int i = 0; i < num; ++i)
@@ -924,23 +928,26 @@ namespace ERI
 	{
 		int particle_num = static_cast<int>(particles_.size());
 		
-		if (render_data_.vertex_buffer == 0)
-		{
-			glGenBuffers(1, &render_data_.vertex_buffer);
-		}
-		
 		int vertex_num = particle_num * 4;
 		
 		if (vertices_) delete [] vertices_;
 		vertices_ = new vertex_2_pos_tex2_color[vertex_num];
 		memset(vertices_, 0, sizeof(vertex_2_pos_tex2_color) * vertex_num);
 		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_2_pos_tex2_color) * vertex_num, vertices_, GL_DYNAMIC_DRAW);
+		if (packed_vertices_)
+		{
+			delete [] packed_vertices_;
+			packed_vertices_ = NULL;
+		}
+		
+		if (Root::Ins().renderer()->caps().is_support_packed_vertex)
+			packed_vertices_ = new vertex_2_pos_tex2_color_packed[vertex_num];
+		
+		RendererLock lock;
 		
 		if (render_data_.index_buffer == 0)
 		{
-			glGenBuffers(1, &render_data_.index_buffer);
+			render_data_.index_buffer = Root::Ins().renderer()->GenerateBuffer();
 		}
 		
 		int index_num = particle_num * 6;
@@ -962,24 +969,17 @@ namespace ERI
 			indices_[i * 6 + 5]	= i * 4;
 		}
 		
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, render_data_.index_buffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * index_num, indices_, GL_STATIC_DRAW);
+		Root::Ins().renderer()->UpdateBuffer(render_data_.index_buffer, BUFFER_INDEX, indices_, sizeof(unsigned short) * index_num, BUFFER_USAGE_STATIC);
 		
 		render_data_.vertex_type = GL_TRIANGLES;
 		render_data_.vertex_format = POS_TEX2_COLOR_2;
 		render_data_.vertex_count = 0;
 		render_data_.index_count = 0;
-		
-		// some devices' VAO support works strangely
-#if ERI_PLATFORM == ERI_PLATFORM_ANDROID
-		render_data_.disable_vertex_array = true;
-#endif
 	}
 
 
 	void ParticleSystem::UpdateBuffer()
 	{
-		ASSERT(render_data_.vertex_buffer || render_data_.vertex_count == 0);
 		ASSERT(render_data_.index_buffer || render_data_.index_count == 0);
 		
 		size_t num = particles_.size();
@@ -1065,8 +1065,17 @@ namespace ERI
 			}
 		}
 		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertex_2_pos_tex2_color) * in_use_num * 4, vertices_);
+		// packed vertex halves upload, if uvs fit
+		if (packed_vertices_ && PackVertices(POS_TEX2_COLOR_2, vertices_, in_use_num * 4, packed_vertices_))
+		{
+			render_data_.vertex_format = POS_TEX2_COLOR_2_PACKED;
+			UpdateDynamicVertex(packed_vertices_, sizeof(vertex_2_pos_tex2_color_packed) * in_use_num * 4);
+		}
+		else
+		{
+			render_data_.vertex_format = POS_TEX2_COLOR_2;
+			UpdateDynamicVertex(vertices_, sizeof(vertex_2_pos_tex2_color) * in_use_num * 4);
+		}
 		
 		render_data_.vertex_count = in_use_num * 4;
 		render_data_.index_count = in_use_num * 6;
@@ -494,6 +494,7 @@ namespace ERI
 		int							first_available_particle_idx_;
 		
 		vertex_2_pos_tex2_color*		vertices_;
+		vertex_2_pos_tex2_color_packed*	packed_vertices_;
 		unsigned short*				indices_;
 		
 		Vector2		system_scale_;
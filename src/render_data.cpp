@@ -13,17 +13,19 @@
 
 #include "root.h"
 #include "renderer.h"
+#include "frame_pipeline.h"
 
 namespace ERI {
 	
 	RenderData::RenderData() :
 		disable_vertex_array(false),
-		vertex_array(0),
 		vertex_buffer(0),
+		vertex_offset(0),
 		vertex_type(GL_TRIANGLE_STRIP),
 		vertex_format(POS_TEX_2),
 		vertex_count(0),
 		index_buffer(0),
+		index_offset(0),
 		index_count(0),
 		scale(Vector3(1, 1, 1)),
 		rotate_axis(Vector3(0, 0, 1)),
@@ -47,7 +49,23 @@ namespace ERI {
 	
 	RenderData::~RenderData()
 	{
-		Root::Ins().renderer()->ReleaseRenderData(*this);
+		// render thread may still draw it when pipelined
+		FramePipeline* pipeline = Root::Ins().frame_pipeline();
+		if (pipeline)
+			pipeline->ReleaseRenderData(*this);
+		else
+			Root::Ins().renderer()->ReleaseRenderData(*this);
+	}
+	
+	bool RenderData::IsSameState(const RenderData& other) const
+	{
+		return program == other.program &&
+			blend_src_factor == other.blend_src_factor &&
+			blend_dst_factor == other.blend_dst_factor &&
+			alpha_premultiplied == other.alpha_premultiplied &&
+			alpha_test_func == other.alpha_test_func &&
+			alpha_test_ref == other.alpha_test_ref &&
+			depth_test_func == other.depth_test_func;
 	}
 	
 	void RenderData::UpdateModelMatrix()
@@ -96,4 +114,161 @@ namespace ERI {
 		
 		Matrix4::Inverse(inv_world_model_matrix, world_model_matrix);
 	}
+	
+#pragma mark VertexFormat
+	
+	static inline bool PackUnit(float value, GLushort& out_value)
+	{
+		if (value < 0.0f || value > 1.0f)
+			return false;
+		
+		out_value = static_cast<GLushort>(value * 65535.0f + 0.5f);
+		return true;
+	}
+	
+	static inline void PackNormal(const GLfloat* normal, GLbyte* out_normal)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			float value = normal[i] * 127.0f;
+			out_normal[i] = static_cast<GLbyte>(value >= 0.0f ? value + 0.5f : value - 0.5f);
+		}
+		out_normal[3] = 0;
+	}
+	
+	int GetVertexSize(VertexFormat format)
+	{
+		switch (format)
+		{
+			case POS_TEX_2: return sizeof(vertex_2_pos_tex);
+			case POS_TEX2_2: return sizeof(vertex_2_pos_tex2);
+			case POS_TEX_COLOR_2: return sizeof(vertex_2_pos_tex_color);
+			case POS_TEX2_COLOR_2: return sizeof(vertex_2_pos_tex2_color);
+			case POS_NORMAL_3: return sizeof(vertex_3_pos_normal);
+			case POS_NORMAL_TEX_3: return sizeof(vertex_3_pos_normal_tex);
+			case POS_NORMAL_COLOR_TEX_3: return sizeof(vertex_3_pos_normal_color_tex);
+			case POS_COLOR_TEX_3: return sizeof(vertex_3_pos_color_tex);
+			case POS_TEX_2_PACKED: return sizeof(vertex_2_pos_tex_packed);
+			case POS_TEX2_COLOR_2_PACKED: return sizeof(vertex_2_pos_tex2_color_packed);
+			case POS_NORMAL_3_PACKED: return sizeof(vertex_3_pos_normal_packed);
+			case POS_NORMAL_TEX_3_PACKED: return sizeof(vertex_3_pos_normal_tex_packed);
+			case POS_NORMAL_COLOR_TEX_3_PACKED: return sizeof(vertex_3_pos_normal_color_tex_packed);
+			default:
+				ASSERT(0);
+				return 0;
+		}
+	}
+	
+	bool IsVertexColorFormat(VertexFormat format)
+	{
+		switch (format)
+		{
+			case POS_TEX_COLOR_2:
+			case POS_TEX2_COLOR_2:
+			case POS_NORMAL_COLOR_TEX_3:
+			case POS_COLOR_TEX_3:
+			case POS_TEX2_COLOR_2_PACKED:
+			case POS_NORMAL_COLOR_TEX_3_PACKED:
+				return true;
+			default:
+				return false;
+		}
+	}
+	
+	VertexFormat GetPackedVertexFormat(VertexFormat format)
+	{
+		switch (format)
+		{
+			case POS_TEX_2: return POS_TEX_2_PACKED;
+			case POS_TEX2_COLOR_2: return POS_TEX2_COLOR_2_PACKED;
+			case POS_NORMAL_3: return POS_NORMAL_3_PACKED;
+			case POS_NORMAL_TEX_3: return POS_NORMAL_TEX_3_PACKED;
+			case POS_NORMAL_COLOR_TEX_3: return POS_NORMAL_COLOR_TEX_3_PACKED;
+			default: return VERTEX_FORMAT_MAX;
+		}
+	}
+	
+	bool PackVertices(VertexFormat format, const void* vertices, int vertex_num, void* out_vertices)
+	{
+		switch (format)
+		{
+			case POS_TEX_2:
+			{
+				const vertex_2_pos_tex* src = static_cast<const vertex_2_pos_tex*>(vertices);
+				vertex_2_pos_tex_packed* dst = static_cast<vertex_2_pos_tex_packed*>(out_vertices);
+				for (int i = 0; i < vertex_num; ++i, ++src, ++dst)
+				{
+					memcpy(dst->position, src->position, sizeof(dst->position));
+					if (!PackUnit(src->tex_coord[0], dst->tex_coord[0]) ||
+						!PackUnit(src->tex_coord[1], dst->tex_coord[1]))
+						return false;
+				}
+				return true;
+			}
+				
+			case POS_TEX2_COLOR_2:
+			{
+				const vertex_2_pos_tex2_color* src = static_cast<const vertex_2_pos_tex2_color*>(vertices);
+				vertex_2_pos_tex2_color_packed* dst = static_cast<vertex_2_pos_tex2_color_packed*>(out_vertices);
+				for (int i = 0; i < vertex_num; ++i, ++src, ++dst)
+				{
+					memcpy(dst->position, src->position, sizeof(dst->position));
+					memcpy(dst->color, src->color, sizeof(dst->color));
+					if (!PackUnit(src->tex_coord[0], dst->tex_coord[0]) ||
+						!PackUnit(src->tex_coord[1], dst->tex_coord[1]) ||
+						!PackUnit(src->tex_coord2[0], dst->tex_coord2[0]) ||
+						!PackUnit(src->tex_coord2[1], dst->tex_coord2[1]))
+						return false;
+				}
+				return true;
+			}
+				
+			case POS_NORMAL_3:
+			{
+				const vertex_3_pos_normal* src = static_cast<const vertex_3_pos_normal*>(vertices);
+				vertex_3_pos_normal_packed* dst = static_cast<vertex_3_pos_normal_packed*>(out_vertices);
+				for (int i = 0; i < vertex_num; ++i, ++src, ++dst)
+				{
+					memcpy(dst->position, src->position, sizeof(dst->position));
+					PackNormal(src->normal, dst->normal);
+				}
+				return true;
+			}
+				
+			case POS_NORMAL_TEX_3:
+			{
+				const vertex_3_pos_normal_tex* src = static_cast<const vertex_3_pos_normal_tex*>(vertices);
+				vertex_3_pos_normal_tex_packed* dst = static_cast<vertex_3_pos_normal_tex_packed*>(out_vertices);
+				for (int i = 0; i < vertex_num; ++i, ++src, ++dst)
+				{
+					memcpy(dst->position, src->position, sizeof(dst->position));
+					PackNormal(src->normal, dst->normal);
+					if (!PackUnit(src->tex_coord[0], dst->tex_coord[0]) ||
+						!PackUnit(src->tex_coord[1], dst->tex_coord[1]))
+						return false;
+				}
+				return true;
+			}
+				
+			case POS_NORMAL_COLOR_TEX_3:
+			{
+				const vertex_3_pos_normal_color_tex* src = static_cast<const vertex_3_pos_normal_color_tex*>(vertices);
+				vertex_3_pos_normal_color_tex_packed* dst = static_cast<vertex_3_pos_normal_color_tex_packed*>(out_vertices);
+				for (int i = 0; i < vertex_num; ++i, ++src, ++dst)
+				{
+					memcpy(dst->position, src->position, sizeof(dst->position));
+					PackNormal(src->normal, dst->normal);
+					memcpy(dst->color, src->color, sizeof(dst->color));
+					if (!PackUnit(src->tex_coord[0], dst->tex_coord[0]) ||
+						!PackUnit(src->tex_coord[1], dst->tex_coord[1]))
+						return false;
+				}
+				return true;
+			}
+				
+			default:
+				ASSERT(0);
+				return false;
+		}
+	}
 }
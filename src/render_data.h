@@ -67,6 +67,46 @@ namespace ERI {
 		GLfloat tex_coord[2];
 	};
 	
+	// packed variants, normals and uvs are normalized integers,
+	// uvs should be in [0, 1]
+	
+	struct vertex_2_pos_tex_packed {
+		GLfloat		position[2];
+		GLushort	tex_coord[2];
+	};
+	
+	struct vertex_2_pos_tex2_color_packed {
+		GLfloat		position[2];
+		GLbyte		color[4];
+		GLushort	tex_coord[2];
+		GLushort	tex_coord2[2];
+	};
+	
+	struct vertex_3_pos_normal_packed {
+		GLfloat		position[3];
+		GLbyte		normal[4];
+	};
+	
+	struct vertex_3_pos_normal_tex_packed {
+		GLfloat		position[3];
+		GLbyte		normal[4];
+		GLushort	tex_coord[2];
+	};
+	
+	struct vertex_3_pos_normal_color_tex_packed {
+		GLfloat		position[3];
+		GLbyte		normal[4];
+		GLbyte		color[4];
+		GLushort	tex_coord[2];
+	};
+	
+	// per instance attributes of instanced sprite quad
+	struct instance_sprite {
+		GLfloat transform[2][4];	// 2x3 world transform with size and offset applied, [1][3] is world z
+		GLfloat tex_rect[4];		// u v scroll, u v scale
+		GLubyte	color[4];
+	};
+	
 	enum VertexFormat
 	{
 		POS_TEX_2 = 0,
@@ -77,8 +117,23 @@ namespace ERI {
 		POS_NORMAL_TEX_3,
 		POS_NORMAL_COLOR_TEX_3,
 		POS_COLOR_TEX_3,
+		POS_TEX_2_PACKED,
+		POS_TEX2_COLOR_2_PACKED,
+		POS_NORMAL_3_PACKED,
+		POS_NORMAL_TEX_3_PACKED,
+		POS_NORMAL_COLOR_TEX_3_PACKED,
 		VERTEX_FORMAT_MAX
 	};
+	
+	int GetVertexSize(VertexFormat format);
+	
+	bool IsVertexColorFormat(VertexFormat format);
+	
+	// VERTEX_FORMAT_MAX if format has no packed variant
+	VertexFormat GetPackedVertexFormat(VertexFormat format);
+	
+	// convert to packed variant, fail if any uv is out of [0, 1]
+	bool PackVertices(VertexFormat format, const void* vertices, int vertex_num, void* out_vertices);
 
 	struct RenderData
 	{
@@ -89,18 +144,22 @@ namespace ERI {
 		void UpdateWorldModelMatrix(const Matrix4& parent_world_model_matrix);
 		void UpdateWorldModelMatrix();
 		void UpdateInvWorldModelMatrix();
+		
+		// same program and blend, alpha test and depth state, so batches can draw them together
+		bool IsSameState(const RenderData& other) const;
 
 		// model
 		
-		bool disable_vertex_array;
-		mutable GLuint vertex_array; // create in renderer render
+		bool disable_vertex_array; // not use renderer cached vertex array object
 		
 		GLuint			vertex_buffer;
+		int				vertex_offset; // byte offset of first vertex in vertex buffer
 		GLenum			vertex_type;
 		VertexFormat	vertex_format;
 		int				vertex_count;
 		
 		GLuint			index_buffer;
+		int				index_offset; // byte offset of first index in index buffer
 		int				index_count;
 		
 		// transform
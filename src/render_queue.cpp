@@ -0,0 +1,326 @@
+//
+//  render_queue.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "render_queue.h"
+
+#include "renderer.h"
+#include "scene_actor.h"
+#include "sprite_batch.h"
+#include "mesh_batch.h"
+#include "worker_pool.h"
+
+#ifdef ERI_RENDERER_ES2
+#include "root.h"
+#include "shader_mgr.h"
+#endif
+
+namespace ERI
+{
+	static unsigned int GetBlendFactorIndex(GLenum factor)
+	{
+		switch (factor)
+		{
+			case GL_ZERO: return 0;
+			case GL_ONE: return 1;
+			default: return (factor - GL_SRC_COLOR + 2) & 0xF; // GL_SRC_COLOR ~ GL_SRC_ALPHA_SATURATE
+		}
+	}
+
+	// float bits which sort ascending as unsigned integer
+	static unsigned int GetSortableDepth(float depth)
+	{
+		union
+		{
+			float f;
+			unsigned int u;
+		} v;
+
+		v.f = depth;
+
+		return (v.u & 0x80000000) ? ~v.u : (v.u | 0x80000000);
+	}
+
+	void RenderQueue::Clear()
+	{
+		packets_.clear();
+	}
+
+	void RenderQueue::Add(SceneActor* actor, RenderPass pass, bool is_sort_depth)
+	{
+		ASSERT(actor);
+
+		// key is built in cull, keep pass and sort type until then
+		RenderPacket packet;
+		packet.actor = actor;
+		packet.key = (static_cast<SortKey>(pass) << 62) | (is_sort_depth ? 1 : 0);
+
+		packets_.push_back(packet);
+	}
+
+	void RenderQueue::Cull(const Matrix4* view_matrix /*= NULL*/, WorkerPool* pool /*= NULL*/)
+	{
+		static const int kChunkSize = 256;
+
+		view_matrix_ = view_matrix;
+
+		int num = static_cast<int>(packets_.size());
+
+		if (pool)
+			pool->ParallelFor(num, kChunkSize, CullJob, this);
+		else
+			CullRange(0, num);
+
+		int valid_num = 0;
+		for (int i = 0; i < num; ++i)
+		{
+			if (packets_[i].actor)
+				packets_[valid_num++] = packets_[i];
+		}
+		packets_.resize(valid_num);
+	}
+
+	void RenderQueue::CullJob(void* data, int begin, int end)
+	{
+		static_cast<RenderQueue*>(data)->CullRange(begin, end);
+	}
+
+	void RenderQueue::CullRange(int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			RenderPacket& packet = packets_[i];
+			SceneActor* actor = packet.actor;
+
+			if (!actor->visible() || !actor->IsInFrustum())
+			{
+				packet.actor = NULL;
+				continue;
+			}
+
+			SortKey pass = packet.key >> 62;
+			bool is_sort_depth = (packet.key & 1) != 0;
+
+			const RenderData& data = actor->render_data_;
+			const MaterialData& material = actor->material_data_;
+
+			SortKey program = 0;
+#ifdef ERI_RENDERER_ES2
+			// program name or variant key, which is wider than program field, hashed to 12 bits
+			ShaderMgr* shader_mgr = Root::Ins().shader_mgr();
+			if (shader_mgr)
+				program = (shader_mgr->GetProgramKey(data) * 2654435761u) >> 20;
+#endif
+
+			SortKey texture_set = 0;
+			for (int j = 0; j < MAX_TEXTURE_UNIT; ++j)
+			{
+				if (material.texture_units[j].texture)
+					texture_set = texture_set * 31 + material.texture_units[j].texture->id;
+			}
+
+			GLenum blend_src_factor = data.blend_src_factor;
+			if (data.alpha_premultiplied && blend_src_factor == GL_SRC_ALPHA)
+				blend_src_factor = GL_ONE;
+
+			SortKey blend = (GetBlendFactorIndex(blend_src_factor) << 4) | GetBlendFactorIndex(data.blend_dst_factor);
+
+			SortKey depth = GetSortableDepth(view_matrix_ ? actor->GetViewDepth(*view_matrix_) : actor->GetViewDepth());
+
+			packet.key = pass << 62;
+
+			if (is_sort_depth)
+			{
+				packet.key |= depth << 30;
+				packet.key |= (program >> 4) << 22;
+				packet.key |= (texture_set & 0x3FFF) << 8;
+				packet.key |= blend;
+			}
+			else
+			{
+				packet.key |= (program & 0xFFF) << 50;
+				packet.key |= (texture_set & 0xFFFFF) << 30;
+				packet.key |= blend << 22;
+				packet.key |= (~depth >> 10) & 0x3FFFFF;
+			}
+		}
+	}
+
+	void RenderQueue::Sort()
+	{
+		size_t num = packets_.size();
+		if (num < 2)
+			return;
+
+		sort_buffer_.resize(num);
+
+		// lsd radix sort, 8 bits per pass
+
+		size_t counts[8][256];
+		memset(counts, 0, sizeof(counts));
+
+		for (size_t i = 0; i < num; ++i)
+		{
+			SortKey key = packets_[i].key;
+			for (int b = 0; b < 8; ++b)
+			{
+				++counts[b][(key >> (b * 8)) & 0xFF];
+			}
+		}
+
+		RenderPacket* src = &packets_[0];
+		RenderPacket* dst = &sort_buffer_[0];
+
+		for (int b = 0; b < 8; ++b)
+		{
+			int shift = b * 8;
+			size_t* count = counts[b];
+
+			// skip pass which all packets have same digit
+			if (count[(src[0].key >> shift) & 0xFF] == num)
+				continue;
+
+			size_t offset = 0;
+			for (int d = 0; d < 256; ++d)
+			{
+				size_t c = count[d];
+				count[d] = offset;
+				offset += c;
+			}
+
+			for (size_t i = 0; i < num; ++i)
+			{
+				dst[count[(src[i].key >> shift) & 0xFF]++] = src[i];
+			}
+
+			RenderPacket* tmp = src;
+			src = dst;
+			dst = tmp;
+		}
+
+		if (src != &packets_[0])
+			packets_.swap(sort_buffer_);
+	}
+
+	void RenderQueue::Render(Renderer* renderer, SpriteBatch* batch /*= NULL*/, MeshBatch* mesh_batch /*= NULL*/, bool is_depth_pre_pass /*= false*/)
+	{
+		int now_pass = -1;
+
+		size_t num = packets_.size();
+
+		// opaque packets come first, lay down their depth
+		if (is_depth_pre_pass && num > 0 && static_cast<int>(packets_[0].key >> 62) == PASS_OPAQUE)
+		{
+			renderer->BeginGpuTimer(GPU_TIMER_PASS_OPAQUE);
+			renderer->EnableBlend(false);
+			renderer->SetDepthPass(DEPTH_PASS_PRE);
+
+			for (size_t i = 0; i < num && static_cast<int>(packets_[i].key >> 62) == PASS_OPAQUE; ++i)
+				DrawPacket(packets_[i].actor, renderer, batch, mesh_batch);
+
+			FlushBatch(renderer, batch, mesh_batch);
+
+			renderer->SetDepthPass(DEPTH_PASS_SHADE);
+			renderer->EndGpuTimer();
+		}
+
+		for (size_t i = 0; i < num; ++i)
+		{
+			int pass = static_cast<int>(packets_[i].key >> 62);
+
+			if (pass != now_pass)
+			{
+				FlushBatch(renderer, batch, mesh_batch);
+
+				if (now_pass == PASS_OPAQUE)
+				{
+					renderer->EndOverdrawCount();
+
+					if (is_depth_pre_pass)
+						renderer->SetDepthPass(DEPTH_PASS_NONE);
+				}
+
+				if (now_pass == PASS_ALPHA_TEST)
+					renderer->EnableAlphaTest(false);
+
+				if (now_pass >= 0)
+					renderer->EndGpuTimer();
+
+				renderer->BeginGpuTimer(static_cast<GpuTimerScope>(GPU_TIMER_PASS_OPAQUE + pass));
+
+				switch (pass)
+				{
+					case PASS_OPAQUE:
+						renderer->EnableBlend(false);
+						renderer->BeginOverdrawCount();
+						break;
+					case PASS_ALPHA_TEST:
+						renderer->EnableBlend(true);
+						renderer->EnableAlphaTest(true);
+						break;
+					case PASS_ALPHA_BLEND:
+						renderer->EnableBlend(true);
+						break;
+					default:
+						ASSERT(0);
+						break;
+				}
+
+				now_pass = pass;
+			}
+
+			DrawPacket(packets_[i].actor, renderer, batch, mesh_batch);
+		}
+
+		FlushBatch(renderer, batch, mesh_batch);
+
+		if (now_pass == PASS_OPAQUE)
+		{
+			renderer->EndOverdrawCount();
+
+			if (is_depth_pre_pass)
+				renderer->SetDepthPass(DEPTH_PASS_NONE);
+		}
+
+		if (now_pass == PASS_ALPHA_TEST)
+			renderer->EnableAlphaTest(false);
+
+		if (now_pass >= 0)
+			renderer->EndGpuTimer();
+	}
+
+	void RenderQueue::DrawPacket(SceneActor* actor, Renderer* renderer, SpriteBatch* batch, MeshBatch* mesh_batch)
+	{
+		if (mesh_batch && actor->IsMultiDrawable())
+		{
+			if (batch)
+				batch->Flush(renderer);
+
+			mesh_batch->Add(actor, renderer);
+		}
+		else
+		{
+			if (mesh_batch)
+				mesh_batch->Flush(renderer);
+
+			if (batch)
+				batch->Add(actor, renderer);
+			else
+				actor->Draw(renderer);
+		}
+	}
+
+	void RenderQueue::FlushBatch(Renderer* renderer, SpriteBatch* batch, MeshBatch* mesh_batch)
+	{
+		if (batch)
+			batch->Flush(renderer);
+		if (mesh_batch)
+			mesh_batch->Flush(renderer);
+	}
+}
@@ -0,0 +1,75 @@
+//
+//  render_queue.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_RENDER_QUEUE_H
+#define ERI_RENDER_QUEUE_H
+
+#include <vector>
+
+namespace ERI
+{
+	class Renderer;
+	class SceneActor;
+	class SpriteBatch;
+	class MeshBatch;
+	class WorkerPool;
+	struct Matrix4;
+
+	typedef unsigned long long SortKey;
+
+	enum RenderPass
+	{
+		PASS_OPAQUE = 0,
+		PASS_ALPHA_TEST,
+		PASS_ALPHA_BLEND
+	};
+
+	struct RenderPacket
+	{
+		SortKey		key;
+		SceneActor*	actor;
+	};
+
+	// Actors are added as candidates, Cull drops invisible ones and builds sort key
+	// (on worker threads if pool is given, world transform and view depth are updated there),
+	// depth is along view direction of camera if its view matrix is given, world z otherwise
+	//
+	// state sorted: | pass 2 | program 12 | texture set 20 | blend 8 | depth front to back 22 |
+	// depth sorted: | pass 2 | depth back to front 32 | program 8 | texture set 14 | blend 8 |
+	//
+	// then packets are radix sorted and rendered in order, so actors with same state are adjacent.
+
+	class RenderQueue
+	{
+	public:
+		RenderQueue() : view_matrix_(NULL) {}
+
+		void Clear();
+		void Add(SceneActor* actor, RenderPass pass, bool is_sort_depth);
+		void Cull(const Matrix4* view_matrix = NULL, WorkerPool* pool = NULL);
+		void Sort();
+		// opaque packets are drawn twice with depth pre pass, depth only then shaded
+		void Render(Renderer* renderer, SpriteBatch* batch = NULL, MeshBatch* mesh_batch = NULL, bool is_depth_pre_pass = false);
+
+		inline bool IsEmpty() { return packets_.empty(); }
+		inline const std::vector<RenderPacket>& packets() const { return packets_; }
+
+	private:
+		static void CullJob(void* data, int begin, int end);
+		void CullRange(int begin, int end);
+		void DrawPacket(SceneActor* actor, Renderer* renderer, SpriteBatch* batch, MeshBatch* mesh_batch);
+		void FlushBatch(Renderer* renderer, SpriteBatch* batch, MeshBatch* mesh_batch);
+
+		std::vector<RenderPacket>	packets_;
+		std::vector<RenderPacket>	sort_buffer_;
+
+		const Matrix4*	view_matrix_; // of cull in progress
+	};
+}
+
+#endif // ERI_RENDER_QUEUE_H
@@ -11,6 +11,7 @@
 #define ERI_RENDERER_H
 
 #include <string>
+#include <vector>
 
 #include "math_helper.h"
 
@@ -33,6 +34,18 @@ namespace ERI {
 		RGBA_PVR_2BPP
 	};
 	
+	// bytes of pixels read back, RGB is 565
+	inline int GetReadPixelsSize(int width, int height, PixelFormat format)
+	{
+		switch (format)
+		{
+			case RGBA: return width * height * 4;
+			case RGB: return width * height * 2;
+			case ALPHA: return width * height;
+			default: return 0;
+		}
+	}
+	
 	enum FogMode
 	{
 		FOG_LINEAR,
@@ -40,14 +53,35 @@ namespace ERI {
 		FOG_EXP2
 	};
 	
+	enum BufferType
+	{
+		BUFFER_VERTEX,
+		BUFFER_INDEX
+	};
+	
+	enum BufferUsage
+	{
+		BUFFER_USAGE_STATIC,
+		BUFFER_USAGE_DYNAMIC
+	};
+	
 	struct RenderData;
 	struct MaterialData;
 	
+	// pixels are valid during the call only, no renderer call should be made in it
+	typedef void (*ReadPixelsFunc)(const void* pixels, int width, int height, PixelFormat format, void* data);
+	
 	struct Caps
 	{
 		Caps()
 			: max_texture_size(0),
-			is_support_non_power_of_2_texture(false)
+			is_support_non_power_of_2_texture(false),
+			is_support_instancing(false),
+			is_support_packed_vertex(false),
+			is_support_gpu_timer(false),
+			is_support_multi_draw(false),
+			is_support_sample_counter(false),
+			is_support_async_readback(false)
 		{
 		}
 		
@@ -55,6 +89,94 @@ namespace ERI {
 		
 		int		max_texture_size;
 		bool	is_support_non_power_of_2_texture;
+		bool	is_support_instancing;
+		bool	is_support_packed_vertex; // normalized integer normals and uvs
+		bool	is_support_gpu_timer;
+		bool	is_support_multi_draw; // RenderMulti issues one call instead of a loop
+		bool	is_support_sample_counter; // samples passed query for overdraw counter
+		bool	is_support_async_readback; // pixel pack buffer
+	};
+	
+	struct RenderStats
+	{
+		RenderStats() { Reset(); }
+		
+		void Reset()
+		{
+			draw_call = 0;
+			pre_pass_draw_call = 0;
+			batch_draw_call = 0;
+			batched_actor = 0;
+			uniform_issued = 0;
+			uniform_skipped = 0;
+			bind_issued = 0;
+			bind_skipped = 0;
+			texture_bind_issued = 0;
+			texture_bind_skipped = 0;
+		}
+		
+		// draw calls saved by batching
+		inline int saved_draw_call() const { return batched_actor - batch_draw_call; }
+		
+		int		draw_call;
+		int		pre_pass_draw_call;	// of depth pre-pass, not counted in draw call
+		int		batch_draw_call;
+		int		batched_actor;
+		
+		// glUniform* uploads done and skipped as value was unchanged
+		int		uniform_issued;
+		int		uniform_skipped;
+		
+		// buffer and vertex array binds done and skipped as already bound
+		int		bind_issued;
+		int		bind_skipped;
+		
+		// texture binds done and skipped as already bound to the unit
+		int		texture_bind_issued;
+		int		texture_bind_skipped;
+	};
+	
+	enum DepthPass
+	{
+		DEPTH_PASS_NONE,
+		DEPTH_PASS_PRE,		// write depth only, color writes off whatever material says
+		DEPTH_PASS_SHADE	// after pre pass, less test passes equal depth too and depth writes off
+	};
+	
+	enum GpuTimerScope
+	{
+		GPU_TIMER_LAYER,
+		GPU_TIMER_PASS_OPAQUE,
+		GPU_TIMER_PASS_ALPHA_TEST,
+		GPU_TIMER_PASS_ALPHA_BLEND,
+		GPU_TIMER_RENDER_TO_TEXTURE,
+		GPU_TIMER_SCOPE_MAX
+	};
+	
+	struct GpuTimerResult
+	{
+		GpuTimerScope	scope;
+		int				id;		// layer id, -1 if not for a layer
+		int				depth;	// nesting level of scope
+		double			start_ms; // from first scope of frame
+		double			elapsed_ms;
+	};
+	
+	struct GpuTimerStats
+	{
+		GpuTimerStats() : frame_id(0), dropped_frame(0)
+		{
+			for (int i = 0; i < GPU_TIMER_SCOPE_MAX; ++i)
+				scope_ms[i] = 0.0;
+		}
+		
+		int			frame_id;		// frame counted by RenderEnd which results belong to
+		int			dropped_frame;	// frames not ready in time or disjoint, total
+		
+		// sum of each scope type, nested scopes are also counted in their parents
+		double		scope_ms[GPU_TIMER_SCOPE_MAX];
+		
+		std::vector<GpuTimerResult>	results;
 	};
 	
 	class Renderer
@@ -62,10 +184,13 @@ namespace ERI {
 	public:
 		Renderer()
 			: view_orientation_(PORTRAIT_HOME_BOTTOM),
+			overdraw_(0.0f),
 			content_scale_(1.0f) {}
 		
 		virtual ~Renderer() {}
 		
+		static const int kMaxMultiDraw = 16;
+		
 		virtual bool Init(bool use_depth_buffer) = 0;
 		
 		virtual void SetContextAsCurrent() = 0;
@@ -83,6 +208,15 @@ namespace ERI {
 		virtual void RenderStart() = 0;
 		virtual void RenderEnd() = 0;
 		virtual void Render(const RenderData* data) = 0;
+		
+		// draw data once per instance with instance attributes read from instance buffer,
+		// only if caps support instancing
+		virtual void RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num) = 0;
+		
+		// draw indexed datas which share vertex buffer, index buffer, vertex format and state
+		// with their own world transform and index range, at most kMaxMultiDraw,
+		// program should be a multi draw variant, see ShaderMgr::UseMultiDraw
+		virtual void RenderMulti(const RenderData* const* datas, int num) = 0;
 		virtual void ClearDepth() = 0;
 		
 		virtual void SaveTransform() = 0;
@@ -91,12 +225,33 @@ namespace ERI {
 		virtual void EnableRenderToBuffer(int x, int y, int width, int height, int frame_buffer) = 0;
 		virtual void CopyTexture(unsigned int texture, PixelFormat format) = 0;
 		virtual void CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format) = 0;
+		
+		// read into a ring of pixel pack buffers without stall, func is called at RenderEnd of a later frame
+		// when the read is done, which is checked by fence if supported or assumed after two frames,
+		// if caps not support async readback or ring is full, pixels are read by CopyPixels and func is called at once
+		virtual void ReadPixelsAsync(int x, int y, int width, int height, PixelFormat format, ReadPixelsFunc func, void* data) = 0;
+		// func of pending reads with data will not be called, e.g. before data is deleted
+		virtual void CancelReadPixels(void* data) = 0;
 		virtual void RestoreRenderToBuffer() = 0;
 		
+		// scissor test is always enabled, full backing size by default
+		virtual void SetScissor(int x, int y, int width, int height) = 0;
+		
+		// full backing size by default, not changed by render to buffer
+		virtual void SetViewport(int x, int y, int width, int height) = 0;
+		
 		virtual void EnableBlend(bool enable) = 0;
+		
+		// alpha is blended by ONE, ONE_MINUS_SRC_ALPHA whatever the factors are, and color by them,
+		// so render target holds premultiplied color with its coverage, see SceneLayer::SetCache
+		virtual void EnableBlendSeparateAlpha(bool enable) = 0;
+		
 		virtual void EnableAlphaTest(bool enable) = 0;
 		virtual void EnableMaterial(const MaterialData* data) = 0;
 		
+		// applied by following EnableMaterial and Render
+		virtual void SetDepthPass(DepthPass pass) = 0;
+		
 		virtual void ObtainLight(int& idx) = 0;
 		virtual void ReleaseLight(int idx) = 0;
 		virtual void SetLightPos(int idx, const Vector3& pos) = 0;
@@ -117,14 +272,42 @@ namespace ERI {
 		virtual unsigned int GenerateTexture() = 0;
 		virtual void UpdateTexture(unsigned int texture_id, const void* buffer, int width, int height, PixelFormat format) = 0;
 		virtual void ReleaseTexture(int texture_id) = 0;
+		virtual void InvalidateTextureBinding() = 0;
 		
 		virtual void BindDefaultFrameBuffer() = 0;
 		virtual int GenerateFrameBuffer() = 0;
 		virtual void BindTextureToFrameBuffer(unsigned int texture_id, int frame_buffer) = 0;
+		// depth render buffer is created or resized, and released with frame buffer
+		virtual void BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer) = 0;
 		virtual void ReleaseFrameBuffer(int frame_buffer) = 0;
 		
+		// vertex or index buffer object, data NULL only allocates
+		virtual unsigned int GenerateBuffer() = 0;
+		virtual void UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage) = 0;
+		virtual void UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size) = 0;
+		virtual void ReleaseBuffer(unsigned int buffer) = 0;
+		
 		virtual void ReleaseRenderData(RenderData& data) = 0;
 		
+		// fence after commands issued so far, NULL if not supported
+		virtual void* CreateFence() = 0;
+		// block until commands before fence are done
+		virtual void WaitFence(void* fence) = 0;
+		virtual void DeleteFence(void* fence) = 0;
+		
+		// gpu time of nested scopes by timestamp queries, only if caps support gpu timer,
+		// results are read back a few frames later without stall, see gpu_timer_stats
+		virtual void EnableGpuTimer(bool enable) = 0;
+		// id -1 takes id of parent scope
+		virtual void BeginGpuTimer(GpuTimerScope scope, int id = -1) = 0;
+		virtual void EndGpuTimer() = 0;
+		
+		// samples pass depth test between begin and end, summed per frame by samples passed queries,
+		// only if caps support sample counter, results are read back a few frames later, see overdraw
+		virtual void EnableOverdrawCounter(bool enable) = 0;
+		virtual void BeginOverdrawCount() = 0;
+		virtual void EndOverdrawCount() = 0;
+		
 		virtual void SetBgColor(const Color& color) = 0;
 		virtual const Color& GetBgColor() = 0;
 		
@@ -147,9 +330,50 @@ namespace ERI {
 		
 		inline const Caps& caps() { return caps_; }
 		
+		// stats of last finished frame
+		inline const RenderStats& stats() { return stats_; }
+		inline RenderStats& current_stats() { return current_stats_; }
+		
+		// latest frame with gpu timer results
+		inline const GpuTimerStats& gpu_timer_stats() { return gpu_timer_stats_; }
+		
+		// latest frame with overdraw counter result, counted samples per backing pixel
+		inline float overdraw() { return overdraw_; }
+		
+		void EndFrameStats()
+		{
+			stats_ = current_stats_;
+			current_stats_.Reset();
+		}
+		
 	protected:
+		// fallback of ReadPixelsAsync
+		void ReadPixelsNow(int x, int y, int width, int height, PixelFormat format, ReadPixelsFunc func, void* data)
+		{
+			read_pixels_buffer_.resize(GetReadPixelsSize(width, height, format));
+			if (read_pixels_buffer_.empty())
+				return;
+			
+			CopyPixels(&read_pixels_buffer_[0], x, y, width, height, format);
+			(*func)(&read_pixels_buffer_[0], width, height, format, data);
+		}
+		
+		inline void CountDrawCall(DepthPass pass)
+		{
+			if (DEPTH_PASS_PRE == pass)
+				++current_stats_.pre_pass_draw_call;
+			else
+				++current_stats_.draw_call;
+		}
+		
 		ViewOrientation	view_orientation_;
 		Caps			caps_;
+		RenderStats		current_stats_;
+		RenderStats		stats_;
+		GpuTimerStats	gpu_timer_stats_;
+		float			overdraw_;
+		
+		std::vector<unsigned char>	read_pixels_buffer_;
 		
 	private:
 		float			content_scale_;
@@ -108,6 +108,7 @@ namespace ERI {
 		depth_test_func_(GL_LESS),
 		depth_test_enable_(true),
 		depth_write_enable_(true),
+		depth_pass_(DEPTH_PASS_NONE),
 		cull_face_enable_(true),
 		cull_front_(false),
 		texture_enable_(false),
@@ -120,6 +121,7 @@ namespace ERI {
 		fog_enable_(false)
 	{
 		memset(frame_buffers_, 0, sizeof(frame_buffers_));
+		memset(frame_buffer_depths_, 0, sizeof(frame_buffer_depths_));
 		
 		for (int i = 0; i < MAX_TEXTURE_UNIT; ++i)
 		{
@@ -149,6 +151,11 @@ namespace ERI {
 			{
 				glDeleteFramebuffersOES(1, &frame_buffers_[i]);
 			}
+			
+			if (frame_buffer_depths_[i])
+			{
+				glDeleteRenderbuffersOES(1, &frame_buffer_depths_[i]);
+			}
 		}
 #endif
 
@@ -369,10 +376,17 @@ namespace ERI {
 			glAlphaFunc(alpha_test_func_, alpha_test_ref_);
 		}
 		
+		// depth of pre pass is laid down already
+		GLenum data_depth_test_func = data->depth_test_func;
+		if (depth_pass_ == DEPTH_PASS_SHADE && data_depth_test_func == GL_LESS)
+		{
+			data_depth_test_func = GL_LEQUAL;
+		}
+		
 		if (depth_test_enable_ &&
-			depth_test_func_ != data->depth_test_func)
+			depth_test_func_ != data_depth_test_func)
 		{
-			depth_test_func_ = data->depth_test_func;
+			depth_test_func_ = data_depth_test_func;
 			glDepthFunc(depth_test_func_);
 		}
 		
@@ -485,6 +499,16 @@ namespace ERI {
 				ASSERT(0);
 				break;
 		}
+		
+		if (data->vertex_offset > 0)
+		{
+			vertex_pos_offset = (char*)vertex_pos_offset + data->vertex_offset;
+			vertex_normal_offset = (char*)vertex_normal_offset + data->vertex_offset;
+			vertex_color_offset = (char*)vertex_color_offset + data->vertex_offset;
+			for (int i = 0; i < MAX_TEXTURE_UNIT; ++i) {
+				vertex_tex_coord_offset[i] = (char*)vertex_tex_coord_offset[i] + data->vertex_offset;
+			}
+		}
 	
 		// pos
 		glVertexPointer(vertex_pos_size, GL_FLOAT, vertex_stride, vertex_pos_offset);
@@ -541,10 +565,12 @@ namespace ERI {
 			}
 		}
 		
+		CountDrawCall(depth_pass_);
+		
 		if (data->index_count > 0)
 		{
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data->index_buffer);
-			glDrawElements(data->vertex_type, data->index_count, GL_UNSIGNED_SHORT, 0);
+			glDrawElements(data->vertex_type, data->index_count, GL_UNSIGNED_SHORT, (void*)(size_t)data->index_offset);
 		}
 		else
 		{
@@ -560,6 +586,19 @@ namespace ERI {
 		}
 	}
 	
+	void RendererES1::RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num)
+	{
+		ASSERT2(0, "instancing is not supported!");
+	}
+	
+	void RendererES1::RenderMulti(const RenderData* const* datas, int num)
+	{
+		for (int i = 0; i < num; ++i)
+		{
+			Render(datas[i]);
+		}
+	}
+	
 	void RendererES1::ClearDepth()
 	{
 		if (use_depth_buffer_)
@@ -617,6 +656,9 @@ namespace ERI {
 	
 	void RendererES1::CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format)
 	{
+		// read size assumes tightly packed rows, default alignment of 4 would pad the others
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		
 		switch (format)
 		{
 			case RGBA:
@@ -632,6 +674,8 @@ namespace ERI {
 				ASSERT2(0, "invalid pixel format!");
 				break;
 		}
+		
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
 	}
 	
 	void RendererES1::RestoreRenderToBuffer()
@@ -646,6 +690,16 @@ namespace ERI {
 #endif
 	}
 	
+	void RendererES1::SetScissor(int x, int y, int width, int height)
+	{
+		glScissor(x, y, width, height);
+	}
+	
+	void RendererES1::SetViewport(int x, int y, int width, int height)
+	{
+		glViewport(x, y, width, height);
+	}
+	
 	void RendererES1::EnableBlend(bool enable)
 	{
 		if (blend_enable_ != enable)
@@ -677,9 +731,9 @@ namespace ERI {
 		EnableLight(data->accept_light);
 		EnableFog(data->accept_fog);
 		EnableDepthTest(data->depth_test);
-		EnableDepthWrite(data->depth_write);
+		EnableDepthWrite(data->depth_write && depth_pass_ != DEPTH_PASS_SHADE);
 		EnableCullFace(data->cull_face, data->cull_front);
-		EnableColorWrite(data->color_write);
+		EnableColorWrite(depth_pass_ == DEPTH_PASS_PRE ? ColorFlags(false) : data->color_write);
 		
 		texture_enable_ = (data->used_unit > 0);
 		
@@ -1125,6 +1179,11 @@ namespace ERI {
 		glDeleteTextures(1, &id);
 	}
 	
+	void RendererES1::InvalidateTextureBinding()
+	{
+		now_texture_ = 0;
+	}
+	
 	void RendererES1::BindDefaultFrameBuffer()
 	{
 #if ERI_PLATFORM == ERI_PLATFORM_IOS
@@ -1178,6 +1237,35 @@ namespace ERI {
 		ASSERT2(status == GL_FRAMEBUFFER_COMPLETE_OES, "Failed to make complete framebuffer object %x", status);
 #endif
 	}
+	
+	void RendererES1::BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer)
+	{
+#if ERI_PLATFORM == ERI_PLATFORM_IOS
+		ASSERT(width > 0 && height > 0 && frame_buffer > 0);
+		
+		if (context_) context_->SetAsCurrent();
+		
+		for (int i = kDefaultFrameBufferIdx + 1; i < kMaxFrameBuffer; ++i)
+		{
+			if (frame_buffers_[i] == frame_buffer)
+			{
+				glBindFramebufferOES(GL_FRAMEBUFFER_OES, frame_buffer);
+				
+				if (!frame_buffer_depths_[i])
+					glGenRenderbuffersOES(1, &frame_buffer_depths_[i]);
+				
+				// allocate and attach a depth buffer
+				glBindRenderbufferOES(GL_RENDERBUFFER_OES, frame_buffer_depths_[i]);
+				glRenderbufferStorageOES(GL_RENDERBUFFER_OES, GL_DEPTH_COMPONENT16_OES, width, height);
+				glFramebufferRenderbufferOES(GL_FRAMEBUFFER_OES, GL_DEPTH_ATTACHMENT_OES, GL_RENDERBUFFER_OES, frame_buffer_depths_[i]);
+				
+				GLenum status = glCheckFramebufferStatusOES(GL_FRAMEBUFFER_OES);
+				ASSERT2(status == GL_FRAMEBUFFER_COMPLETE_OES, "Failed to make complete framebuffer object %x", status);
+				return;
+			}
+		}
+#endif
+	}
   
 	void RendererES1::ReleaseFrameBuffer(int frame_buffer)
 	{
@@ -1192,12 +1280,54 @@ namespace ERI {
 			{
 				glDeleteFramebuffersOES(1, &frame_buffers_[i]);
 				frame_buffers_[i] = 0;
+				
+				if (frame_buffer_depths_[i])
+				{
+					glDeleteRenderbuffersOES(1, &frame_buffer_depths_[i]);
+					frame_buffer_depths_[i] = 0;
+				}
 				return;
 			}
 		}
 #endif
 	}
 	
+	unsigned int RendererES1::GenerateBuffer()
+	{
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		return buffer;
+	}
+	
+	void RendererES1::UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage)
+	{
+		ASSERT(buffer);
+		
+		GLenum target = (BUFFER_INDEX == type) ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+		
+		glBindBuffer(target, buffer);
+		glBufferData(target, size, data, (BUFFER_USAGE_DYNAMIC == usage) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+	}
+	
+	void RendererES1::UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size)
+	{
+		ASSERT(buffer);
+		
+		GLenum target = (BUFFER_INDEX == type) ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+		
+		glBindBuffer(target, buffer);
+		glBufferSubData(target, offset, size, data);
+	}
+	
+	void RendererES1::ReleaseBuffer(unsigned int buffer)
+	{
+		if (buffer)
+		{
+			GLuint buffer_id = buffer;
+			glDeleteBuffers(1, &buffer_id);
+		}
+	}
+	
 	void RendererES1::ReleaseRenderData(RenderData& data)
 	{
 		if (data.index_buffer != 0)
@@ -1210,9 +1340,22 @@ namespace ERI {
 			glDeleteBuffers(1, &data.vertex_buffer);
 			data.vertex_buffer = 0;
 		}
-		
-		// not support VAO in es1
-		ASSERT(data.vertex_array == 0);
+	}
+	
+	void* RendererES1::CreateFence()
+	{
+		// not support sync in es1
+		return NULL;
+	}
+	
+	void RendererES1::WaitFence(void* fence)
+	{
+		ASSERT(fence == NULL);
+	}
+	
+	void RendererES1::DeleteFence(void* fence)
+	{
+		ASSERT(fence == NULL);
 	}
 
 	void RendererES1::SetBgColor(const Color& color)
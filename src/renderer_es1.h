@@ -64,6 +64,8 @@ namespace ERI {
 		virtual void RenderStart();
 		virtual void RenderEnd();
 		virtual void Render(const RenderData* data);
+		virtual void RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num);
+		virtual void RenderMulti(const RenderData* const* datas, int num);
 		virtual void ClearDepth();
 		
 		virtual void SaveTransform();
@@ -72,11 +74,18 @@ namespace ERI {
 		virtual void EnableRenderToBuffer(int x, int y, int width, int height, int frame_buffer);
 		virtual void CopyTexture(unsigned int texture, PixelFormat format);
 		virtual void CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format);
+		virtual void ReadPixelsAsync(int x, int y, int width, int height, PixelFormat format, ReadPixelsFunc func, void* data) { ReadPixelsNow(x, y, width, height, format, func, data); }
+		virtual void CancelReadPixels(void* data) {}
 		virtual void RestoreRenderToBuffer();
 		
+		virtual void SetScissor(int x, int y, int width, int height);
+		virtual void SetViewport(int x, int y, int width, int height);
+		
 		virtual void EnableBlend(bool enable);
+		virtual void EnableBlendSeparateAlpha(bool enable) {} // not in ES 1.1 core
 		virtual void EnableAlphaTest(bool enable);
 		virtual void EnableMaterial(const MaterialData* data);
+		virtual void SetDepthPass(DepthPass pass) { depth_pass_ = pass; }
 		
 		void EnableLight(bool enable);
 		void EnableFog(bool enable);
@@ -108,13 +117,33 @@ namespace ERI {
 		virtual unsigned int GenerateTexture();
 		virtual void UpdateTexture(unsigned int texture_id, const void* buffer, int width, int height, PixelFormat format);
 		virtual void ReleaseTexture(int texture_id);
+		virtual void InvalidateTextureBinding();
 		
 		virtual void BindDefaultFrameBuffer();
 		virtual int GenerateFrameBuffer();
 		virtual void BindTextureToFrameBuffer(unsigned int texture_id, int frame_buffer);
+		virtual void BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer);
 		virtual void ReleaseFrameBuffer(int frame_buffer);
 
+		virtual unsigned int GenerateBuffer();
+		virtual void UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage);
+		virtual void UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size);
+		virtual void ReleaseBuffer(unsigned int buffer);
+		
 		virtual void ReleaseRenderData(RenderData& data);
+		
+		virtual void* CreateFence();
+		virtual void WaitFence(void* fence);
+		virtual void DeleteFence(void* fence);
+		
+		// not support gpu timer in es1
+		virtual void EnableGpuTimer(bool enable) {}
+		virtual void BeginGpuTimer(GpuTimerScope scope, int id = -1) {}
+		virtual void EndGpuTimer() {}
+		
+		virtual void EnableOverdrawCounter(bool enable) {}
+		virtual void BeginOverdrawCount() {}
+		virtual void EndOverdrawCount() {}
 
 		virtual void SetBgColor(const Color& color);
 		virtual const Color& GetBgColor();
@@ -152,6 +181,7 @@ namespace ERI {
 		int width_, height_;
 		
 		GLuint frame_buffers_[kMaxFrameBuffer];
+		GLuint frame_buffer_depths_[kMaxFrameBuffer]; // depth render buffers of frame buffers
 		GLuint color_render_buffer_;
 		
 		GLuint depth_buffer_;
@@ -170,6 +200,8 @@ namespace ERI {
 		GLenum		depth_test_func_;
 		bool depth_test_enable_;
 		bool depth_write_enable_;
+		
+		DepthPass depth_pass_;
 
 		bool cull_face_enable_;
 		bool cull_front_;
@@ -30,6 +30,87 @@ namespace ERI {
 	static void (*fpGenVertexArrays)(GLsizei n, GLuint *arrays);
 	static void (*fpBindVertexArray)(GLuint array);
 	static void (*fpDeleteVertexArrays)(GLsizei n, const GLuint *arrays);
+	
+	static void (*fpVertexAttribDivisor)(GLuint index, GLuint divisor);
+	static void (*fpDrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+	
+	static void (*fpMultiDrawElementsBaseVertex)(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei draw_count, const GLint* base_vertex);
+	
+	static GLsync (*fpFenceSync)(GLenum condition, GLbitfield flags);
+	static GLenum (*fpClientWaitSync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+	static void (*fpDeleteSync)(GLsync sync);
+	
+	static void (*fpGetProgramBinary)(GLuint program, GLsizei buf_size, GLsizei* length, GLenum* binary_format, void* binary);
+	static void (*fpProgramBinary)(GLuint program, GLenum binary_format, const void* binary, GLsizei length);
+	
+	static void (*fpGenQueries)(GLsizei n, GLuint* ids);
+	static void (*fpDeleteQueries)(GLsizei n, const GLuint* ids);
+	static void (*fpQueryCounter)(GLuint id, GLenum target);
+	static void (*fpGetQueryiv)(GLenum target, GLenum pname, GLint* params);
+	static void (*fpGetQueryObjectuiv)(GLuint id, GLenum pname, GLuint* params);
+	static void (*fpGetQueryObjectui64v)(GLuint id, GLenum pname, GLuint64* params);
+	static void (*fpBeginQuery)(GLenum target, GLuint id);
+	static void (*fpEndQuery)(GLenum target);
+	
+	static void* (*fpMapBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+	static GLboolean (*fpUnmapBuffer)(GLenum target);
+	
+	static void (*fpGenSamplers)(GLsizei n, GLuint* samplers);
+	static void (*fpDeleteSamplers)(GLsizei n, const GLuint* samplers);
+	static void (*fpBindSampler)(GLuint unit, GLuint sampler);
+	static void (*fpSamplerParameteri)(GLuint sampler, GLenum pname, GLint param);
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_COUNTER_BITS
+#define GL_QUERY_COUNTER_BITS 0x8864
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_SAMPLES_PASSED
+#define GL_SAMPLES_PASSED 0x8914
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
 
 	const GLint kParamFilters[] =
 	{
@@ -46,9 +127,35 @@ namespace ERI {
 		GL_REPEAT,
 		GL_CLAMP_TO_EDGE
 	};
+	
+	static inline int GetSamplerKey(const TextureParams& params)
+	{
+		return ((params.filter_min * 6 + params.filter_mag) * 2 + params.wrap_s) * 2 + params.wrap_t;
+	}
 
 	RendererES2::RendererES2() :
 		is_support_vertex_array_object_(false),
+		is_support_sync_(false),
+		is_support_program_binary_(false),
+		is_support_sampler_object_(false),
+		bound_vertex_array_(kInvalidBinding),
+		bound_array_buffer_(kInvalidBinding),
+		bound_element_buffer_(kInvalidBinding),
+		is_default_vertex_valid_(false),
+		gpu_timer_frame_idx_(0),
+		gpu_timer_frame_id_(0),
+		gpu_timer_enable_(false),
+		gpu_timer_enable_request_(false),
+		is_gpu_timer_disjoint_ext_(false),
+		overdraw_frame_idx_(0),
+		overdraw_enable_(false),
+		overdraw_enable_request_(false),
+		is_overdraw_counting_(false),
+		readback_head_(0),
+		readback_num_(0),
+		readback_frame_id_(0),
+		instance_buffer_(0),
+		instance_num_(0),
 		context_(NULL),
 		backing_width_(0),
 		backing_height_(0),
@@ -61,17 +168,18 @@ namespace ERI {
 		blend_src_factor_(GL_SRC_ALPHA),
 		blend_dst_factor_(GL_ONE_MINUS_SRC_ALPHA),
 		blend_enable_(false),
+		blend_separate_alpha_(false),
 		alpha_test_func_(GL_GREATER),
 		alpha_test_ref_(0.0f),
 		alpha_test_enable_(false),
 		depth_test_func_(GL_LESS),
 		depth_test_enable_(true),
 		depth_write_enable_(true),
+		depth_pass_(DEPTH_PASS_NONE),
 		cull_face_enable_(true),
 		cull_front_(false),
 		texture_enable_(false),
-		now_active_texture_unit_(0),
-		now_texture_(0),
+		now_active_texture_unit_(GL_TEXTURE0),
 		is_view_proj_dirty_(true),
 		fog_mode_(FOG_LINEAR),
 		fog_density_(1.f),
@@ -79,14 +187,39 @@ namespace ERI {
 		fog_end_(1000.f)
 	{
 		memset(frame_buffers_, 0, sizeof(frame_buffers_));
+		memset(frame_buffer_depths_, 0, sizeof(frame_buffer_depths_));
 		
 		for (int i = 0; i < MAX_TEXTURE_UNIT; ++i)
+		{
 			texture_unit_coord_idx_[i] = -1;
+			now_textures_[i] = 0;
+			bound_samplers_[i] = 0;
+		}
 	}
 	
 	RendererES2::~RendererES2()
 	{
 		if (context_) context_->SetAsCurrent();
+		
+		ClearVertexArrayCache();
+		ClearSamplerCache();
+		
+		for (int i = 0; i < kGpuTimerFrameNum; ++i)
+		{
+			if (!gpu_timer_frames_[i].queries.empty())
+				(*fpDeleteQueries)(static_cast<GLsizei>(gpu_timer_frames_[i].queries.size()), &gpu_timer_frames_[i].queries[0]);
+			
+			if (!overdraw_frames_[i].queries.empty())
+				(*fpDeleteQueries)(static_cast<GLsizei>(overdraw_frames_[i].queries.size()), &overdraw_frames_[i].queries[0]);
+		}
+		
+		for (int i = 0; i < kReadbackSlotNum; ++i)
+		{
+			if (readback_slots_[i].buffer)
+				glDeleteBuffers(1, &readback_slots_[i].buffer);
+			
+			DeleteFence(readback_slots_[i].fence);
+		}
 
 #if ERI_PLATFORM == ERI_PLATFORM_IOS
 		if (depth_buffer_)
@@ -105,6 +238,11 @@ namespace ERI {
 			{
 				glDeleteFramebuffers(1, &frame_buffers_[i]);
 			}
+			
+			if (frame_buffer_depths_[i])
+			{
+				glDeleteRenderbuffers(1, &frame_buffer_depths_[i]);
+			}
 		}
 #endif
 		
@@ -198,10 +336,348 @@ namespace ERI {
 			}
 		}
 		
+		// instanced arrays are core in GL 3.3 and ES 3.0
+#ifdef ERI_GL
+		bool is_core_instancing = (version[0] > '3' || (version[0] == '3' && version[2] >= '3'));
+#else
+		bool is_core_instancing = (strncmp(version, "OpenGL ES 3", 11) == 0);
+#endif
+		
+		caps_.is_support_instancing =
+			is_core_instancing ||
+			strstr(extensions, "GL_ARB_instanced_arrays") != 0 ||
+			strstr(extensions, "GL_EXT_instanced_arrays") != 0;
+		
+		fpVertexAttribDivisor = NULL;
+		fpDrawArraysInstanced = NULL;
+		if (caps_.is_support_instancing)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_IOS
+			fpVertexAttribDivisor = glVertexAttribDivisorEXT;
+			fpDrawArraysInstanced = glDrawArraysInstancedEXT;
+#elif ERI_PLATFORM == ERI_PLATFORM_MAC
+			fpVertexAttribDivisor = glVertexAttribDivisorARB;
+			fpDrawArraysInstanced = glDrawArraysInstancedARB;
+#elif ERI_PLATFORM == ERI_PLATFORM_ANDROID
+			const char* divisor_name = is_core_instancing ? "glVertexAttribDivisor" : "glVertexAttribDivisorEXT";
+			const char* draw_name = is_core_instancing ? "glDrawArraysInstanced" : "glDrawArraysInstancedEXT";
+			fpVertexAttribDivisor = (void (*)(GLuint, GLuint))eglGetProcAddress(divisor_name);
+			fpDrawArraysInstanced = (void (*)(GLenum, GLint, GLsizei, GLsizei))eglGetProcAddress(draw_name);
+#else
+			fpVertexAttribDivisor = glVertexAttribDivisor;
+			fpDrawArraysInstanced = glDrawArraysInstanced;
+#endif
+			
+			if (NULL == fpVertexAttribDivisor ||
+				NULL == fpDrawArraysInstanced)
+			{
+				LOGW("gl support instanced arrays but can't get functions");
+				caps_.is_support_instancing = false;
+				fpVertexAttribDivisor = NULL;
+				fpDrawArraysInstanced = NULL;
+			}
+		}
+		
+		// multi draw needs base vertex, which is core in GL 3.2, and draw index in shader,
+		// es has no draw index and draws ranges one by one
+#ifdef ERI_GL
+		bool is_core_base_vertex = (version[0] > '3' || (version[0] == '3' && version[2] >= '2'));
+		
+		caps_.is_support_multi_draw =
+			(is_core_base_vertex || strstr(extensions, "GL_ARB_draw_elements_base_vertex") != 0) &&
+			strstr(extensions, "GL_ARB_shader_draw_parameters") != 0;
+#else
+		caps_.is_support_multi_draw = false;
+#endif
+		
+		fpMultiDrawElementsBaseVertex = NULL;
+		if (caps_.is_support_multi_draw)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_WIN || ERI_PLATFORM == ERI_PLATFORM_LINUX
+			fpMultiDrawElementsBaseVertex = glMultiDrawElementsBaseVertex;
+#endif
+			
+			if (NULL == fpMultiDrawElementsBaseVertex)
+			{
+				LOGW("gl support multi draw but can't get functions");
+				caps_.is_support_multi_draw = false;
+			}
+		}
+		
+		// fence sync is core in GL 3.2 and ES 3.0
+#ifdef ERI_GL
+		bool is_core_sync = (version[0] > '3' || (version[0] == '3' && version[2] >= '2'));
+#else
+		bool is_core_sync = (strncmp(version, "OpenGL ES 3", 11) == 0);
+#endif
+		
+		is_support_sync_ =
+			is_core_sync ||
+			strstr(extensions, "GL_ARB_sync") != 0 ||
+			strstr(extensions, "GL_APPLE_sync") != 0;
+		
+		fpFenceSync = NULL;
+		fpClientWaitSync = NULL;
+		fpDeleteSync = NULL;
+		if (is_support_sync_)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_IOS
+			fpFenceSync = glFenceSyncAPPLE;
+			fpClientWaitSync = glClientWaitSyncAPPLE;
+			fpDeleteSync = glDeleteSyncAPPLE;
+#elif ERI_PLATFORM == ERI_PLATFORM_ANDROID
+			fpFenceSync = (GLsync (*)(GLenum, GLbitfield))eglGetProcAddress(is_core_sync ? "glFenceSync" : "glFenceSyncAPPLE");
+			fpClientWaitSync = (GLenum (*)(GLsync, GLbitfield, GLuint64))eglGetProcAddress(is_core_sync ? "glClientWaitSync" : "glClientWaitSyncAPPLE");
+			fpDeleteSync = (void (*)(GLsync))eglGetProcAddress(is_core_sync ? "glDeleteSync" : "glDeleteSyncAPPLE");
+#else
+			fpFenceSync = glFenceSync;
+			fpClientWaitSync = glClientWaitSync;
+			fpDeleteSync = glDeleteSync;
+#endif
+			
+			if (NULL == fpFenceSync ||
+				NULL == fpClientWaitSync ||
+				NULL == fpDeleteSync)
+			{
+				LOGW("gl support sync but can't get functions");
+				is_support_sync_ = false;
+				fpFenceSync = NULL;
+				fpClientWaitSync = NULL;
+				fpDeleteSync = NULL;
+			}
+		}
+		
+		// pixel pack buffer is core in GL 2.1 and ES 3.0, reading it needs map buffer range of GL 3.0 and ES 3.0
+#ifdef ERI_GL
+		caps_.is_support_async_readback =
+			version[0] >= '3' ||
+			strstr(extensions, "GL_ARB_map_buffer_range") != 0;
+#else
+		caps_.is_support_async_readback = (strncmp(version, "OpenGL ES 3", 11) == 0);
+#endif
+		
+		fpMapBufferRange = NULL;
+		fpUnmapBuffer = NULL;
+		if (caps_.is_support_async_readback)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_ANDROID
+			fpMapBufferRange = (void* (*)(GLenum, GLintptr, GLsizeiptr, GLbitfield))eglGetProcAddress("glMapBufferRange");
+			fpUnmapBuffer = (GLboolean (*)(GLenum))eglGetProcAddress("glUnmapBuffer");
+#elif ERI_PLATFORM == ERI_PLATFORM_WIN || ERI_PLATFORM == ERI_PLATFORM_LINUX
+			fpMapBufferRange = glMapBufferRange;
+			fpUnmapBuffer = glUnmapBuffer;
+#endif
+			
+			if (NULL == fpMapBufferRange ||
+				NULL == fpUnmapBuffer)
+			{
+				LOGW("gl support pixel pack buffer but can't get functions");
+				caps_.is_support_async_readback = false;
+				fpMapBufferRange = NULL;
+				fpUnmapBuffer = NULL;
+			}
+		}
+		
+		// program binary is core in GL 4.1 and ES 3.0
+#ifdef ERI_GL
+		bool is_core_program_binary = (version[0] > '4' || (version[0] == '4' && version[2] >= '1'));
+#else
+		bool is_core_program_binary = (strncmp(version, "OpenGL ES 3", 11) == 0);
+#endif
+		
+		is_support_program_binary_ =
+			is_core_program_binary ||
+			strstr(extensions, "GL_ARB_get_program_binary") != 0 ||
+			strstr(extensions, "GL_OES_get_program_binary") != 0;
+		
+		if (is_support_program_binary_)
+		{
+			// some drivers expose the functions with no binary format
+			GLint format_num = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_num);
+			if (format_num <= 0)
+				is_support_program_binary_ = false;
+		}
+		
+		fpGetProgramBinary = NULL;
+		fpProgramBinary = NULL;
+		if (is_support_program_binary_)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_ANDROID
+			fpGetProgramBinary = (void (*)(GLuint, GLsizei, GLsizei*, GLenum*, void*))eglGetProcAddress(is_core_program_binary ? "glGetProgramBinary" : "glGetProgramBinaryOES");
+			fpProgramBinary = (void (*)(GLuint, GLenum, const void*, GLsizei))eglGetProcAddress(is_core_program_binary ? "glProgramBinary" : "glProgramBinaryOES");
+#elif ERI_PLATFORM == ERI_PLATFORM_WIN || ERI_PLATFORM == ERI_PLATFORM_LINUX
+			fpGetProgramBinary = glGetProgramBinary;
+			fpProgramBinary = glProgramBinary;
+#endif
+			
+			if (NULL == fpGetProgramBinary ||
+				NULL == fpProgramBinary)
+			{
+				LOGW("gl support program binary but can't get functions");
+				is_support_program_binary_ = false;
+				fpGetProgramBinary = NULL;
+				fpProgramBinary = NULL;
+			}
+		}
+		
+		// timer query is core in GL 3.3, es has disjoint extension only
+#ifdef ERI_GL
+		bool is_core_timer_query = (version[0] > '3' || (version[0] == '3' && version[2] >= '3'));
+#else
+		bool is_core_timer_query = false;
+#endif
+		
+		is_gpu_timer_disjoint_ext_ = (strstr(extensions, "GL_EXT_disjoint_timer_query") != 0);
+		
+		caps_.is_support_gpu_timer =
+			is_core_timer_query ||
+			strstr(extensions, "GL_ARB_timer_query") != 0 ||
+			is_gpu_timer_disjoint_ext_;
+		
+		fpGenQueries = NULL;
+		fpDeleteQueries = NULL;
+		fpQueryCounter = NULL;
+		fpGetQueryiv = NULL;
+		fpGetQueryObjectuiv = NULL;
+		fpGetQueryObjectui64v = NULL;
+		if (caps_.is_support_gpu_timer)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_ANDROID
+			fpGenQueries = (void (*)(GLsizei, GLuint*))eglGetProcAddress("glGenQueriesEXT");
+			fpDeleteQueries = (void (*)(GLsizei, const GLuint*))eglGetProcAddress("glDeleteQueriesEXT");
+			fpQueryCounter = (void (*)(GLuint, GLenum))eglGetProcAddress("glQueryCounterEXT");
+			fpGetQueryiv = (void (*)(GLenum, GLenum, GLint*))eglGetProcAddress("glGetQueryivEXT");
+			fpGetQueryObjectuiv = (void (*)(GLuint, GLenum, GLuint*))eglGetProcAddress("glGetQueryObjectuivEXT");
+			fpGetQueryObjectui64v = (void (*)(GLuint, GLenum, GLuint64*))eglGetProcAddress("glGetQueryObjectui64vEXT");
+#elif ERI_PLATFORM == ERI_PLATFORM_WIN || ERI_PLATFORM == ERI_PLATFORM_LINUX
+			fpGenQueries = glGenQueries;
+			fpDeleteQueries = glDeleteQueries;
+			fpQueryCounter = glQueryCounter;
+			fpGetQueryiv = glGetQueryiv;
+			fpGetQueryObjectuiv = glGetQueryObjectuiv;
+			fpGetQueryObjectui64v = glGetQueryObjectui64v;
+#endif
+			
+			if (NULL == fpGenQueries ||
+				NULL == fpDeleteQueries ||
+				NULL == fpQueryCounter ||
+				NULL == fpGetQueryiv ||
+				NULL == fpGetQueryObjectuiv ||
+				NULL == fpGetQueryObjectui64v)
+			{
+				LOGW("gl support timer query but can't get functions");
+				caps_.is_support_gpu_timer = false;
+			}
+			else
+			{
+				// disjoint extension may support elapsed time only
+				GLint counter_bits = 0;
+				(*fpGetQueryiv)(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits);
+				if (counter_bits <= 0)
+					caps_.is_support_gpu_timer = false;
+			}
+			
+			if (!caps_.is_support_gpu_timer)
+			{
+				fpGenQueries = NULL;
+				fpDeleteQueries = NULL;
+				fpQueryCounter = NULL;
+				fpGetQueryiv = NULL;
+				fpGetQueryObjectuiv = NULL;
+				fpGetQueryObjectui64v = NULL;
+			}
+		}
+		
+		// samples passed query is core in GL 1.5, es has boolean occlusion query only
+#ifdef ERI_GL
+		caps_.is_support_sample_counter = true;
+#else
+		caps_.is_support_sample_counter = false;
+#endif
+		
+		fpBeginQuery = NULL;
+		fpEndQuery = NULL;
+		if (caps_.is_support_sample_counter)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_WIN || ERI_PLATFORM == ERI_PLATFORM_LINUX
+			fpGenQueries = glGenQueries;
+			fpDeleteQueries = glDeleteQueries;
+			fpGetQueryObjectuiv = glGetQueryObjectuiv;
+			fpBeginQuery = glBeginQuery;
+			fpEndQuery = glEndQuery;
+#endif
+			
+			if (NULL == fpGenQueries ||
+				NULL == fpDeleteQueries ||
+				NULL == fpGetQueryObjectuiv ||
+				NULL == fpBeginQuery ||
+				NULL == fpEndQuery)
+			{
+				LOGW("gl support samples passed query but can't get functions");
+				caps_.is_support_sample_counter = false;
+				fpBeginQuery = NULL;
+				fpEndQuery = NULL;
+			}
+		}
+		
+		// sampler objects are core in GL 3.3 and ES 3.0
+#ifdef ERI_GL
+		bool is_core_sampler_object = (version[0] > '3' || (version[0] == '3' && version[2] >= '3'));
+#else
+		bool is_core_sampler_object = (strncmp(version, "OpenGL ES 3", 11) == 0);
+#endif
+		
+		is_support_sampler_object_ =
+			is_core_sampler_object ||
+			strstr(extensions, "GL_ARB_sampler_objects") != 0;
+		
+		fpGenSamplers = NULL;
+		fpDeleteSamplers = NULL;
+		fpBindSampler = NULL;
+		fpSamplerParameteri = NULL;
+		if (is_support_sampler_object_)
+		{
+#if ERI_PLATFORM == ERI_PLATFORM_ANDROID
+			fpGenSamplers = (void (*)(GLsizei, GLuint*))eglGetProcAddress("glGenSamplers");
+			fpDeleteSamplers = (void (*)(GLsizei, const GLuint*))eglGetProcAddress("glDeleteSamplers");
+			fpBindSampler = (void (*)(GLuint, GLuint))eglGetProcAddress("glBindSampler");
+			fpSamplerParameteri = (void (*)(GLuint, GLenum, GLint))eglGetProcAddress("glSamplerParameteri");
+#elif ERI_PLATFORM == ERI_PLATFORM_WIN || ERI_PLATFORM == ERI_PLATFORM_LINUX
+			fpGenSamplers = glGenSamplers;
+			fpDeleteSamplers = glDeleteSamplers;
+			fpBindSampler = glBindSampler;
+			fpSamplerParameteri = glSamplerParameteri;
+#endif
+			
+			if (NULL == fpGenSamplers ||
+				NULL == fpDeleteSamplers ||
+				NULL == fpBindSampler ||
+				NULL == fpSamplerParameteri)
+			{
+				LOGW("gl support sampler objects but can't get functions");
+				is_support_sampler_object_ = false;
+				fpGenSamplers = NULL;
+				fpDeleteSamplers = NULL;
+				fpBindSampler = NULL;
+				fpSamplerParameteri = NULL;
+			}
+		}
+		
 		// NOTE: npot no mipmap and only GL_CLAMP_TO_EDGE as wrap mode
 		caps_.is_support_non_power_of_2_texture = true;
 		
+		caps_.is_support_packed_vertex = true;
+		
 		LOGI("vertex array object support: %s", is_support_vertex_array_object_ ? "true" : "false");
+		LOGI("instancing support: %s", caps_.is_support_instancing ? "true" : "false");
+		LOGI("sync support: %s", is_support_sync_ ? "true" : "false");
+		LOGI("program binary support: %s", is_support_program_binary_ ? "true" : "false");
+		LOGI("gpu timer support: %s", caps_.is_support_gpu_timer ? "true" : "false");
+		LOGI("multi draw support: %s", caps_.is_support_multi_draw ? "true" : "false");
+		LOGI("sample counter support: %s", caps_.is_support_sample_counter ? "true" : "false");
+		LOGI("async readback support: %s", caps_.is_support_async_readback ? "true" : "false");
+		LOGI("sampler object support: %s", is_support_sampler_object_ ? "true" : "false");
 		
 		//
 		
@@ -314,6 +790,8 @@ namespace ERI {
 		// This call is redundant, but needed if dealing with multiple contexts.
 		if (context_) context_->SetAsCurrent();
 		
+		DeleteReleasedVertexArrays();
+		
 		EnableDepthWrite(true);
 		glClear(clear_bits_);
 	}
@@ -333,6 +811,10 @@ namespace ERI {
 		}
 #endif
 		
+		ResolveGpuTimer();
+		ResolveOverdrawCounter();
+		ResolveReadPixels();
+		
 		if (context_) context_->Present();
 	}
 	
@@ -341,56 +823,18 @@ namespace ERI {
 		if (data->vertex_count <= 0)
 			return;
 		
-		GLenum data_blend_src_factor = data->blend_src_factor;
-		if (data->alpha_premultiplied && data_blend_src_factor == GL_SRC_ALPHA) // TODO: other situation?
-		{
-			data_blend_src_factor = GL_ONE;
-		}
-		
-		if (blend_enable_ &&
-			(blend_src_factor_ != data_blend_src_factor ||
-			 blend_dst_factor_ != data->blend_dst_factor))
-		{
-			blend_src_factor_ = data_blend_src_factor;
-			blend_dst_factor_ = data->blend_dst_factor;
-			glBlendFunc(blend_src_factor_, blend_dst_factor_);
-		}
-		
-		if (alpha_test_enable_ &&
-			(alpha_test_func_ != data->alpha_test_func ||
-			 alpha_test_ref_ != data->alpha_test_ref))
-		{
-			alpha_test_func_ = data->alpha_test_func;
-			alpha_test_ref_ = data->alpha_test_ref;
-			
-			// TODO: handle in fragment shader
-		}
-		
-		if (depth_test_enable_ &&
-			depth_test_func_ != data->depth_test_func)
-		{
-			depth_test_func_ = data->depth_test_func;
-			glDepthFunc(depth_test_func_);
-		}
-		
-		//
-
-		if (is_view_proj_dirty_)
-		{
-			Matrix4::Multiply(current_view_proj_matrix_, current_proj_matrix_, current_view_matrix_);
-			is_view_proj_dirty_ = false;
-		}
+		ApplyRenderState(data);
 		
 		//
 		
-		const std::vector<int>& uniforms = Root::Ins().shader_mgr()->current_program()->uniforms();
+		ShaderProgram* program = Root::Ins().shader_mgr()->current_program();
 		
 		if (data->apply_identity_model_matrix)
 			tmp_matrix_[0] = current_view_proj_matrix_;
 		else
 			Matrix4::Multiply(tmp_matrix_[0], current_view_proj_matrix_, data->world_model_matrix);
 		
-		glUniformMatrix4fv(uniforms[UNIFORM_MODEL_VIEW_PROJ_MATRIX], 1, GL_FALSE, tmp_matrix_[0].m);
+		program->SetUniformMatrix4fv(UNIFORM_MODEL_VIEW_PROJ_MATRIX, tmp_matrix_[0].m);
 		
 		//
 		
@@ -401,22 +845,22 @@ namespace ERI {
 			else
 				Matrix4::Multiply(tmp_matrix_[0], current_view_matrix_, data->world_model_matrix);
 			
-			glUniformMatrix4fv(uniforms[UNIFORM_MODEL_VIEW_MATRIX], 1, GL_FALSE, tmp_matrix_[0].m);
+			program->SetUniformMatrix4fv(UNIFORM_MODEL_VIEW_MATRIX, tmp_matrix_[0].m);
 			
-			glUniform1i(uniforms[UNIFORM_FOG_ENABLE], 1);
-			glUniform1i(uniforms[UNIFORM_FOG_MODE], fog_mode_);
-			glUniform4f(uniforms[UNIFORM_FOG_COLOR], fog_color_.r, fog_color_.g, fog_color_.b, fog_color_.a);
+			program->SetUniform1i(UNIFORM_FOG_ENABLE, 1);
+			program->SetUniform1i(UNIFORM_FOG_MODE, fog_mode_);
+			program->SetUniform4f(UNIFORM_FOG_COLOR, fog_color_.r, fog_color_.g, fog_color_.b, fog_color_.a);
 
 			switch (fog_mode_)
 			{
 				case FOG_LINEAR:
-					glUniform1f(uniforms[UNIFORM_FOG_START], fog_start_);
-					glUniform1f(uniforms[UNIFORM_FOG_END], fog_end_);
+					program->SetUniform1f(UNIFORM_FOG_START, fog_start_);
+					program->SetUniform1f(UNIFORM_FOG_END, fog_end_);
 					break;
 
 				case FOG_EXP:
 				case FOG_EXP2:
-					glUniform1f(uniforms[UNIFORM_FOG_DENSITY], fog_density_);
+					program->SetUniform1f(UNIFORM_FOG_DENSITY, fog_density_);
 					break;
 
 				default:
@@ -426,196 +870,298 @@ namespace ERI {
 		}
 		else
 		{
-			glUniform1i(uniforms[UNIFORM_FOG_ENABLE], 0);
+			program->SetUniform1i(UNIFORM_FOG_ENABLE, 0);
 		}
 		
 		//
 		
-		bool need_setup_vertex = true;
+		VertexArrayKey key;
+		key.vertex_buffer = data->vertex_buffer;
+		key.index_buffer = data->index_count > 0 ? data->index_buffer : 0;
+		key.vertex_offset = data->vertex_offset;
+		key.vertex_format = data->vertex_format;
 		
-		if (is_support_vertex_array_object_ && !data->disable_vertex_array)
+		BindVertexData(key, data->disable_vertex_array);
+		
+		ApplyDataUniforms(program, data);
+		
+#if defined(DEBUG)
+		if (!Root::Ins().shader_mgr()->current_program()->Validate())
+			return;
+#endif
+		
+		CountDrawCall(depth_pass_);
+		
+		if (instance_num_ > 0)
 		{
-			if (0 == data->vertex_array)
-				(*fpGenVertexArrays)(1, &data->vertex_array);
-			else
-				need_setup_vertex = false;
+			EnableInstanceAttribs(true);
+			(*fpDrawArraysInstanced)(data->vertex_type, 0, data->vertex_count, instance_num_);
+			EnableInstanceAttribs(false);
+		}
+		else if (data->index_count > 0)
+		{
+			glDrawElements(data->vertex_type, data->index_count, GL_UNSIGNED_SHORT, (void*)(size_t)data->index_offset);
+		}
+		else
+		{
+			glDrawArrays(data->vertex_type, 0,  data->vertex_count);
+		}
+	}
 
-			(*fpBindVertexArray)(data->vertex_array);
+	void RendererES2::RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num)
+	{
+		ASSERT(caps_.is_support_instancing);
+		ASSERT(instance_buffer && instance_num > 0);
+		
+		// instance attributes are set on default vertex array and reset after draw
+		ASSERT(data->disable_vertex_array);
+		
+		instance_buffer_ = instance_buffer;
+		instance_num_ = instance_num;
+		
+		Render(data);
+		
+		instance_buffer_ = 0;
+		instance_num_ = 0;
+	}
+	
+	void RendererES2::RenderMulti(const RenderData* const* datas, int num)
+	{
+		ASSERT(num > 0 && num <= kMaxMultiDraw);
+		
+		const RenderData* data = datas[0];
+		
+		ApplyRenderState(data);
+		
+		//
+		
+		ShaderProgram* program = Root::Ins().shader_mgr()->current_program();
+		
+		// uploaded at once, picked by draw index in shader
+		for (int i = 0; i < num; ++i)
+		{
+			Matrix4::Multiply(tmp_matrix_[0], current_view_proj_matrix_, datas[i]->world_model_matrix);
+			memcpy(&multi_draw_matrices_[i * 16], tmp_matrix_[0].m, sizeof(tmp_matrix_[0].m));
 		}
 		
+		program->SetUniformMatrix4fv(UNIFORM_MODEL_VIEW_PROJ_MATRICES, num, multi_draw_matrices_);
+		
+		// fog needs model view matrix of each
+		ASSERT(!data->material_ref->accept_fog);
+		
+		program->SetUniform1i(UNIFORM_FOG_ENABLE, 0);
+		
 		//
 		
-		glBindBuffer(GL_ARRAY_BUFFER, data->vertex_buffer);
+		VertexArrayKey key;
+		key.vertex_buffer = data->vertex_buffer;
+		key.index_buffer = data->index_buffer;
+		key.vertex_format = data->vertex_format;
+		
+		int vertex_size = GetVertexSize(data->vertex_format);
+		
+		// with base vertex, ranges share attribute setup at remainder of vertex offset
+		key.vertex_offset = caps_.is_support_multi_draw ? data->vertex_offset % vertex_size : data->vertex_offset;
+		
+		BindVertexData(key, data->disable_vertex_array);
+		
+		ApplyDataUniforms(program, data);
+		
+#if defined(DEBUG)
+		if (!program->Validate())
+			return;
+#endif
 		
-		if (need_setup_vertex)
+		if (caps_.is_support_multi_draw)
 		{
-			GLint vertex_pos_size, vertex_stride;
-			void* vertex_pos_offset = NULL;
-			void* vertex_normal_offset = NULL;
-			void* vertex_tex_coord_offset[4];
-			int use_tex_coord_num = 0;
-			void* vertex_color_offset = NULL;
-			bool use_vertex_normal = false;
-			bool use_vertex_color = false;
+			GLsizei counts[kMaxMultiDraw];
+			const void* offsets[kMaxMultiDraw];
+			GLint base_vertices[kMaxMultiDraw];
 			
-			switch (data->vertex_format)
+			for (int i = 0; i < num; ++i)
 			{
-				case POS_TEX_2:
-					vertex_pos_size = 2;
-					vertex_stride = sizeof(vertex_2_pos_tex);
-					vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex, position);
-					vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex, tex_coord);
-					for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
-						vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
-					}
-					use_tex_coord_num = 1;
-					break;
-					
-				case POS_TEX2_2:
-					vertex_pos_size = 2;
-					vertex_stride = sizeof(vertex_2_pos_tex2);
-					vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex2, position);
-					vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex2, tex_coord);
-					vertex_tex_coord_offset[1] = (void*)offsetof(vertex_2_pos_tex2, tex_coord2);
-					for (int i = 2; i < MAX_TEXTURE_UNIT; ++i) {
-						vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
-					}
-					use_tex_coord_num = 2;
-					break;
-					
-				case POS_TEX_COLOR_2:
-					vertex_pos_size = 2;
-					vertex_stride = sizeof(vertex_2_pos_tex_color);
-					vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex_color, position);
-					vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex_color, tex_coord);
-					for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
-						vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
-					}
-					use_tex_coord_num = 1;
-					vertex_color_offset = (void*)offsetof(vertex_2_pos_tex_color, color);
-					use_vertex_color = true;
-					break;
-					
-				case POS_TEX2_COLOR_2:
-					vertex_pos_size = 2;
-					vertex_stride = sizeof(vertex_2_pos_tex2_color);
-					vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex2_color, position);
-					vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex2_color, tex_coord);
-					vertex_tex_coord_offset[1] = (void*)offsetof(vertex_2_pos_tex2_color, tex_coord2);
-					for (int i = 2; i < MAX_TEXTURE_UNIT; ++i) {
-						vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
-					}
-					use_tex_coord_num = 2;
-					vertex_color_offset = (void*)offsetof(vertex_2_pos_tex2_color, color);
-					use_vertex_color = true;
-					break;
-					
-				case POS_NORMAL_3:
-					vertex_pos_size = 3;
-					vertex_stride = sizeof(vertex_3_pos_normal);
-					vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal, position);
-					vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal, normal);
-					use_vertex_normal = true;
-					ASSERT(!texture_enable_);
-					break;
-					
-				case POS_NORMAL_TEX_3:
-					vertex_pos_size = 3;
-					vertex_stride = sizeof(vertex_3_pos_normal_tex);
-					vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal_tex, position);
-					vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal_tex, normal);
-					vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_normal_tex, tex_coord);
-					for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
-						vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
-					}
-					use_tex_coord_num = 1;
-					use_vertex_normal = true;
-					break;
-					
-				case POS_NORMAL_COLOR_TEX_3:
-					vertex_pos_size = 3;
-					vertex_stride = sizeof(vertex_3_pos_normal_color_tex);
-					vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal_color_tex, position);
-					vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal_color_tex, normal);
-					vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_normal_color_tex, tex_coord);
-					for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
-						vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
-					}
-					use_tex_coord_num = 1;
-					use_vertex_normal = true;
-					vertex_color_offset = (void*)offsetof(vertex_3_pos_normal_color_tex, color);
-					use_vertex_color = true;
-					break;
-					
-				case POS_COLOR_TEX_3:
-					vertex_pos_size = 3;
-					vertex_stride = sizeof(vertex_3_pos_color_tex);
-					vertex_pos_offset = (void*)offsetof(vertex_3_pos_color_tex, position);
-					vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_color_tex, tex_coord);
-					for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
-						vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
-					}
-					use_tex_coord_num = 1;
-					vertex_color_offset = (void*)offsetof(vertex_3_pos_color_tex, color);
-					use_vertex_color = true;
-					break;
-					
-				default:
-					ASSERT(0);
-					break;
+				ASSERT(datas[i]->vertex_offset % vertex_size == key.vertex_offset);
+				
+				counts[i] = datas[i]->index_count;
+				offsets[i] = (const void*)(size_t)datas[i]->index_offset;
+				base_vertices[i] = datas[i]->vertex_offset / vertex_size;
 			}
 			
-			glVertexAttribPointer(ATTRIB_VERTEX, vertex_pos_size, GL_FLOAT, GL_FALSE, vertex_stride, vertex_pos_offset);
-			glEnableVertexAttribArray(ATTRIB_VERTEX);
-
-			if (use_vertex_normal)
+			CountDrawCall(depth_pass_);
+			
+			(*fpMultiDrawElementsBaseVertex)(data->vertex_type, counts, GL_UNSIGNED_SHORT, offsets, num, base_vertices);
+		}
+		else
+		{
+			// draw index is a constant attribute, so no uniform upload between draws
+			for (int i = 0; i < num; ++i)
 			{
-				glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, vertex_stride, vertex_normal_offset);
-				glEnableVertexAttribArray(ATTRIB_NORMAL);
+				if (i > 0)
+				{
+					key.vertex_offset = datas[i]->vertex_offset;
+					BindVertexData(key, datas[i]->disable_vertex_array);
+				}
+				
+				glVertexAttrib1f(ATTRIB_DRAW_IDX, static_cast<GLfloat>(i));
+				
+				CountDrawCall(depth_pass_);
+				
+				glDrawElements(datas[i]->vertex_type, datas[i]->index_count, GL_UNSIGNED_SHORT, (void*)(size_t)datas[i]->index_offset);
 			}
-			else
+		}
+	}
+	
+	void RendererES2::EnableInstanceAttribs(bool enable)
+	{
+		static const GLuint kTransformAttribs[2] = { ATTRIB_INSTANCE_TRANSFORM0, ATTRIB_INSTANCE_TRANSFORM1 };
+		
+		if (enable)
+		{
+			GLsizei stride = sizeof(instance_sprite);
+			
+			BindArrayBuffer(instance_buffer_);
+			
+			for (int i = 0; i < 2; ++i)
 			{
-				glDisableVertexAttribArray(ATTRIB_NORMAL);
+				glVertexAttribPointer(kTransformAttribs[i], 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(instance_sprite, transform) + i * 4 * sizeof(GLfloat)));
 			}
+			glVertexAttribPointer(ATTRIB_INSTANCE_TEX_RECT, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(instance_sprite, tex_rect));
+			glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(instance_sprite, color));
+		}
+		
+		GLuint attribs[4] = { kTransformAttribs[0], kTransformAttribs[1], ATTRIB_INSTANCE_TEX_RECT, ATTRIB_COLOR };
+		
+		for (int i = 0; i < 4; ++i)
+		{
+			if (enable)
+				glEnableVertexAttribArray(attribs[i]);
+			else
+				glDisableVertexAttribArray(attribs[i]);
+			
+			(*fpVertexAttribDivisor)(attribs[i], enable ? 1 : 0);
+		}
+		
+		// vertex color attribute of default vertex array is changed
+		is_default_vertex_valid_ = false;
+	}
+	
+	void RendererES2::ApplyRenderState(const RenderData* data)
+	{
+		GLenum data_blend_src_factor = data->blend_src_factor;
+		if (data->alpha_premultiplied && data_blend_src_factor == GL_SRC_ALPHA) // TODO: other situation?
+		{
+			data_blend_src_factor = GL_ONE;
+		}
+		
+		if (blend_enable_ &&
+			(blend_src_factor_ != data_blend_src_factor ||
+			 blend_dst_factor_ != data->blend_dst_factor))
+		{
+			blend_src_factor_ = data_blend_src_factor;
+			blend_dst_factor_ = data->blend_dst_factor;
+			ApplyBlendFunc();
+		}
+		
+		if (alpha_test_enable_ &&
+			(alpha_test_func_ != data->alpha_test_func ||
+			 alpha_test_ref_ != data->alpha_test_ref))
+		{
+			alpha_test_func_ = data->alpha_test_func;
+			alpha_test_ref_ = data->alpha_test_ref;
+			
+			// func is compiled into shader variant, ref is set as uniform
+		}
+		
+		// depth of pre pass is laid down already
+		GLenum data_depth_test_func = data->depth_test_func;
+		if (depth_pass_ == DEPTH_PASS_SHADE && data_depth_test_func == GL_LESS)
+		{
+			data_depth_test_func = GL_LEQUAL;
+		}
+		
+		if (depth_test_enable_ &&
+			depth_test_func_ != data_depth_test_func)
+		{
+			depth_test_func_ = data_depth_test_func;
+			glDepthFunc(depth_test_func_);
+		}
+		
+		//
+
+		if (is_view_proj_dirty_)
+		{
+			Matrix4::Multiply(current_view_proj_matrix_, current_proj_matrix_, current_view_matrix_);
+			is_view_proj_dirty_ = false;
+		}
+	}
+	
+	void RendererES2::BindVertexData(const VertexArrayKey& key, bool disable_vertex_array)
+	{
+		if (is_support_vertex_array_object_ && !disable_vertex_array)
+		{
+			std::map<VertexArrayKey, GLuint>::iterator it = vertex_array_cache_.find(key);
+			bool is_new = (it == vertex_array_cache_.end());
 			
-			if (use_vertex_color)
+			if (is_new)
 			{
-				glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, 1, vertex_stride, vertex_color_offset);
-				glEnableVertexAttribArray(ATTRIB_COLOR);
+				if (vertex_array_cache_.size() >= kVertexArrayCacheMax)
+					ClearVertexArrayCache();
+				
+				GLuint vertex_array = 0;
+				(*fpGenVertexArrays)(1, &vertex_array);
+				it = vertex_array_cache_.insert(std::make_pair(key, vertex_array)).first;
 			}
-			else
+			
+			BindVertexArray(it->second);
+			
+			if (is_new)
 			{
-				glDisableVertexAttribArray(ATTRIB_COLOR);
+				BindArrayBuffer(key.vertex_buffer);
+				SetupVertexAttribs(key.vertex_format, key.vertex_offset);
+				
+				// element binding is kept by vertex array
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, key.index_buffer);
 			}
+		}
+		else
+		{
+			BindVertexArray(0);
 			
-			for (int i = 0; i < 2; ++i)
+			if (!is_default_vertex_valid_ || !(default_vertex_key_ == key))
 			{
-				if (i < use_tex_coord_num)
-				{
-					glVertexAttribPointer(ATTRIB_TEXCOORD0 + i, 2, GL_FLOAT, GL_FALSE, vertex_stride, vertex_tex_coord_offset[i]);
-					glEnableVertexAttribArray(ATTRIB_TEXCOORD0 + i);
-				}
-				else
-				{
-					glDisableVertexAttribArray(ATTRIB_TEXCOORD0 + i);
-				}
+				BindArrayBuffer(key.vertex_buffer);
+				SetupVertexAttribs(key.vertex_format, key.vertex_offset);
+				
+				default_vertex_key_ = key;
+				is_default_vertex_valid_ = true;
 			}
+			
+			if (key.index_buffer != 0)
+				BindElementBuffer(key.index_buffer);
 		}
-		
-		if (POS_TEX_COLOR_2 != data->vertex_format &&
-			POS_TEX2_COLOR_2 != data->vertex_format &&
-			POS_NORMAL_COLOR_TEX_3 != data->vertex_format &&
-			POS_COLOR_TEX_3 != data->vertex_format)
+	}
+	
+	void RendererES2::ApplyDataUniforms(ShaderProgram* program, const RenderData* data)
+	{
+		if (!IsVertexColorFormat(data->vertex_format))
 		{
 			GLfloat color[4] = { data->color.r, data->color.g, data->color.b, data->color.a };
 			glVertexAttrib4fv(ATTRIB_COLOR, color);
+			
+			// shader variants without vertex color take it as uniform
+			program->SetUniform4f(UNIFORM_COLOR, color[0], color[1], color[2], color[3]);
+		}
+		
+		if (data->material_ref->opacity_type == OPACITY_ALPHA_TEST)
+		{
+			program->SetUniform1f(UNIFORM_ALPHA_TEST_REF, data->alpha_test_ref);
 		}
 		
 		// TODO: more than 2 texture unit usage?
 		
 		if (texture_enable_)
 		{
-			glUniform1iv(uniforms[UNIFORM_TEX_USE_COORD_INDEX], 2, texture_unit_coord_idx_);
+			program->SetUniform1iv(UNIFORM_TEX_USE_COORD_INDEX, 2, texture_unit_coord_idx_);
 			
 			if (texture_unit_coord_idx_[0] >= 0 || texture_unit_coord_idx_[1] >= 0)
 			{
@@ -624,7 +1170,7 @@ namespace ERI {
 				if (data->is_tex_transform)
 				{
 					GLint tex_mat_enable[2] = { 1, 1 };
-					glUniform1iv(uniforms[UNIFORM_TEX_MATRIX_ENABLE], 2, tex_mat_enable);
+					program->SetUniform1iv(UNIFORM_TEX_MATRIX_ENABLE, 2, tex_mat_enable);
 					
 					Matrix4::Translate(tmp_matrix_[0], Vector3(data->tex_translate.x, data->tex_translate.y, 0.0f));
 					Matrix4::Scale(tmp_matrix_[1], Vector3(data->tex_scale.x, data->tex_scale.y, 1.0f));
@@ -633,43 +1179,339 @@ namespace ERI {
 					for (int i = 0; i < 2; ++i)
 					{
 						if (texture_unit_coord_idx_[i] >= 0)
-							glUniformMatrix4fv(uniforms[UNIFORM_TEX_MATRIX0 + i], 1, GL_FALSE, tmp_matrix_[2].m);
+							program->SetUniformMatrix4fv(UNIFORM_TEX_MATRIX0 + i, tmp_matrix_[2].m);
 					}
 				}
 				else
 				{
 					GLint tex_mat_enable[2] = { 0, 0 };
-					glUniform1iv(uniforms[UNIFORM_TEX_MATRIX_ENABLE], 2, tex_mat_enable);
+					program->SetUniform1iv(UNIFORM_TEX_MATRIX_ENABLE, 2, tex_mat_enable);
 				}
 			}
 		}
 		else
 		{
 			GLint idx[2] = { -1, -1 };
-			glUniform1iv(uniforms[UNIFORM_TEX_USE_COORD_INDEX], 2, idx);
+			program->SetUniform1iv(UNIFORM_TEX_USE_COORD_INDEX, 2, idx);
+		}
+	}
+	
+	void RendererES2::SetupVertexAttribs(VertexFormat vertex_format, int vertex_offset)
+	{
+		GLint vertex_pos_size, vertex_stride;
+		void* vertex_pos_offset = NULL;
+		void* vertex_normal_offset = NULL;
+		void* vertex_tex_coord_offset[4];
+		int use_tex_coord_num = 0;
+		void* vertex_color_offset = NULL;
+		bool use_vertex_normal = false;
+		bool use_vertex_color = false;
+		GLenum vertex_normal_type = GL_FLOAT;
+		GLenum vertex_tex_coord_type = GL_FLOAT;
+		
+		switch (vertex_format)
+		{
+			case POS_TEX_2:
+				vertex_pos_size = 2;
+				vertex_stride = sizeof(vertex_2_pos_tex);
+				vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex, position);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				break;
+				
+			case POS_TEX2_2:
+				vertex_pos_size = 2;
+				vertex_stride = sizeof(vertex_2_pos_tex2);
+				vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex2, position);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex2, tex_coord);
+				vertex_tex_coord_offset[1] = (void*)offsetof(vertex_2_pos_tex2, tex_coord2);
+				for (int i = 2; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 2;
+				break;
+				
+			case POS_TEX_COLOR_2:
+				vertex_pos_size = 2;
+				vertex_stride = sizeof(vertex_2_pos_tex_color);
+				vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex_color, position);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex_color, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				vertex_color_offset = (void*)offsetof(vertex_2_pos_tex_color, color);
+				use_vertex_color = true;
+				break;
+				
+			case POS_TEX2_COLOR_2:
+				vertex_pos_size = 2;
+				vertex_stride = sizeof(vertex_2_pos_tex2_color);
+				vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex2_color, position);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex2_color, tex_coord);
+				vertex_tex_coord_offset[1] = (void*)offsetof(vertex_2_pos_tex2_color, tex_coord2);
+				for (int i = 2; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 2;
+				vertex_color_offset = (void*)offsetof(vertex_2_pos_tex2_color, color);
+				use_vertex_color = true;
+				break;
+				
+			case POS_NORMAL_3:
+				vertex_pos_size = 3;
+				vertex_stride = sizeof(vertex_3_pos_normal);
+				vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal, position);
+				vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal, normal);
+				use_vertex_normal = true;
+				ASSERT(!texture_enable_);
+				break;
+				
+			case POS_NORMAL_TEX_3:
+				vertex_pos_size = 3;
+				vertex_stride = sizeof(vertex_3_pos_normal_tex);
+				vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal_tex, position);
+				vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal_tex, normal);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_normal_tex, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				use_vertex_normal = true;
+				break;
+				
+			case POS_NORMAL_COLOR_TEX_3:
+				vertex_pos_size = 3;
+				vertex_stride = sizeof(vertex_3_pos_normal_color_tex);
+				vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal_color_tex, position);
+				vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal_color_tex, normal);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_normal_color_tex, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				use_vertex_normal = true;
+				vertex_color_offset = (void*)offsetof(vertex_3_pos_normal_color_tex, color);
+				use_vertex_color = true;
+				break;
+				
+			case POS_COLOR_TEX_3:
+				vertex_pos_size = 3;
+				vertex_stride = sizeof(vertex_3_pos_color_tex);
+				vertex_pos_offset = (void*)offsetof(vertex_3_pos_color_tex, position);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_color_tex, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				vertex_color_offset = (void*)offsetof(vertex_3_pos_color_tex, color);
+				use_vertex_color = true;
+				break;
+				
+			case POS_TEX_2_PACKED:
+				vertex_pos_size = 2;
+				vertex_stride = sizeof(vertex_2_pos_tex_packed);
+				vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex_packed, position);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex_packed, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				vertex_tex_coord_type = GL_UNSIGNED_SHORT;
+				break;
+				
+			case POS_TEX2_COLOR_2_PACKED:
+				vertex_pos_size = 2;
+				vertex_stride = sizeof(vertex_2_pos_tex2_color_packed);
+				vertex_pos_offset = (void*)offsetof(vertex_2_pos_tex2_color_packed, position);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_2_pos_tex2_color_packed, tex_coord);
+				vertex_tex_coord_offset[1] = (void*)offsetof(vertex_2_pos_tex2_color_packed, tex_coord2);
+				for (int i = 2; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 2;
+				vertex_tex_coord_type = GL_UNSIGNED_SHORT;
+				vertex_color_offset = (void*)offsetof(vertex_2_pos_tex2_color_packed, color);
+				use_vertex_color = true;
+				break;
+				
+			case POS_NORMAL_3_PACKED:
+				vertex_pos_size = 3;
+				vertex_stride = sizeof(vertex_3_pos_normal_packed);
+				vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal_packed, position);
+				vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal_packed, normal);
+				use_vertex_normal = true;
+				vertex_normal_type = GL_BYTE;
+				ASSERT(!texture_enable_);
+				break;
+				
+			case POS_NORMAL_TEX_3_PACKED:
+				vertex_pos_size = 3;
+				vertex_stride = sizeof(vertex_3_pos_normal_tex_packed);
+				vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal_tex_packed, position);
+				vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal_tex_packed, normal);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_normal_tex_packed, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				use_vertex_normal = true;
+				vertex_normal_type = GL_BYTE;
+				vertex_tex_coord_type = GL_UNSIGNED_SHORT;
+				break;
+				
+			case POS_NORMAL_COLOR_TEX_3_PACKED:
+				vertex_pos_size = 3;
+				vertex_stride = sizeof(vertex_3_pos_normal_color_tex_packed);
+				vertex_pos_offset = (void*)offsetof(vertex_3_pos_normal_color_tex_packed, position);
+				vertex_normal_offset = (void*)offsetof(vertex_3_pos_normal_color_tex_packed, normal);
+				vertex_tex_coord_offset[0] = (void*)offsetof(vertex_3_pos_normal_color_tex_packed, tex_coord);
+				for (int i = 1; i < MAX_TEXTURE_UNIT; ++i) {
+					vertex_tex_coord_offset[i] = vertex_tex_coord_offset[0];
+				}
+				use_tex_coord_num = 1;
+				use_vertex_normal = true;
+				vertex_normal_type = GL_BYTE;
+				vertex_tex_coord_type = GL_UNSIGNED_SHORT;
+				vertex_color_offset = (void*)offsetof(vertex_3_pos_normal_color_tex_packed, color);
+				use_vertex_color = true;
+				break;
+				
+			default:
+				ASSERT(0);
+				break;
 		}
 		
-#if defined(DEBUG)
-		if (!Root::Ins().shader_mgr()->current_program()->Validate())
-			return;
-#endif
+		if (vertex_offset > 0)
+		{
+			vertex_pos_offset = (char*)vertex_pos_offset + vertex_offset;
+			vertex_normal_offset = (char*)vertex_normal_offset + vertex_offset;
+			vertex_color_offset = (char*)vertex_color_offset + vertex_offset;
+			for (int i = 0; i < use_tex_coord_num; ++i) {
+				vertex_tex_coord_offset[i] = (char*)vertex_tex_coord_offset[i] + vertex_offset;
+			}
+		}
 		
-		if (data->index_count > 0)
+		glVertexAttribPointer(ATTRIB_VERTEX, vertex_pos_size, GL_FLOAT, GL_FALSE, vertex_stride, vertex_pos_offset);
+		glEnableVertexAttribArray(ATTRIB_VERTEX);
+
+		if (use_vertex_normal)
 		{
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data->index_buffer);
-			glDrawElements(data->vertex_type, data->index_count, GL_UNSIGNED_SHORT, 0);
+			glVertexAttribPointer(ATTRIB_NORMAL, 3, vertex_normal_type, vertex_normal_type != GL_FLOAT, vertex_stride, vertex_normal_offset);
+			glEnableVertexAttribArray(ATTRIB_NORMAL);
 		}
 		else
 		{
-			glDrawArrays(data->vertex_type, 0,  data->vertex_count);
+			glDisableVertexAttribArray(ATTRIB_NORMAL);
 		}
 		
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (use_vertex_color)
+		{
+			glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, 1, vertex_stride, vertex_color_offset);
+			glEnableVertexAttribArray(ATTRIB_COLOR);
+		}
+		else
+		{
+			glDisableVertexAttribArray(ATTRIB_COLOR);
+		}
 		
-		if (is_support_vertex_array_object_)
-			(*fpBindVertexArray)(0);
+		for (int i = 0; i < 2; ++i)
+		{
+			if (i < use_tex_coord_num)
+			{
+				glVertexAttribPointer(ATTRIB_TEXCOORD0 + i, 2, vertex_tex_coord_type, vertex_tex_coord_type != GL_FLOAT, vertex_stride, vertex_tex_coord_offset[i]);
+				glEnableVertexAttribArray(ATTRIB_TEXCOORD0 + i);
+			}
+			else
+			{
+				glDisableVertexAttribArray(ATTRIB_TEXCOORD0 + i);
+			}
+		}
 	}
-
+	
+	void RendererES2::BindVertexArray(GLuint vertex_array)
+	{
+		if (!is_support_vertex_array_object_)
+			return;
+		
+		if (bound_vertex_array_ == vertex_array)
+		{
+			++current_stats_.bind_skipped;
+			return;
+		}
+		
+		(*fpBindVertexArray)(vertex_array);
+		bound_vertex_array_ = vertex_array;
+		++current_stats_.bind_issued;
+	}
+	
+	void RendererES2::BindArrayBuffer(GLuint buffer)
+	{
+		if (bound_array_buffer_ == buffer)
+		{
+			++current_stats_.bind_skipped;
+			return;
+		}
+		
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		bound_array_buffer_ = buffer;
+		++current_stats_.bind_issued;
+	}
+	
+	void RendererES2::BindElementBuffer(GLuint buffer)
+	{
+		ASSERT(!is_support_vertex_array_object_ || 0 == bound_vertex_array_);
+		
+		if (bound_element_buffer_ == buffer)
+		{
+			++current_stats_.bind_skipped;
+			return;
+		}
+		
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+		bound_element_buffer_ = buffer;
+		++current_stats_.bind_issued;
+	}
+	
+	void RendererES2::InvalidateBufferBinding()
+	{
+		bound_vertex_array_ = kInvalidBinding;
+		bound_array_buffer_ = kInvalidBinding;
+		bound_element_buffer_ = kInvalidBinding;
+	}
+	
+	void RendererES2::ClearVertexArrayCache()
+	{
+		DeleteReleasedVertexArrays();
+		
+		if (vertex_array_cache_.empty())
+			return;
+		
+		std::map<VertexArrayKey, GLuint>::iterator it = vertex_array_cache_.begin();
+		for (; it != vertex_array_cache_.end(); ++it)
+		{
+			(*fpDeleteVertexArrays)(1, &it->second);
+		}
+		vertex_array_cache_.clear();
+		
+		// bound one may be deleted
+		bound_vertex_array_ = kInvalidBinding;
+	}
+	
+	void RendererES2::DeleteReleasedVertexArrays()
+	{
+		if (released_vertex_arrays_.empty())
+			return;
+		
+		(*fpDeleteVertexArrays)(static_cast<GLsizei>(released_vertex_arrays_.size()), &released_vertex_arrays_[0]);
+		released_vertex_arrays_.clear();
+		
+		bound_vertex_array_ = kInvalidBinding;
+	}
+	
 	void RendererES2::ClearDepth()
 	{
 		if (use_depth_buffer_)
@@ -693,8 +1535,7 @@ namespace ERI {
 	
 	void RendererES2::CopyTexture(unsigned int texture, PixelFormat format)
 	{
-		glBindTexture(GL_TEXTURE_2D, texture);
-		now_texture_ = texture;
+		BindTextureForUpdate(texture);
 		
 		switch (format)
 		{
@@ -715,6 +1556,9 @@ namespace ERI {
 	
 	void RendererES2::CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format)
 	{
+		// read size assumes tightly packed rows, default alignment of 4 would pad the others
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		
 		switch (format)
 		{
 			case RGBA:
@@ -730,6 +1574,112 @@ namespace ERI {
 				ASSERT2(0, "invalid pixel format!");
 				break;
 		}
+		
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	}
+	
+	void RendererES2::ReadPixelsAsync(int x, int y, int width, int height, PixelFormat format, ReadPixelsFunc func, void* data)
+	{
+		ASSERT(func);
+		
+		if (!caps_.is_support_async_readback || readback_num_ >= kReadbackSlotNum)
+		{
+			ReadPixelsNow(x, y, width, height, format, func, data);
+			return;
+		}
+		
+		int size = GetReadPixelsSize(width, height, format);
+		if (size <= 0)
+			return;
+		
+		ReadbackSlot& slot = readback_slots_[(readback_head_ + readback_num_) % kReadbackSlotNum];
+		
+		if (0 == slot.buffer)
+			glGenBuffers(1, &slot.buffer);
+		
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		
+		if (slot.buffer_size < size)
+		{
+			glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+			slot.buffer_size = size;
+		}
+		
+		// with pack buffer bound, pixels go to offset 0 of it
+		CopyPixels(NULL, x, y, width, height, format);
+		
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		
+		slot.fence = CreateFence();
+		slot.frame_id = readback_frame_id_;
+		slot.width = width;
+		slot.height = height;
+		slot.format = format;
+		slot.func = func;
+		slot.data = data;
+		
+		++readback_num_;
+	}
+	
+	void RendererES2::CancelReadPixels(void* data)
+	{
+		for (int i = 0; i < readback_num_; ++i)
+		{
+			ReadbackSlot& slot = readback_slots_[(readback_head_ + i) % kReadbackSlotNum];
+			if (slot.data == data)
+				slot.func = NULL;
+		}
+	}
+	
+	void RendererES2::ResolveReadPixels()
+	{
+		++readback_frame_id_;
+		
+		while (readback_num_ > 0)
+		{
+			ReadbackSlot& slot = readback_slots_[readback_head_];
+			
+			// never wait, try again next frame
+			if (slot.fence)
+			{
+				GLenum result = (*fpClientWaitSync)(static_cast<GLsync>(slot.fence), 0, 0);
+				if (GL_ALREADY_SIGNALED != result && GL_CONDITION_SATISFIED != result)
+					break;
+				
+				DeleteFence(slot.fence);
+				slot.fence = NULL;
+			}
+			else if (readback_frame_id_ - slot.frame_id < 2)
+			{
+				break;
+			}
+			
+			if (slot.func)
+			{
+				int size = GetReadPixelsSize(slot.width, slot.height, slot.format);
+				
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+				
+				const void* pixels = (*fpMapBufferRange)(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+				if (pixels)
+				{
+					(*slot.func)(pixels, slot.width, slot.height, slot.format, slot.data);
+					(*fpUnmapBuffer)(GL_PIXEL_PACK_BUFFER);
+				}
+				else
+				{
+					LOGW("map pixel pack buffer failed");
+				}
+				
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			}
+			
+			slot.func = NULL;
+			slot.data = NULL;
+			
+			readback_head_ = (readback_head_ + 1) % kReadbackSlotNum;
+			--readback_num_;
+		}
 	}
 	
 	void RendererES2::RestoreRenderToBuffer()
@@ -742,6 +1692,16 @@ namespace ERI {
 		glBindFramebuffer(GL_FRAMEBUFFER, frame_buffers_[kDefaultFrameBufferIdx]);
 	}
 	
+	void RendererES2::SetScissor(int x, int y, int width, int height)
+	{
+		glScissor(x, y, width, height);
+	}
+	
+	void RendererES2::SetViewport(int x, int y, int width, int height)
+	{
+		glViewport(x, y, width, height);
+	}
+	
 	void RendererES2::EnableBlend(bool enable)
 	{
 		if (blend_enable_ != enable)
@@ -755,12 +1715,29 @@ namespace ERI {
 		}
 	}
 	
+	void RendererES2::EnableBlendSeparateAlpha(bool enable)
+	{
+		if (blend_separate_alpha_ != enable)
+		{
+			blend_separate_alpha_ = enable;
+			ApplyBlendFunc();
+		}
+	}
+	
+	void RendererES2::ApplyBlendFunc()
+	{
+		if (blend_separate_alpha_)
+			glBlendFuncSeparate(blend_src_factor_, blend_dst_factor_, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		else
+			glBlendFunc(blend_src_factor_, blend_dst_factor_);
+	}
+	
 	void RendererES2::EnableMaterial(const MaterialData* data)
 	{
 		EnableDepthTest(data->depth_test);
-		EnableDepthWrite(data->depth_write);
+		EnableDepthWrite(data->depth_write && depth_pass_ != DEPTH_PASS_SHADE);
 		EnableCullFace(data->cull_face, data->cull_front);
-		EnableColorWrite(data->color_write);
+		EnableColorWrite(depth_pass_ == DEPTH_PASS_PRE ? ColorFlags(false) : data->color_write);
 
 		texture_enable_ = (data->used_unit > 0);
 		
@@ -841,39 +1818,107 @@ namespace ERI {
 		{
 			ASSERT(unit.texture->id);
 			
-			if (now_texture_ != unit.texture->id)
-			{
-				now_texture_ = unit.texture->id;
-				glBindTexture(GL_TEXTURE_2D, now_texture_);
-				
-				glUniform1i(Root::Ins().shader_mgr()->current_program()->uniforms()[UNIFORM_TEX0 + idx], idx);
-			}
+			BindTexture(unit.texture->id);
 			
-			if (unit.texture->current_params.filter_min != unit.params.filter_min)
-			{
-				unit.texture->current_params.filter_min = unit.params.filter_min;
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, kParamFilters[unit.params.filter_min]);
-			}
-			if (unit.texture->current_params.filter_mag != unit.params.filter_mag)
-			{
-				unit.texture->current_params.filter_mag = unit.params.filter_mag;
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, kParamFilters[unit.params.filter_mag]);
-			}
-			if (unit.texture->current_params.wrap_s != unit.params.wrap_s)
+			// cheap when unchanged, and program may be switched without rebinding texture
+			Root::Ins().shader_mgr()->current_program()->SetUniform1i(UNIFORM_TEX0 + idx, idx);
+			
+			// textures shared by actors with different params would be changed back and forth otherwise
+			if (is_support_sampler_object_)
 			{
-				unit.texture->current_params.wrap_s = unit.params.wrap_s;
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, kParamWraps[unit.params.wrap_s]);
+				BindSampler(idx, unit.params);
 			}
-			if (unit.texture->current_params.wrap_t != unit.params.wrap_t)
+			else
 			{
-				unit.texture->current_params.wrap_t = unit.params.wrap_t;
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, kParamWraps[unit.params.wrap_t]);
+				if (unit.texture->current_params.filter_min != unit.params.filter_min)
+				{
+					unit.texture->current_params.filter_min = unit.params.filter_min;
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, kParamFilters[unit.params.filter_min]);
+				}
+				if (unit.texture->current_params.filter_mag != unit.params.filter_mag)
+				{
+					unit.texture->current_params.filter_mag = unit.params.filter_mag;
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, kParamFilters[unit.params.filter_mag]);
+				}
+				if (unit.texture->current_params.wrap_s != unit.params.wrap_s)
+				{
+					unit.texture->current_params.wrap_s = unit.params.wrap_s;
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, kParamWraps[unit.params.wrap_s]);
+				}
+				if (unit.texture->current_params.wrap_t != unit.params.wrap_t)
+				{
+					unit.texture->current_params.wrap_t = unit.params.wrap_t;
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, kParamWraps[unit.params.wrap_t]);
+				}
 			}
 		}
 		
 		texture_unit_coord_idx_[idx] = unit.coord_idx;
 	}
 	
+	void RendererES2::BindTexture(GLuint texture)
+	{
+		GLuint& bound_texture = now_textures_[now_active_texture_unit_ - GL_TEXTURE0];
+		
+		if (bound_texture == texture)
+		{
+			++current_stats_.texture_bind_skipped;
+			return;
+		}
+		
+		glBindTexture(GL_TEXTURE_2D, texture);
+		bound_texture = texture;
+		++current_stats_.texture_bind_issued;
+	}
+	
+	void RendererES2::BindTextureForUpdate(GLuint texture)
+	{
+		// may run on another thread and context in pipelined mode, where tracked binding is not the bound one
+		glBindTexture(GL_TEXTURE_2D, texture);
+		now_textures_[now_active_texture_unit_ - GL_TEXTURE0] = texture;
+		++current_stats_.texture_bind_issued;
+	}
+	
+	void RendererES2::BindSampler(int idx, const TextureParams& params)
+	{
+		int key = GetSamplerKey(params);
+		
+		std::map<int, GLuint>::iterator it = sampler_cache_.find(key);
+		if (it == sampler_cache_.end())
+		{
+			GLuint sampler;
+			(*fpGenSamplers)(1, &sampler);
+			(*fpSamplerParameteri)(sampler, GL_TEXTURE_MIN_FILTER, kParamFilters[params.filter_min]);
+			(*fpSamplerParameteri)(sampler, GL_TEXTURE_MAG_FILTER, kParamFilters[params.filter_mag]);
+			(*fpSamplerParameteri)(sampler, GL_TEXTURE_WRAP_S, kParamWraps[params.wrap_s]);
+			(*fpSamplerParameteri)(sampler, GL_TEXTURE_WRAP_T, kParamWraps[params.wrap_t]);
+			
+			it = sampler_cache_.insert(std::make_pair(key, sampler)).first;
+		}
+		
+		if (bound_samplers_[idx] != it->second)
+		{
+			(*fpBindSampler)(idx, it->second);
+			bound_samplers_[idx] = it->second;
+		}
+	}
+	
+	void RendererES2::ClearSamplerCache()
+	{
+		if (sampler_cache_.empty())
+			return;
+		
+		std::map<int, GLuint>::iterator it = sampler_cache_.begin();
+		for (; it != sampler_cache_.end(); ++it)
+		{
+			(*fpDeleteSamplers)(1, &it->second);
+		}
+		sampler_cache_.clear();
+		
+		for (int i = 0; i < MAX_TEXTURE_UNIT; ++i)
+			bound_samplers_[i] = 0;
+	}
+	
 	void RendererES2::DisableTextureUnit(int idx)
 	{
 		texture_unit_coord_idx_[idx] = -1;
@@ -902,8 +1947,7 @@ namespace ERI {
 
 		GLuint texture;
 		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		now_texture_ = texture;
+		BindTextureForUpdate(texture);
 		
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -948,8 +1992,7 @@ namespace ERI {
 
 		GLuint texture;
 		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		now_texture_ = texture;
+		BindTextureForUpdate(texture);
 		
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -967,8 +2010,7 @@ namespace ERI {
 
 		if (context_) context_->SetAsCurrent();
 		
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		now_texture_ = texture_id;
+		BindTextureForUpdate(texture_id);
 		
 		switch (format)
 		{
@@ -993,15 +2035,22 @@ namespace ERI {
 		
 		if (context_) context_->SetAsCurrent();
 
-		if (now_texture_ == texture_id)
+		// deleted texture is unbound from all units
+		for (int i = 0; i < MAX_TEXTURE_UNIT; ++i)
 		{
-			glBindTexture(GL_TEXTURE_2D, 0);
-			now_texture_ = 0;
+			if (now_textures_[i] == texture_id)
+				now_textures_[i] = 0;
 		}
 		
 		GLuint id = texture_id;
 		glDeleteTextures(1, &id);
 	}
+	
+	void RendererES2::InvalidateTextureBinding()
+	{
+		for (int i = 0; i < MAX_TEXTURE_UNIT; ++i)
+			now_textures_[i] = kInvalidBinding;
+	}
 
 	void RendererES2::BindDefaultFrameBuffer()
 	{
@@ -1032,25 +2081,44 @@ namespace ERI {
 		
 		glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
 		
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		now_texture_ = texture_id;
+		BindTextureForUpdate(texture_id);
 		
 		// attach the texture to the framebuffer
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_id, 0);
 		
-		// TODO: use depth buffer?
-		
-		//// allocate and attach a depth buffer
-		//GLuint depth_render_buffer;
-		//glGenRenderbuffersOES(1, &depth_render_buffer);
-		//glBindRenderbufferOES(GL_RENDERBUFFER_OES, depth_render_buffer);
-		//glRenderbufferStorageOES(GL_RENDERBUFFER_OES, GL_DEPTH_COMPONENT16_OES, width, height);
-		//glFramebufferRenderbufferOES(GL_FRAMEBUFFER_OES, GL_DEPTH_ATTACHMENT_OES, GL_RENDERBUFFER_OES, depth_render_buffer);
-		
 		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 		ASSERT2(status == GL_FRAMEBUFFER_COMPLETE, "Failed to make complete framebuffer object %x", status);
 	}
 	
+	void RendererES2::BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer)
+	{
+		ASSERT(width > 0 && height > 0 && frame_buffer > 0);
+		
+		if (context_) context_->SetAsCurrent();
+		
+		for (int i = kDefaultFrameBufferIdx + 1; i < kMaxFrameBuffer; ++i)
+		{
+			if (frame_buffers_[i] == frame_buffer)
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+				
+				if (!frame_buffer_depths_[i])
+					glGenRenderbuffers(1, &frame_buffer_depths_[i]);
+				
+				// allocate and attach a depth buffer
+				glBindRenderbuffer(GL_RENDERBUFFER, frame_buffer_depths_[i]);
+				glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+				glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, frame_buffer_depths_[i]);
+				
+				GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+				ASSERT2(status == GL_FRAMEBUFFER_COMPLETE, "Failed to make complete framebuffer object %x", status);
+				return;
+			}
+		}
+		
+		ASSERT2(0, "frame buffer %d is not generated", frame_buffer);
+	}
+	
 	void RendererES2::ReleaseFrameBuffer(int frame_buffer)
 	{
 		ASSERT(frame_buffer > 0);
@@ -1063,30 +2131,366 @@ namespace ERI {
 			{
 				glDeleteFramebuffers(1, &frame_buffers_[i]);
 				frame_buffers_[i] = 0;
+				
+				if (frame_buffer_depths_[i])
+				{
+					glDeleteRenderbuffers(1, &frame_buffer_depths_[i]);
+					frame_buffer_depths_[i] = 0;
+				}
 				return;
 			}
 		}
 	}
 	
+	unsigned int RendererES2::GenerateBuffer()
+	{
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		return buffer;
+	}
+	
+	void RendererES2::UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage)
+	{
+		ASSERT(buffer);
+		
+		GLenum target = (BUFFER_INDEX == type) ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+		
+		// don't change element binding of cached vertex arrays
+		if (BUFFER_INDEX == type && is_support_vertex_array_object_)
+			(*fpBindVertexArray)(0);
+		
+		glBindBuffer(target, buffer);
+		glBufferData(target, size, data, (BUFFER_USAGE_DYNAMIC == usage) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+		
+		// may be called on update thread with its own context, so only invalidate
+		InvalidateBufferBinding();
+	}
+	
+	void RendererES2::UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size)
+	{
+		ASSERT(buffer);
+		
+		GLenum target = (BUFFER_INDEX == type) ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+		
+		if (BUFFER_INDEX == type && is_support_vertex_array_object_)
+			(*fpBindVertexArray)(0);
+		
+		glBindBuffer(target, buffer);
+		glBufferSubData(target, offset, size, data);
+		
+		InvalidateBufferBinding();
+	}
+	
+	void RendererES2::ReleaseBuffer(unsigned int buffer)
+	{
+		if (buffer)
+		{
+			std::map<VertexArrayKey, GLuint>::iterator it = vertex_array_cache_.begin();
+			while (it != vertex_array_cache_.end())
+			{
+				if (it->first.vertex_buffer == buffer || it->first.index_buffer == buffer)
+				{
+					// may be called on update context, deleted at next RenderStart
+					released_vertex_arrays_.push_back(it->second);
+					vertex_array_cache_.erase(it++);
+				}
+				else
+				{
+					++it;
+				}
+			}
+			
+			if (default_vertex_key_.vertex_buffer == buffer)
+				is_default_vertex_valid_ = false;
+			
+			GLuint buffer_id = buffer;
+			glDeleteBuffers(1, &buffer_id);
+			
+			// name may be reused by next generated buffer
+			InvalidateBufferBinding();
+		}
+	}
+	
 	void RendererES2::ReleaseRenderData(RenderData& data)
 	{
-		if (data.index_buffer != 0)
+		ReleaseBuffer(data.index_buffer);
+		ReleaseBuffer(data.vertex_buffer);
+		
+		data.index_buffer = 0;
+		data.vertex_buffer = 0;
+	}
+	
+	void* RendererES2::CreateFence()
+	{
+		if (!is_support_sync_)
+			return NULL;
+		
+		return (*fpFenceSync)(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	
+	void RendererES2::WaitFence(void* fence)
+	{
+		if (NULL == fence)
+			return;
+		
+		static const GLuint64 kTimeout = 1000000000; // nanoseconds
+		
+		GLenum result;
+		do
+		{
+			result = (*fpClientWaitSync)(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, kTimeout);
+		}
+		while (GL_TIMEOUT_EXPIRED == result);
+		
+		if (GL_WAIT_FAILED == result)
+		{
+			LOGW("wait fence failed");
+		}
+	}
+	
+	void RendererES2::DeleteFence(void* fence)
+	{
+		if (fence)
+			(*fpDeleteSync)(static_cast<GLsync>(fence));
+	}
+	
+	bool RendererES2::GetProgramBinary(GLuint program, GLenum& out_format, std::vector<unsigned char>& out_binary)
+	{
+		if (!is_support_program_binary_)
+			return false;
+		
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return false;
+		
+		out_binary.resize(length);
+		
+		GLsizei written = 0;
+		(*fpGetProgramBinary)(program, length, &written, &out_format, &out_binary[0]);
+		if (written <= 0)
+			return false;
+		
+		out_binary.resize(written);
+		
+		return true;
+	}
+	
+	bool RendererES2::LoadProgramBinary(GLuint program, GLenum format, const void* binary, int length)
+	{
+		if (!is_support_program_binary_)
+			return false;
+		
+		(*fpProgramBinary)(program, format, binary, length);
+		
+		// driver rejects binary of other version or hardware by failing link
+		GLint status = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		
+		return status != 0;
+	}
+	
+	void RendererES2::EnableGpuTimer(bool enable)
+	{
+		// applied at frame end so no scope is left open
+		gpu_timer_enable_request_ = enable && caps_.is_support_gpu_timer;
+	}
+	
+	void RendererES2::BeginGpuTimer(GpuTimerScope scope, int id /*= -1*/)
+	{
+		if (!gpu_timer_enable_)
+			return;
+		
+		GpuTimerFrame& frame = gpu_timer_frames_[gpu_timer_frame_idx_];
+		
+		GpuTimerRecord record;
+		record.scope = scope;
+		record.id = id;
+		record.depth = static_cast<int>(gpu_timer_stack_.size());
+		record.begin_query = IssueGpuTimestamp();
+		record.end_query = -1;
+		
+		if (id < 0 && !gpu_timer_stack_.empty())
+			record.id = frame.records[gpu_timer_stack_.back()].id;
+		
+		gpu_timer_stack_.push_back(static_cast<int>(frame.records.size()));
+		frame.records.push_back(record);
+	}
+	
+	void RendererES2::EndGpuTimer()
+	{
+		if (!gpu_timer_enable_)
+			return;
+		
+		ASSERT(!gpu_timer_stack_.empty());
+		
+		GpuTimerFrame& frame = gpu_timer_frames_[gpu_timer_frame_idx_];
+		frame.records[gpu_timer_stack_.back()].end_query = IssueGpuTimestamp();
+		gpu_timer_stack_.pop_back();
+	}
+	
+	int RendererES2::IssueGpuTimestamp()
+	{
+		GpuTimerFrame& frame = gpu_timer_frames_[gpu_timer_frame_idx_];
+		
+		if (frame.query_num == static_cast<int>(frame.queries.size()))
+		{
+			frame.queries.push_back(0);
+			(*fpGenQueries)(1, &frame.queries.back());
+		}
+		
+		(*fpQueryCounter)(frame.queries[frame.query_num], GL_TIMESTAMP);
+		
+		return frame.query_num++;
+	}
+	
+	void RendererES2::ResolveGpuTimer()
+	{
+		ASSERT2(gpu_timer_stack_.empty(), "gpu timer scope not ended");
+		
+		gpu_timer_frames_[gpu_timer_frame_idx_].frame_id = gpu_timer_frame_id_;
+		gpu_timer_frame_idx_ = (gpu_timer_frame_idx_ + 1) % kGpuTimerFrameNum;
+		
+		++gpu_timer_frame_id_;
+		
+		gpu_timer_enable_ = gpu_timer_enable_request_;
+		
+		// oldest slot is reused by next frame, read its results
+		
+		GpuTimerFrame& frame = gpu_timer_frames_[gpu_timer_frame_idx_];
+		
+		if (frame.query_num == 0)
+			return;
+		
+		bool is_valid = true;
+		
+		GLuint available = 0;
+		(*fpGetQueryObjectuiv)(frame.queries[frame.query_num - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			// never wait, drop it
+			is_valid = false;
+		}
+		
+		if (is_gpu_timer_disjoint_ext_)
+		{
+			// also clears the flag, timestamps around a disjoint event are meaningless
+			GLint disjoint = 0;
+			glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+			if (disjoint)
+				is_valid = false;
+		}
+		
+		if (is_valid)
+		{
+			gpu_timer_stats_.frame_id = frame.frame_id;
+			gpu_timer_stats_.results.clear();
+			for (int i = 0; i < GPU_TIMER_SCOPE_MAX; ++i)
+				gpu_timer_stats_.scope_ms[i] = 0.0;
+			
+			GLuint64 frame_start = 0;
+			(*fpGetQueryObjectui64v)(frame.queries[0], GL_QUERY_RESULT, &frame_start);
+			
+			size_t num = frame.records.size();
+			for (size_t i = 0; i < num; ++i)
+			{
+				const GpuTimerRecord& record = frame.records[i];
+				
+				GLuint64 begin = 0, end = 0;
+				(*fpGetQueryObjectui64v)(frame.queries[record.begin_query], GL_QUERY_RESULT, &begin);
+				(*fpGetQueryObjectui64v)(frame.queries[record.end_query], GL_QUERY_RESULT, &end);
+				
+				GpuTimerResult result;
+				result.scope = record.scope;
+				result.id = record.id;
+				result.depth = record.depth;
+				result.start_ms = (begin - frame_start) * 0.000001;
+				result.elapsed_ms = (end > begin) ? (end - begin) * 0.000001 : 0.0;
+				
+				gpu_timer_stats_.scope_ms[record.scope] += result.elapsed_ms;
+				gpu_timer_stats_.results.push_back(result);
+			}
+		}
+		else
 		{
-			glDeleteBuffers(1, &data.index_buffer);
-			data.index_buffer = 0;
+			++gpu_timer_stats_.dropped_frame;
 		}
-		if (data.vertex_buffer != 0)
+		
+		frame.query_num = 0;
+		frame.records.clear();
+	}
+	
+	void RendererES2::EnableOverdrawCounter(bool enable)
+	{
+		// applied at frame end like gpu timer
+		overdraw_enable_request_ = enable && caps_.is_support_sample_counter;
+	}
+	
+	void RendererES2::BeginOverdrawCount()
+	{
+		if (!overdraw_enable_)
+			return;
+		
+		ASSERT2(!is_overdraw_counting_, "overdraw count can't nest");
+		
+		OverdrawFrame& frame = overdraw_frames_[overdraw_frame_idx_];
+		
+		if (frame.query_num == static_cast<int>(frame.queries.size()))
 		{
-			glDeleteBuffers(1, &data.vertex_buffer);
-			data.vertex_buffer = 0;
+			frame.queries.push_back(0);
+			(*fpGenQueries)(1, &frame.queries.back());
 		}
-		if (data.vertex_array != 0)
+		
+		(*fpBeginQuery)(GL_SAMPLES_PASSED, frame.queries[frame.query_num]);
+		++frame.query_num;
+		
+		is_overdraw_counting_ = true;
+	}
+	
+	void RendererES2::EndOverdrawCount()
+	{
+		if (!is_overdraw_counting_)
+			return;
+		
+		(*fpEndQuery)(GL_SAMPLES_PASSED);
+		
+		is_overdraw_counting_ = false;
+	}
+	
+	void RendererES2::ResolveOverdrawCounter()
+	{
+		ASSERT2(!is_overdraw_counting_, "overdraw count not ended");
+		
+		overdraw_frames_[overdraw_frame_idx_].pixel_num = backing_width_ * backing_height_;
+		overdraw_frame_idx_ = (overdraw_frame_idx_ + 1) % kGpuTimerFrameNum;
+		
+		overdraw_enable_ = overdraw_enable_request_;
+		
+		// oldest slot is reused by next frame, read its results
+		
+		OverdrawFrame& frame = overdraw_frames_[overdraw_frame_idx_];
+		
+		if (frame.query_num == 0)
+			return;
+		
+		GLuint available = 0;
+		(*fpGetQueryObjectuiv)(frame.queries[frame.query_num - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		
+		// never wait, drop it
+		if (available && frame.pixel_num > 0)
 		{
-			if (is_support_vertex_array_object_)
-				(*fpDeleteVertexArrays)(1, &data.vertex_array);
-      
-			data.vertex_array = 0;
+			double sample_num = 0.0;
+			for (int i = 0; i < frame.query_num; ++i)
+			{
+				GLuint samples = 0;
+				(*fpGetQueryObjectuiv)(frame.queries[i], GL_QUERY_RESULT, &samples);
+				sample_num += samples;
+			}
+			
+			overdraw_ = static_cast<float>(sample_num / frame.pixel_num);
 		}
+		
+		frame.query_num = 0;
 	}
 	
 	void RendererES2::SetBgColor(const Color& color)
@@ -21,7 +21,11 @@
 #import <OpenGLES/ES2/glext.h>
 #endif
 
+#include <vector>
+#include <map>
+
 #include "renderer.h"
+#include "render_data.h"
 #include "material_data.h"
 
 namespace ERI {
@@ -53,6 +57,8 @@ namespace ERI {
 		virtual void RenderStart();
 		virtual void RenderEnd();
 		virtual void Render(const RenderData* data);
+		virtual void RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num);
+		virtual void RenderMulti(const RenderData* const* datas, int num);
 		virtual void ClearDepth();
 		
 		virtual void SaveTransform() {}
@@ -61,11 +67,18 @@ namespace ERI {
 		virtual void EnableRenderToBuffer(int x, int y, int width, int height, int frame_buffer);
 		virtual void CopyTexture(unsigned int texture, PixelFormat format);
 		virtual void CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format);
+		virtual void ReadPixelsAsync(int x, int y, int width, int height, PixelFormat format, ReadPixelsFunc func, void* data);
+		virtual void CancelReadPixels(void* data);
 		virtual void RestoreRenderToBuffer();
 		
+		virtual void SetScissor(int x, int y, int width, int height);
+		virtual void SetViewport(int x, int y, int width, int height);
+		
 		virtual void EnableBlend(bool enable);
+		virtual void EnableBlendSeparateAlpha(bool enable);
 		virtual void EnableAlphaTest(bool enable) {}
 		virtual void EnableMaterial(const MaterialData* data);
+		virtual void SetDepthPass(DepthPass pass) { depth_pass_ = pass; }
 		
 		void EnableDepthTest(bool enable);
 		void EnableDepthWrite(bool enable);
@@ -75,6 +88,8 @@ namespace ERI {
 		void EnableTextureUnit(int idx, const TextureUnit& unit);
 		void DisableTextureUnit(int idx);
 		
+		inline FogMode fog_mode() const { return fog_mode_; }
+		
 		virtual void ObtainLight(int& idx) {}
 		virtual void ReleaseLight(int idx) {}
 		virtual void SetLightPos(int idx, const Vector3& pos) {}
@@ -95,14 +110,39 @@ namespace ERI {
 		virtual unsigned int GenerateTexture();
 		virtual void UpdateTexture(unsigned int texture_id, const void* buffer, int width, int height, PixelFormat format);
 		virtual void ReleaseTexture(int texture_id);
+		virtual void InvalidateTextureBinding();
 		
 		virtual void BindDefaultFrameBuffer();
 		virtual int GenerateFrameBuffer();
 		virtual void BindTextureToFrameBuffer(unsigned int texture_id, int frame_buffer);
+		virtual void BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer);
 		virtual void ReleaseFrameBuffer(int frame_buffer);
 		
+		virtual unsigned int GenerateBuffer();
+		virtual void UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage);
+		virtual void UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size);
+		virtual void ReleaseBuffer(unsigned int buffer);
+		
 		virtual void ReleaseRenderData(RenderData& data);
 		
+		virtual void* CreateFence();
+		virtual void WaitFence(void* fence);
+		virtual void DeleteFence(void* fence);
+		
+		// linked program binary for caching, format and data are driver specific
+		bool GetProgramBinary(GLuint program, GLenum& out_format, std::vector<unsigned char>& out_binary);
+		bool LoadProgramBinary(GLuint program, GLenum format, const void* binary, int length);
+		
+		inline bool is_support_program_binary() const { return is_support_program_binary_; }
+		
+		virtual void EnableGpuTimer(bool enable);
+		virtual void BeginGpuTimer(GpuTimerScope scope, int id = -1);
+		virtual void EndGpuTimer();
+		
+		virtual void EnableOverdrawCounter(bool enable);
+		virtual void BeginOverdrawCount();
+		virtual void EndOverdrawCount();
+		
 		virtual void SetBgColor(const Color& color);
 		virtual const Color& GetBgColor();
 		
@@ -123,11 +163,164 @@ namespace ERI {
 		void ActiveTextureUnit(GLenum idx);
 		
 		void AdjustProjectionForViewOrientation();
+		
+		void EnableInstanceAttribs(bool enable);
+		
+		struct VertexArrayKey;
+		
+		void ApplyRenderState(const RenderData* data);
+		void ApplyBlendFunc();
+		void ApplyDataUniforms(ShaderProgram* program, const RenderData* data);
+		void BindVertexData(const VertexArrayKey& key, bool disable_vertex_array);
+		void SetupVertexAttribs(VertexFormat vertex_format, int vertex_offset);
+		
+		void BindVertexArray(GLuint vertex_array);
+		void BindArrayBuffer(GLuint buffer);
+		void BindElementBuffer(GLuint buffer);
+		void InvalidateBufferBinding();
+		void ClearVertexArrayCache();
+		void DeleteReleasedVertexArrays();
+		
+		void BindTexture(GLuint texture);
+		void BindTextureForUpdate(GLuint texture); // never skipped
+		void BindSampler(int idx, const TextureParams& params);
+		void ClearSamplerCache();
+		
+		int IssueGpuTimestamp();
+		void ResolveGpuTimer();
+		void ResolveOverdrawCounter();
+		void ResolveReadPixels();
 
 		static const int kMaxFrameBuffer = 8;
 		static const int kDefaultFrameBufferIdx = 0;
 		
 		bool is_support_vertex_array_object_;
+		bool is_support_sync_;
+		bool is_support_program_binary_;
+		bool is_support_sampler_object_;
+		
+		// attribute pointers have vertex offset baked in, so it is part of the key,
+		// and ranges of shared geometry pool pages get their own vertex arrays
+		struct VertexArrayKey
+		{
+			VertexArrayKey() : vertex_buffer(0), index_buffer(0), vertex_offset(0), vertex_format(POS_TEX_2) {}
+			
+			bool operator<(const VertexArrayKey& key) const
+			{
+				if (vertex_buffer != key.vertex_buffer) return vertex_buffer < key.vertex_buffer;
+				if (index_buffer != key.index_buffer) return index_buffer < key.index_buffer;
+				if (vertex_offset != key.vertex_offset) return vertex_offset < key.vertex_offset;
+				return vertex_format < key.vertex_format;
+			}
+			
+			bool operator==(const VertexArrayKey& key) const
+			{
+				return vertex_buffer == key.vertex_buffer &&
+					index_buffer == key.index_buffer &&
+					vertex_offset == key.vertex_offset &&
+					vertex_format == key.vertex_format;
+			}
+			
+			GLuint			vertex_buffer, index_buffer;
+			int				vertex_offset;
+			VertexFormat	vertex_format;
+		};
+		
+		// stale entries of freed ranges are only dropped with their buffers, so cleared as a whole when full
+		static const size_t kVertexArrayCacheMax = 1024;
+		
+		static const GLuint kInvalidBinding = ~0u;
+		
+		std::map<VertexArrayKey, GLuint>	vertex_array_cache_;
+		
+		// vertex arrays are not shared between contexts, buffers released on update thread leave theirs to render context
+		std::vector<GLuint>	released_vertex_arrays_;
+		
+		// bound element buffer is of default vertex array only, cached ones keep their own
+		GLuint	bound_vertex_array_;
+		GLuint	bound_array_buffer_;
+		GLuint	bound_element_buffer_;
+		
+		// attributes of default vertex array, which are set up already for this key
+		VertexArrayKey	default_vertex_key_;
+		bool			is_default_vertex_valid_;
+		
+		// by packed filter and wrap params, so only a few are ever created,
+		// texture params of texture are not touched while they are used
+		std::map<int, GLuint>	sampler_cache_;
+		GLuint					bound_samplers_[MAX_TEXTURE_UNIT];
+		
+		struct GpuTimerRecord
+		{
+			GpuTimerScope	scope;
+			int				id;
+			int				depth;
+			int				begin_query, end_query;
+		};
+		
+		struct GpuTimerFrame
+		{
+			GpuTimerFrame() : query_num(0), frame_id(0) {}
+			
+			std::vector<GLuint>			queries; // reused, query_num of them are issued
+			int							query_num;
+			std::vector<GpuTimerRecord>	records;
+			int							frame_id;
+		};
+		
+		// results are read when slot is reused, kGpuTimerFrameNum - 1 frames later
+		static const int kGpuTimerFrameNum = 4;
+		
+		GpuTimerFrame		gpu_timer_frames_[kGpuTimerFrameNum];
+		std::vector<int>	gpu_timer_stack_;
+		int					gpu_timer_frame_idx_;
+		int					gpu_timer_frame_id_;
+		bool				gpu_timer_enable_;
+		bool				gpu_timer_enable_request_;
+		bool				is_gpu_timer_disjoint_ext_;
+		
+		struct OverdrawFrame
+		{
+			OverdrawFrame() : query_num(0), pixel_num(0) {}
+			
+			std::vector<GLuint>	queries; // reused, query_num of them are issued
+			int					query_num;
+			int					pixel_num;
+		};
+		
+		// same latency as gpu timer
+		OverdrawFrame	overdraw_frames_[kGpuTimerFrameNum];
+		int				overdraw_frame_idx_;
+		bool			overdraw_enable_;
+		bool			overdraw_enable_request_;
+		bool			is_overdraw_counting_;
+		
+		struct ReadbackSlot
+		{
+			ReadbackSlot() : buffer(0), buffer_size(0), fence(NULL), frame_id(0), width(0), height(0), format(RGBA), func(NULL), data(NULL) {}
+			
+			GLuint			buffer;	// pixel pack buffer, kept for reuse
+			int				buffer_size;
+			void*			fence;	// NULL if sync not supported
+			int				frame_id;
+			int				width, height;
+			PixelFormat		format;
+			ReadPixelsFunc	func;	// NULL if canceled
+			void*			data;
+		};
+		
+		// reads are issued and resolved in ring order
+		static const int kReadbackSlotNum = 3;
+		
+		ReadbackSlot	readback_slots_[kReadbackSlotNum];
+		int				readback_head_;	// oldest pending
+		int				readback_num_;
+		int				readback_frame_id_;
+		
+		GLuint	instance_buffer_;
+		int		instance_num_;
+		
+		float	multi_draw_matrices_[kMaxMultiDraw * 16];
 		
 		RenderContext*	context_;
 		
@@ -138,6 +331,7 @@ namespace ERI {
 		int width_, height_;
 		
 		GLuint frame_buffers_[kMaxFrameBuffer];
+		GLuint frame_buffer_depths_[kMaxFrameBuffer]; // depth render buffers of frame buffers
 		GLuint color_render_buffer_;
 
 		GLuint depth_buffer_;
@@ -148,6 +342,7 @@ namespace ERI {
 
 		GLenum blend_src_factor_, blend_dst_factor_;
 		bool blend_enable_;
+		bool blend_separate_alpha_;
 
 		GLenum alpha_test_func_;
 		GLclampf alpha_test_ref_;
@@ -156,6 +351,8 @@ namespace ERI {
 		GLenum depth_test_func_;
 		bool depth_test_enable_;
 		bool depth_write_enable_;
+		
+		DepthPass depth_pass_;
 
 		bool cull_face_enable_;
 		bool cull_front_;
@@ -166,7 +363,7 @@ namespace ERI {
 		int texture_unit_coord_idx_[MAX_TEXTURE_UNIT];
 		
 		GLenum now_active_texture_unit_;
-		unsigned int now_texture_;
+		GLuint now_textures_[MAX_TEXTURE_UNIT]; // of each unit
 		
 		Matrix4 current_view_matrix_, current_proj_matrix_, current_view_proj_matrix_;
 		Matrix4 tmp_matrix_[3];
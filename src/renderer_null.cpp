@@ -0,0 +1,261 @@
+//
+//  renderer_null.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "renderer_null.h"
+
+#include "render_data.h"
+#include "material_data.h"
+
+namespace ERI
+{
+	RendererNull::RendererNull() :
+		width_(0),
+		height_(0),
+		last_texture_(0),
+		last_buffer_(0),
+		last_frame_buffer_(0),
+		last_light_(0),
+		texture_num_(0),
+		buffer_num_(0),
+		depth_pass_(DEPTH_PASS_NONE),
+		is_recording_(false)
+	{
+	}
+
+	RendererNull::~RendererNull()
+	{
+		if (texture_num_ > 0 || buffer_num_ > 0)
+		{
+			LOGW("renderer null released with %d textures, %d buffers", texture_num_, buffer_num_);
+		}
+	}
+
+	bool RendererNull::Init(bool use_depth_buffer)
+	{
+		caps_.version = "null";
+		caps_.max_texture_size = 4096;
+		caps_.is_support_non_power_of_2_texture = true;
+		caps_.is_support_packed_vertex = true;
+
+		// instanced and multi draw paths need shader program, which is not created for null renderer
+
+		return true;
+	}
+
+	void RendererNull::Resize(int width, int height)
+	{
+		width_ = width;
+		height_ = height;
+	}
+
+	void RendererNull::RenderEnd()
+	{
+		Record(NULL_CMD_FRAME_END, 0);
+
+		last_frame_counters_ = frame_counters_;
+		frame_counters_.Reset();
+	}
+
+	void RendererNull::Render(const RenderData* data)
+	{
+		if (data->vertex_count <= 0)
+			return;
+
+		CountDrawCall(depth_pass_);
+
+		int count = data->index_count > 0 ? data->index_count : data->vertex_count;
+
+		counters_.vertex_count += count;
+		frame_counters_.vertex_count += count;
+
+		Record(NULL_CMD_RENDER, data->vertex_buffer, data->index_buffer, count, 0);
+	}
+
+	void RendererNull::RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num)
+	{
+		CountDrawCall(depth_pass_);
+
+		int count = data->vertex_count * instance_num;
+
+		counters_.vertex_count += count;
+		frame_counters_.vertex_count += count;
+
+		Record(NULL_CMD_RENDER_INSTANCED, data->vertex_buffer, instance_buffer, data->vertex_count, instance_num);
+	}
+
+	void RendererNull::RenderMulti(const RenderData* const* datas, int num)
+	{
+		ASSERT(num > 0 && num <= kMaxMultiDraw);
+
+		CountDrawCall(depth_pass_);
+
+		int count = 0;
+		for (int i = 0; i < num; ++i)
+			count += datas[i]->index_count;
+
+		counters_.vertex_count += count;
+		frame_counters_.vertex_count += count;
+
+		Record(NULL_CMD_RENDER_MULTI, datas[0]->vertex_buffer, datas[0]->index_buffer, count, num);
+	}
+
+	void RendererNull::ClearDepth()
+	{
+		Record(NULL_CMD_CLEAR_DEPTH, 0);
+	}
+
+	void RendererNull::CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format)
+	{
+		// same pixel layout as gl read back
+		int pixel_size = 0;
+		switch (format)
+		{
+			case RGBA: pixel_size = 4; break;
+			case RGB: pixel_size = 2; break;
+			case ALPHA: pixel_size = 1; break;
+			default: ASSERT(0); break;
+		}
+
+		memset(buffer, 0, width * height * pixel_size);
+	}
+
+	void RendererNull::EnableMaterial(const MaterialData* data)
+	{
+		unsigned int texture_id = (data->used_unit > 0 && data->texture_units[0].texture) ? data->texture_units[0].texture->id : 0;
+
+		Record(NULL_CMD_MATERIAL, texture_id, data->used_unit);
+	}
+
+	void RendererNull::ObtainLight(int& idx)
+	{
+		idx = last_light_++;
+	}
+
+	unsigned int RendererNull::GenerateTexture(const void* buffer, int width, int height, PixelFormat format, int buffer_size /*= 0*/)
+	{
+		unsigned int texture_id = GenerateTexture();
+
+		UpdateTexture(texture_id, buffer, width, height, format);
+
+		return texture_id;
+	}
+
+	unsigned int RendererNull::GenerateTexture()
+	{
+		++texture_num_;
+
+		Record(NULL_CMD_TEXTURE_CREATE, ++last_texture_);
+
+		return last_texture_;
+	}
+
+	void RendererNull::UpdateTexture(unsigned int texture_id, const void* buffer, int width, int height, PixelFormat format)
+	{
+		ASSERT(texture_id);
+
+		int bytes = 0;
+		switch (format)
+		{
+			case ALPHA: bytes = width * height; break;
+			case RGB: bytes = width * height * 2; break;
+			case RGBA: bytes = width * height * 4; break;
+			case RGBA_PVR_4BPP: bytes = width * height / 2; break;
+			case RGBA_PVR_2BPP: bytes = width * height / 4; break;
+			default: ASSERT(0); break;
+		}
+
+		if (buffer)
+		{
+			counters_.upload_bytes += bytes;
+			frame_counters_.upload_bytes += bytes;
+		}
+
+		Record(NULL_CMD_TEXTURE_UPDATE, texture_id, width, height);
+	}
+
+	void RendererNull::ReleaseTexture(int texture_id)
+	{
+		if (0 == texture_id)
+			return;
+
+		--texture_num_;
+
+		Record(NULL_CMD_TEXTURE_RELEASE, texture_id);
+	}
+
+	unsigned int RendererNull::GenerateBuffer()
+	{
+		++buffer_num_;
+
+		Record(NULL_CMD_BUFFER_CREATE, ++last_buffer_);
+
+		return last_buffer_;
+	}
+
+	void RendererNull::UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage)
+	{
+		ASSERT(buffer);
+
+		if (data)
+		{
+			counters_.upload_bytes += size;
+			frame_counters_.upload_bytes += size;
+		}
+
+		Record(NULL_CMD_BUFFER_UPLOAD, buffer, type, 0, size);
+	}
+
+	void RendererNull::UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size)
+	{
+		ASSERT(buffer);
+
+		counters_.upload_bytes += size;
+		frame_counters_.upload_bytes += size;
+
+		Record(NULL_CMD_BUFFER_UPLOAD, buffer, type, offset, size);
+	}
+
+	void RendererNull::ReleaseBuffer(unsigned int buffer)
+	{
+		if (0 == buffer)
+			return;
+
+		--buffer_num_;
+
+		Record(NULL_CMD_BUFFER_RELEASE, buffer);
+	}
+
+	void RendererNull::ReleaseRenderData(RenderData& data)
+	{
+		ReleaseBuffer(data.index_buffer);
+		ReleaseBuffer(data.vertex_buffer);
+
+		data.index_buffer = 0;
+		data.vertex_buffer = 0;
+	}
+
+	void RendererNull::Record(NullCommandType type, unsigned int id, int arg0 /*= 0*/, int arg1 /*= 0*/, int arg2 /*= 0*/)
+	{
+		++counters_.command_num[type];
+		++frame_counters_.command_num[type];
+
+		if (!is_recording_)
+			return;
+
+		NullCommand command;
+		command.type = type;
+		command.id = id;
+		command.args[0] = arg0;
+		command.args[1] = arg1;
+		command.args[2] = arg2;
+
+		commands_.push_back(command);
+	}
+}
@@ -0,0 +1,221 @@
+//
+//  renderer_null.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_RENDERER_NULL_H
+#define ERI_RENDERER_NULL_H
+
+#include "pch.h"
+
+#include <vector>
+
+#include "renderer.h"
+
+namespace ERI
+{
+	enum NullCommandType
+	{
+		NULL_CMD_RENDER,
+		NULL_CMD_RENDER_INSTANCED,
+		NULL_CMD_RENDER_MULTI,
+		NULL_CMD_CLEAR_DEPTH,
+		NULL_CMD_MATERIAL,
+		NULL_CMD_TEXTURE_CREATE,
+		NULL_CMD_TEXTURE_UPDATE,
+		NULL_CMD_TEXTURE_RELEASE,
+		NULL_CMD_BUFFER_CREATE,
+		NULL_CMD_BUFFER_UPLOAD,
+		NULL_CMD_BUFFER_RELEASE,
+		NULL_CMD_FRAME_END,
+		NULL_CMD_TYPE_MAX
+	};
+
+	struct NullCommand
+	{
+		NullCommandType	type;
+
+		// render: vertex buffer, index buffer, vertex or index count, instance or multi draw count
+		// material: first texture, texture unit count
+		// texture: texture, width, height
+		// buffer: buffer, buffer type, offset, size
+		unsigned int	id;
+		int				args[3];
+	};
+
+	struct NullCounters
+	{
+		NullCounters() { Reset(); }
+
+		void Reset()
+		{
+			for (int i = 0; i < NULL_CMD_TYPE_MAX; ++i)
+				command_num[i] = 0;
+
+			upload_bytes = 0;
+			vertex_count = 0;
+		}
+
+		int		command_num[NULL_CMD_TYPE_MAX];
+		int		upload_bytes;	// buffer and texture
+		int		vertex_count;	// index count for indexed draw
+	};
+
+	// Renderer issuing no GL call, for running scene, culling, batching and particle update
+	// without GPU or display, e.g. benchmarks and regression tests on build servers.
+	// Calls are counted, and recorded into a command log if recording is on.
+
+	class RendererNull : public Renderer
+	{
+	public:
+		RendererNull();
+		virtual ~RendererNull();
+
+		virtual bool Init(bool use_depth_buffer);
+
+		virtual void SetContextAsCurrent() {}
+
+		virtual void BackingLayer(const void* layer) {}
+		virtual void Resize(int width, int height);
+
+		virtual int width() { return width_; }
+		virtual int height() { return height_; }
+		virtual int backing_width() { return width_; }
+		virtual int backing_height() { return height_; }
+
+		virtual bool IsReadyToRender() { return true; }
+		virtual void RenderStart() {}
+		virtual void RenderEnd();
+		virtual void Render(const RenderData* data);
+		virtual void RenderInstanced(const RenderData* data, unsigned int instance_buffer, int instance_num);
+		virtual void RenderMulti(const RenderData* const* datas, int num);
+		virtual void ClearDepth();
+
+		virtual void SaveTransform() {}
+		virtual void RecoverTransform() {}
+
+		virtual void EnableRenderToBuffer(int x, int y, int width, int height, int frame_buffer) {}
+		virtual void CopyTexture(unsigned int texture, PixelFormat format) {}
+		virtual void CopyPixels(void* buffer, int x, int y, int width, int height, PixelFormat format);
+		virtual void ReadPixelsAsync(int x, int y, int width, int height, PixelFormat format, ReadPixelsFunc func, void* data) { ReadPixelsNow(x, y, width, height, format, func, data); }
+		virtual void CancelReadPixels(void* data) {}
+		virtual void RestoreRenderToBuffer() {}
+
+		virtual void SetScissor(int x, int y, int width, int height) {}
+		virtual void SetViewport(int x, int y, int width, int height) {}
+
+		virtual void EnableBlend(bool enable) {}
+		virtual void EnableBlendSeparateAlpha(bool enable) {}
+		virtual void EnableAlphaTest(bool enable) {}
+		virtual void EnableMaterial(const MaterialData* data);
+		virtual void SetDepthPass(DepthPass pass) { depth_pass_ = pass; }
+
+		virtual void ObtainLight(int& idx);
+		virtual void ReleaseLight(int idx) {}
+		virtual void SetLightPos(int idx, const Vector3& pos) {}
+		virtual void SetLightDir(int idx, const Vector3& dir) {}
+		virtual void SetLightSpotDir(int idx, const Vector3& dir) {}
+		virtual void SetLightAmbient(int idx, const Color& ambient) {}
+		virtual void SetLightDiffuse(int idx, const Color& diffuse) {}
+		virtual void SetLightSpecular(int idx, const Color& specular) {}
+		virtual void SetLightAttenuation(int idx, float constant, float linear, float quadratic) {}
+		virtual void SetLightSpotExponent(int idx, float exponent) {}
+		virtual void SetLightSpotCutoff(int idx, float cutoff) {}
+
+		virtual void SetFog(FogMode mode, float density = 1.f) {}
+		virtual void SetFogDistance(float start, float end = 1.f) {}
+		virtual void SetFogColor(const Color& color) {}
+
+		virtual unsigned int GenerateTexture(const void* buffer, int width, int height, PixelFormat format, int buffer_size = 0);
+		virtual unsigned int GenerateTexture();
+		virtual void UpdateTexture(unsigned int texture_id, const void* buffer, int width, int height, PixelFormat format);
+		virtual void ReleaseTexture(int texture_id);
+		virtual void InvalidateTextureBinding() {}
+
+		virtual void BindDefaultFrameBuffer() {}
+		virtual int GenerateFrameBuffer() { return ++last_frame_buffer_; }
+		virtual void BindTextureToFrameBuffer(unsigned int texture_id, int frame_buffer) {}
+		virtual void BindDepthBufferToFrameBuffer(int width, int height, int frame_buffer) {}
+		virtual void ReleaseFrameBuffer(int frame_buffer) {}
+
+		virtual unsigned int GenerateBuffer();
+		virtual void UpdateBuffer(unsigned int buffer, BufferType type, const void* data, int size, BufferUsage usage);
+		virtual void UpdateBufferRange(unsigned int buffer, BufferType type, int offset, const void* data, int size);
+		virtual void ReleaseBuffer(unsigned int buffer);
+
+		virtual void ReleaseRenderData(RenderData& data);
+
+		// nothing to wait for
+		virtual void* CreateFence() { return NULL; }
+		virtual void WaitFence(void* fence) {}
+		virtual void DeleteFence(void* fence) {}
+
+		virtual void EnableGpuTimer(bool enable) {}
+		virtual void BeginGpuTimer(GpuTimerScope scope, int id = -1) {}
+		virtual void EndGpuTimer() {}
+		
+		virtual void EnableOverdrawCounter(bool enable) {}
+		virtual void BeginOverdrawCount() {}
+		virtual void EndOverdrawCount() {}
+
+		virtual void SetBgColor(const Color& color) { bg_color_ = color; }
+		virtual const Color& GetBgColor() { return bg_color_; }
+
+		virtual void SetClearDepth(float clamped_depth) {}
+
+		virtual void UpdateView(const Matrix4& view_matrix) {}
+		virtual void UpdateView(const Vector3& eye, const Vector3& at, const Vector3& up) {}
+
+		virtual void UpdateProjection(const Matrix4& projection_matrix) {}
+		virtual void UpdateOrthoProjection(float width, float height, float near_z, float far_z) {}
+		virtual void UpdateOrthoProjection(float zoom, float near_z, float far_z) {}
+		virtual void UpdatePerspectiveProjection(float fov_y, float aspect, float near_z, float far_z) {}
+		virtual void UpdatePerspectiveProjection(float fov_y, float near_z, float far_z) {}
+
+		virtual void SetViewOrientation(ViewOrientation orientaion) { view_orientation_ = orientaion; }
+
+		inline void set_is_recording(bool is_recording) { is_recording_ = is_recording; }
+		inline bool is_recording() { return is_recording_; }
+
+		// commands since last clear, only if recording
+		inline const std::vector<NullCommand>& commands() { return commands_; }
+		inline void ClearCommands() { commands_.clear(); }
+
+		// counted whether recording or not, last_frame_counters is of last finished frame
+		inline const NullCounters& counters() { return counters_; }
+		inline const NullCounters& last_frame_counters() { return last_frame_counters_; }
+		inline void ResetCounters() { counters_.Reset(); }
+
+		// textures and buffers not released yet
+		inline int texture_num() { return texture_num_; }
+		inline int buffer_num() { return buffer_num_; }
+
+	private:
+		void Record(NullCommandType type, unsigned int id, int arg0 = 0, int arg1 = 0, int arg2 = 0);
+
+		int		width_, height_;
+		Color	bg_color_;
+
+		unsigned int	last_texture_;
+		unsigned int	last_buffer_;
+		int				last_frame_buffer_;
+		int				last_light_;
+
+		int		texture_num_;
+		int		buffer_num_;
+
+		DepthPass	depth_pass_;
+
+		bool						is_recording_;
+		std::vector<NullCommand>	commands_;
+
+		NullCounters	counters_;
+		NullCounters	frame_counters_;
+		NullCounters	last_frame_counters_;
+	};
+}
+
+#endif // ERI_RENDERER_NULL_H
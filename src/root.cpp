@@ -18,14 +18,24 @@
 #include "renderer_es2.h"
 #include "shader_mgr.h"
 #endif
+#include "renderer_null.h"
 
 #include "scene_mgr.h"
 #include "input_mgr.h"
 #include "texture_mgr.h"
 #include "font_mgr.h"
+#include "frame_pipeline.h"
+#include "dirty_rect_redraw.h"
+#include "dynamic_resolution.h"
+#include "stream_buffer.h"
+#include "geometry_pool.h"
+#include "frame_capture.h"
 
 namespace ERI {
 	
+	// per frame part, grows if not enough
+	static const int kStreamBufferFrameSize = 256 * 1024;
+	
 	Root* Root::ins_ptr_ = NULL;
 	
 	Root::Root() :
@@ -35,12 +45,21 @@ namespace ERI {
 		texture_mgr_(NULL),
 		font_mgr_(NULL),
 		shader_mgr_(NULL),
+		frame_pipeline_(NULL),
+		stream_buffer_(NULL),
+		geometry_pool_(NULL),
+		frame_capture_(NULL),
 		window_handle_(NULL)
 	{
 	}
 	
 	Root::~Root()
 	{
+		EnablePipeline(false);
+		
+		// layer caches hold textures
+		if (scene_mgr_) scene_mgr_->ReleaseLayerCache();
+		
 #ifdef ERI_RENDERER_ES2
 		if (shader_mgr_) delete shader_mgr_;
 #endif
@@ -49,26 +68,43 @@ namespace ERI {
 		if (texture_mgr_) delete texture_mgr_;
 		if (input_mgr_) delete input_mgr_;
 		if (scene_mgr_) delete scene_mgr_;
+		if (stream_buffer_) delete stream_buffer_;
+		if (geometry_pool_) delete geometry_pool_;
 		if (renderer_) delete renderer_;
 	}
 	
-	void Root::Init(bool use_depth_buffer /*= true*/)
+	void Root::Init(bool use_depth_buffer /*= true*/, bool is_headless /*= false*/)
 	{
-#ifdef ERI_RENDERER_ES2
-		renderer_ = new RendererES2;
-		if (renderer_->Init(use_depth_buffer))
+		if (is_headless)
 		{
-			shader_mgr_ = new ShaderMgr;
+			renderer_ = new RendererNull;
+			
+			if (!renderer_->Init(use_depth_buffer))
+			{
+				delete renderer_;
+				renderer_ = NULL;
+			}
 		}
-		else
+		
+#ifdef ERI_RENDERER_ES2
+		if (!renderer_ && !is_headless)
 		{
-			delete renderer_;
-			renderer_ = NULL;
+			RendererES2* renderer_es2 = new RendererES2;
+			renderer_ = renderer_es2;
+			if (renderer_->Init(use_depth_buffer))
+			{
+				shader_mgr_ = new ShaderMgr(renderer_es2);
+			}
+			else
+			{
+				delete renderer_;
+				renderer_ = NULL;
+			}
 		}
 #endif
 
 #ifdef ERI_RENDERER_ES1
-		if (!renderer_)
+		if (!renderer_ && !is_headless)
 		{
 			renderer_ = new RendererES1;
 			
@@ -82,6 +118,9 @@ namespace ERI {
 
 		ASSERT(renderer_);
 		
+		stream_buffer_ = new StreamBuffer(kStreamBufferFrameSize);
+		geometry_pool_ = new GeometryPool;
+		
 		scene_mgr_ = new SceneMgr;
 		input_mgr_ = new InputMgr;
 		texture_mgr_ = new TextureMgr;
@@ -93,9 +132,84 @@ namespace ERI {
 		if (!renderer_->IsReadyToRender())
 			return;
 		
-		renderer_->RenderStart();
-		scene_mgr_->Render(renderer_);
+		if (scene_mgr_->dirty_rect_redraw())
+		{
+			scene_mgr_->dirty_rect_redraw()->Render(renderer_);
+		}
+		else if (scene_mgr_->dynamic_resolution())
+		{
+			renderer_->RenderStart();
+			scene_mgr_->dynamic_resolution()->Render(renderer_);
+		}
+		else
+		{
+			renderer_->RenderStart();
+			scene_mgr_->Render(renderer_);
+		}
+		
 		renderer_->RenderEnd();
+		renderer_->EndFrameStats();
+		
+		stream_buffer_->NextFrame(renderer_);
+		geometry_pool_->NextFrame();
+	}
+	
+	void Root::EnableFrameCapture()
+	{
+		ASSERT(renderer_);
+		
+		if (frame_capture_)
+			return;
+		
+		frame_capture_ = new RendererCapture(renderer_);
+		renderer_ = frame_capture_;
+		
+		// stream buffer is created at init, create again so capture knows its buffer
+		delete stream_buffer_;
+		stream_buffer_ = new StreamBuffer(kStreamBufferFrameSize);
+	}
+	
+	void Root::EnablePipeline(bool enable)
+	{
+		if (enable == (frame_pipeline_ != NULL))
+			return;
+		
+		if (enable)
+		{
+#ifdef ERI_USE_THREAD
+			frame_pipeline_ = new FramePipeline;
+#else
+			LOGW("pipeline need thread support");
+#endif
+		}
+		else
+		{
+			// render thread should be stopped and its context current here
+			
+			FramePipeline* pipeline = frame_pipeline_;
+			frame_pipeline_ = NULL;
+			delete pipeline;
+			
+			// camera was applied by render thread
+			if (scene_mgr_) scene_mgr_->ResetCurrentCam();
+		}
+	}
+	
+	void Root::SubmitFrame()
+	{
+		ASSERT(frame_pipeline_);
+		
+		scene_mgr_->BuildSnapshot(frame_pipeline_->build_snapshot());
+		frame_pipeline_->Submit();
+		
+		geometry_pool_->NextFrame();
+	}
+	
+	bool Root::RenderFrame()
+	{
+		ASSERT(frame_pipeline_);
+		
+		return frame_pipeline_->Render(renderer_);
 	}
 
 }
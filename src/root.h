@@ -20,6 +20,10 @@ namespace ERI {
 	class TextureMgr;
 	class FontMgr;
 	class ShaderMgr;
+	class FramePipeline;
+	class StreamBuffer;
+	class GeometryPool;
+	class RendererCapture;
 	
 	class Root
 	{
@@ -27,15 +31,32 @@ namespace ERI {
 		Root();
 		~Root();
 		
-		void Init(bool use_depth_buffer = true);
+		// headless uses null renderer issuing no GL call, no shader program is created
+		void Init(bool use_depth_buffer = true, bool is_headless = false);
 		void Update();
 		
+		// pipelined mode, update thread calls SubmitFrame instead of Update,
+		// render thread owning GL context loops RenderFrame until it returns false
+		void EnablePipeline(bool enable);
+		void SubmitFrame();
+		bool RenderFrame();
+		
+		// wrap renderer to capture frames for replay, call right after Init,
+		// before any texture or buffer is created
+		void EnableFrameCapture();
+		
 		inline Renderer* renderer() { return renderer_; }
 		inline SceneMgr* scene_mgr() { return scene_mgr_; }
 		inline InputMgr* input_mgr() { return input_mgr_; }
 		inline TextureMgr* texture_mgr() { return texture_mgr_; }
 		inline FontMgr* font_mgr() { return font_mgr_; }
 		inline ShaderMgr* shader_mgr() { return shader_mgr_; }
+		inline FramePipeline* frame_pipeline() { return frame_pipeline_; }
+		inline StreamBuffer* stream_buffer() { return stream_buffer_; }
+		inline GeometryPool* geometry_pool() { return geometry_pool_; }
+		
+		// NULL if frame capture is not enabled
+		inline RendererCapture* frame_capture() { return frame_capture_; }
 
 		void* window_handle() { return window_handle_; }
 		inline void set_window_handle(void* handle) { window_handle_ = handle; }
@@ -67,6 +88,10 @@ namespace ERI {
 		TextureMgr*		texture_mgr_;
 		FontMgr*		font_mgr_;
 		ShaderMgr*		shader_mgr_;
+		FramePipeline*	frame_pipeline_;
+		StreamBuffer*	stream_buffer_;
+		GeometryPool*	geometry_pool_;
+		RendererCapture*	frame_capture_;
 
 		void*			window_handle_;
 		
@@ -11,12 +11,17 @@
 
 #include "scene_actor.h"
 
+#include <cmath>
+
 #include "root.h"
 #include "render_data.h"
 #include "renderer.h"
 #include "texture_mgr.h"
 #include "scene_mgr.h"
 #include "font_mgr.h"
+#include "transform_system.h"
+#include "frame_pipeline.h"
+#include "stream_buffer.h"
 
 #ifdef ERI_RENDERER_ES2
 #include "shader_mgr.h"
@@ -34,7 +39,14 @@ namespace ERI {
 		is_view_depth_dirty_(true),
 		user_data_(NULL),
 		bounding_sphere_(NULL),
-		bounding_sphere_world_(NULL)
+		bounding_sphere_world_(NULL),
+		spatial_cell_(NULL),
+		spatial_slot_(-1),
+		is_spatial_dirty_(false),
+		sort_slot_(-1),
+		transform_idx_(-1),
+		transform_version_(0),
+		stream_vertex_(NULL)
 	{
 		render_data_.material_ref = &material_data_;
 	}
@@ -64,6 +76,39 @@ namespace ERI {
 		{
 			RemoveFromScene();
 		}
+		
+		if (transform_idx_ >= 0)
+		{
+			Root::Ins().scene_mgr()->transform_system()->Unregister(this);
+		}
+		
+		if (Root::Ins().frame_pipeline())
+		{
+			Root::Ins().frame_pipeline()->ReleaseVertex(this);
+		}
+		
+		if (stream_vertex_)
+		{
+			stream_vertex_->Release(render_data_);
+			delete stream_vertex_;
+		}
+		
+		// buffers belong to pool
+		if (vertex_range_.page || index_range_.page)
+		{
+			GeometryPool* pool = Root::Ins().geometry_pool();
+			
+			if (vertex_range_.page)
+			{
+				pool->Free(vertex_range_);
+				render_data_.vertex_buffer = 0;
+			}
+			if (index_range_.page)
+			{
+				pool->Free(index_range_);
+				render_data_.index_buffer = 0;
+			}
+		}
 	}
 	
 	void SceneActor::AddToScene(int layer_id /*= 0*/)
@@ -104,6 +149,12 @@ namespace ERI {
 		
 		childs_.push_back(actor);
 		actor->parent_ = this;
+		
+		TransformSystem* transform_system = Root::Ins().scene_mgr()->transform_system();
+		if (transform_idx_ < 0) transform_system->Register(this);
+		if (actor->transform_idx_ < 0) transform_system->Register(actor);
+		transform_system->SetOrderDirty();
+		
 		actor->SetWorldTransformDirty(true, true);
 		actor->SetVisible(visible(), true);
 	}
@@ -130,6 +181,9 @@ namespace ERI {
 		
 		actor->parent_ = NULL;
 		actor->SetVisible(true, true);
+		
+		if (transform_idx_ >= 0)
+			Root::Ins().scene_mgr()->transform_system()->SetOrderDirty();
 	}
 	
 	void SceneActor::RemoveAllChilds()
@@ -142,6 +196,9 @@ namespace ERI {
 		}
     
 		childs_.clear();
+		
+		if (transform_idx_ >= 0)
+			Root::Ins().scene_mgr()->transform_system()->SetOrderDirty();
 	}
 
 	void SceneActor::RemoveFromParent()
@@ -191,8 +248,14 @@ namespace ERI {
 		if (!IsInFrustum())
 			return;
 		
+		Draw(renderer);
+	}
+	
+	void SceneActor::Draw(Renderer* renderer)
+	{
 #ifdef ERI_RENDERER_ES2
-		Root::Ins().shader_mgr()->Use(render_data_.program);
+		if (Root::Ins().shader_mgr())
+			Root::Ins().shader_mgr()->Use(render_data_);
 #endif
 		
 		renderer->EnableMaterial(&material_data_);
@@ -201,6 +264,8 @@ namespace ERI {
 
 		GetWorldTransform();
 		
+		if (stream_vertex_) stream_vertex_->Prepare(render_data_);
+		
 		renderer->Render(&render_data_);
 	
 		renderer->RecoverTransform();
@@ -208,6 +273,8 @@ namespace ERI {
 	
 	void SceneActor::SetColor(const Color& color)
 	{
+		if (layer_) layer_->SetActorDirty(this);
+		
 		render_data_.color = color;
 	}
 	
@@ -246,6 +313,12 @@ namespace ERI {
 		render_data_.blend_dst_factor = GL_ZERO;
 	}
 	
+	void SceneActor::BlendPremultiplied()
+	{
+		render_data_.blend_src_factor = GL_ONE;
+		render_data_.blend_dst_factor = GL_ONE_MINUS_SRC_ALPHA;
+	}
+	
 	void SceneActor::Blend(ActorBlendType blend_type)
 	{
 		switch (blend_type)
@@ -316,6 +389,9 @@ namespace ERI {
 	
 	const Matrix4& SceneActor::GetWorldTransform()
 	{
+		if (parent_ && transform_idx_ >= 0)
+			Root::Ins().scene_mgr()->transform_system()->CheckAncestorDirty(this);
+		
 		if (render_data_.need_update_model_matrix)
 			render_data_.UpdateModelMatrix();
 		
@@ -327,7 +403,7 @@ namespace ERI {
 				render_data_.UpdateWorldModelMatrix();
 			
 			if (bounding_sphere_)
-				bounding_sphere_world_->center = render_data_.world_model_matrix * bounding_sphere_->center;
+				UpdateWorldBounding();
 		}
 		
 		return render_data_.world_model_matrix;
@@ -490,6 +566,9 @@ namespace ERI {
 	
 	float SceneActor::GetViewDepth()
 	{
+		if (parent_ && transform_idx_ >= 0)
+			Root::Ins().scene_mgr()->transform_system()->CheckAncestorDirty(this);
+		
 		if (is_view_depth_dirty_)
 		{
 			render_data_.world_view_pos = GetWorldTransform().GetTranslate();
@@ -502,6 +581,15 @@ namespace ERI {
 		return render_data_.world_view_pos.z;
 	}
 	
+	float SceneActor::GetViewDepth(const Matrix4& view_matrix)
+	{
+		GetViewDepth();
+		
+		const Vector3& pos = render_data_.world_view_pos;
+		
+		return view_matrix.Get(2, 0) * pos.x + view_matrix.Get(2, 1) * pos.y + view_matrix.Get(2, 2) * pos.z + view_matrix.Get(2, 3);
+	}
+	
 	const Texture* SceneActor::SetMaterial(const std::string& texture_path,
                                          TextureFilter filter_min /*= FILTER_NEAREST*/,
                                          TextureFilter filter_mag /*= FILTER_NEAREST*/,
@@ -649,6 +737,9 @@ namespace ERI {
 	
 	void SceneActor::CreateSphereBounding(float radius)
 	{
+		// bound before change
+		if (layer_) layer_->SetActorDirty(this);
+		
 		if (!bounding_sphere_)
 			bounding_sphere_ = new Sphere;
 		
@@ -657,7 +748,27 @@ namespace ERI {
 		if (!bounding_sphere_world_)
 			bounding_sphere_world_ = new Sphere;
 		
-		bounding_sphere_world_->radius = bounding_sphere_->radius;
+		UpdateWorldBounding();
+		
+		if (layer_) layer_->SetSpatialDirty(this);
+	}
+	
+	void SceneActor::UpdateWorldBounding()
+	{
+		const Matrix4& world = render_data_.world_model_matrix;
+		
+		float max_scale_sq = 0.0f;
+		for (int col = 0; col < 3; ++col)
+		{
+			float scale_sq = world.m[col * 4] * world.m[col * 4]
+				+ world.m[col * 4 + 1] * world.m[col * 4 + 1]
+				+ world.m[col * 4 + 2] * world.m[col * 4 + 2];
+			
+			if (scale_sq > max_scale_sq) max_scale_sq = scale_sq;
+		}
+		
+		bounding_sphere_world_->center = world * bounding_sphere_->center;
+		bounding_sphere_world_->radius = bounding_sphere_->radius * sqrtf(max_scale_sq);
 	}
 	
 	void SceneActor::SetShaderProgram(ShaderProgram* program)
@@ -678,6 +789,8 @@ namespace ERI {
 				
 		if (current_visible != original_visible)
 		{
+			if (layer_) layer_->SetActorDirty(this);
+			
 			size_t child_num = childs_.size();
 			for (int i = 0; i < child_num; ++i)
 			{
@@ -703,27 +816,87 @@ namespace ERI {
 		return true;
 	}
 	
+	void SceneActor::UpdateDynamicVertex(const void* vertices, int size)
+	{
+		FramePipeline* pipeline = Root::Ins().frame_pipeline();
+		if (pipeline)
+		{
+			pipeline->HandoverVertex(this, vertices, size);
+			return;
+		}
+		
+		if (vertex_range_.page)
+		{
+			Root::Ins().geometry_pool()->Free(vertex_range_);
+			render_data_.vertex_buffer = 0;
+		}
+		
+		if (!stream_vertex_) stream_vertex_ = new StreamVertex;
+		
+		stream_vertex_->Update(render_data_, vertices, size);
+	}
+	
+	void SceneActor::UpdateStaticVertex(const void* vertices, int size)
+	{
+		// may be dynamic before
+		if (stream_vertex_) stream_vertex_->Release(render_data_);
+		if (Root::Ins().frame_pipeline()) Root::Ins().frame_pipeline()->ReleaseVertex(this);
+		
+		GeometryPool* pool = Root::Ins().geometry_pool();
+		
+		// old range is still drawn by frames in flight, so never overwritten
+		pool->Free(vertex_range_);
+		
+		if (size > 0)
+			pool->AllocVertex(render_data_.vertex_format, vertices, size, vertex_range_);
+		
+		render_data_.vertex_buffer = vertex_range_.buffer;
+		render_data_.vertex_offset = vertex_range_.offset;
+	}
+	
+	void SceneActor::UpdateStaticIndex(const void* indices, int size)
+	{
+		GeometryPool* pool = Root::Ins().geometry_pool();
+		
+		pool->Free(index_range_);
+		
+		if (size > 0)
+			pool->AllocIndex(indices, size, index_range_);
+		
+		render_data_.index_buffer = index_range_.buffer;
+		render_data_.index_offset = index_range_.offset;
+	}
+	
 	void SceneActor::SetTransformDirty()
 	{
 		render_data_.need_update_model_matrix = true;
 	}
 	
 	void SceneActor::SetWorldTransformDirty(bool is_depth_dirty, bool is_child_depth_dirty)
+	{
+		MarkWorldTransformDirty(is_depth_dirty);
+		
+		// childs are marked by transform system in one pass, or lazily when accessed
+		if (!childs_.empty())
+			Root::Ins().scene_mgr()->transform_system()->SetChildsDirty(this, is_child_depth_dirty);
+	}
+	
+	void SceneActor::MarkWorldTransformDirty(bool is_depth_dirty)
 	{
 		render_data_.need_update_world_model_matrix = true;
 		render_data_.need_update_inv_world_model_matrix = true;
 		
-		size_t child_num = childs_.size();
-		for (int i = 0; i < child_num; ++i)
-		{
-			childs_[i]->SetWorldTransformDirty(is_child_depth_dirty, is_child_depth_dirty);
-		}
-		
 		if (is_depth_dirty)
 		{
 			is_view_depth_dirty_ = true;
 			if (layer_) layer_->SetSortDirty();
 		}
+		
+		if (layer_)
+		{
+			layer_->SetSpatialDirty(this);
+			layer_->SetActorDirty(this);
+		}
 	}
 	
 	void SceneActor::SetTexture(int idx, const Texture* tex)
@@ -918,6 +1091,11 @@ namespace ERI {
 	}
 	
 	bool CameraActor::IsInFrustum(const Sphere* sphere)
+	{
+		return SphereInFrustum(*sphere, GetFrustum()) > 0.0f;
+	}
+	
+	const Plane* CameraActor::GetFrustum()
 	{
 		if (is_frustum_dirty_)
 		{
@@ -932,7 +1110,23 @@ namespace ERI {
 			is_frustum_dirty_ = false;
 		}
 		
-		return SphereInFrustum(*sphere, frustum_) > 0.0f;
+		return frustum_;
+	}
+	
+	const Matrix4& CameraActor::GetViewMatrix()
+	{
+		if (is_view_modified_)
+			CalculateViewMatrix();
+		
+		return view_matrix_;
+	}
+	
+	const Matrix4& CameraActor::GetProjectionMatrix()
+	{
+		if (is_projection_modified_)
+			CalculateProjectionMatrix();
+		
+		return projection_matrix_;
 	}
 	
 	void CameraActor::CalculateViewMatrix()
@@ -1176,10 +1370,7 @@ namespace ERI {
 	{
 		Root::Ins().renderer()->SetContextAsCurrent();
 
-		if (render_data_.vertex_buffer == 0)
-		{
-			glGenBuffers(1, &render_data_.vertex_buffer);
-		}
+		render_data_.vertex_format = POS_TEX_2;
 		
 		int vertex_num = static_cast<int>(points_.size());
 		int vertex_buffer_size = sizeof(vertex_2_pos_tex) * vertex_num;
@@ -1195,13 +1386,18 @@ namespace ERI {
 			vertices[i].tex_coord[1] = 0.0f;
 		}
 		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size, vertices, is_dynamic_draw_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+		if (is_dynamic_draw_)
+		{
+			UpdateDynamicVertex(vertices, vertex_buffer_size);
+		}
+		else
+		{
+			UpdateStaticVertex(vertices, vertex_buffer_size);
+		}
 		
 		free(vertices);
 		
 		render_data_.vertex_type = GL_LINE_STRIP;
-		render_data_.vertex_format = POS_TEX_2;
 		render_data_.vertex_count = vertex_num;
 	}
 
@@ -1224,15 +1420,10 @@ namespace ERI {
 	
 	void SpriteActor::UpdateVertexBuffer()
 	{
+		if (layer_) layer_->SetActorDirty(this);
+		
 		Root::Ins().renderer()->SetContextAsCurrent();
 
-		if (render_data_.vertex_buffer == 0)
-		{
-			glGenBuffers(1, &render_data_.vertex_buffer);
-		}
-		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		
 		bool need_uv2 = false;
 		for (int i = 0; i < material_data_.used_unit; ++i)
 		{
@@ -1243,6 +1434,11 @@ namespace ERI {
 			}
 		}
 		
+		if (need_uv2)
+			render_data_.vertex_format = POS_TEX2_2;
+		else
+			render_data_.vertex_format = POS_TEX_2;
+		
 		if (is_use_line_)
 		{
 			// 3 - 2
@@ -1270,7 +1466,7 @@ namespace ERI {
 						tex_scroll_[1].x, tex_scroll_[1].y }
 				};
 				
-				glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, is_dynamic_draw_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+				UploadVertices(v, sizeof(v));
 			}
 			else
 			{
@@ -1289,7 +1485,7 @@ namespace ERI {
 						tex_scroll_[0].x, tex_scroll_[0].y }
 				};
 				
-				glBufferData(GL_ARRAY_BUFFER, sizeof(v), v,  is_dynamic_draw_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+				UploadVertices(v, sizeof(v));
 			}
 			
 			render_data_.vertex_type = GL_LINE_LOOP;
@@ -1320,7 +1516,7 @@ namespace ERI {
 						tex_scroll_[1].x + tex_scale_[1].x, tex_scroll_[1].y }
 				};
 				
-				glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, is_dynamic_draw_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+				UploadVertices(v, sizeof(v));
 			}
 			else
 			{
@@ -1338,18 +1534,21 @@ namespace ERI {
 						tex_scroll_[0].x + tex_scale_[0].x, tex_scroll_[0].y }
 				};
 				
-				glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, is_dynamic_draw_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+				UploadVertices(v, sizeof(v));
 			}
 				
 			render_data_.vertex_type = GL_TRIANGLE_STRIP;
 		}
 		
 		render_data_.vertex_count = 4;
-		
-		if (need_uv2)
-			render_data_.vertex_format = POS_TEX2_2;
+	}
+	
+	void SpriteActor::UploadVertices(const void* vertices, int size)
+	{
+		if (is_dynamic_draw_)
+			UpdateDynamicVertex(vertices, size);
 		else
-			render_data_.vertex_format = POS_TEX_2;
+			UpdateStaticVertex(vertices, size);
 	}
 	
 	void SpriteActor::SetSizeOffset(float width, float height, float offset_width /*= 0.0f*/, float offset_height /*= 0.0f*/)
@@ -1463,18 +1662,109 @@ namespace ERI {
 	
 	void SpriteActor::CreateBounding()
 	{
+		// bound before change
+		if (layer_) layer_->SetActorDirty(this);
+		
 		if (!bounding_sphere_)
 			bounding_sphere_ = new Sphere;
 
+		// area border is hit too
 		bounding_sphere_->center = Vector3(offset_);
-		bounding_sphere_->radius = size_.Length() * 0.5f;
+		bounding_sphere_->radius = (size_ * 0.5f + area_border_).Length();
 		
 		if (!bounding_sphere_world_)
 			bounding_sphere_world_ = new Sphere;
 
-		bounding_sphere_world_->radius = bounding_sphere_->radius;
+		UpdateWorldBounding();
+		
+		if (layer_) layer_->SetSpatialDirty(this);
 	}
-	
+
+	bool SpriteActor::IsBatchable()
+	{
+		return (!is_use_line_ &&
+				POS_TEX_2 == render_data_.vertex_format &&
+				!render_data_.is_tex_transform);
+	}
+
+	void SpriteActor::FillBatchVertices(vertex_3_pos_color_tex* out_vertices)
+	{
+		const Matrix4& world = GetWorldTransform();
+
+		// 2 - 3
+		// | \ |
+		// 0 - 1
+
+		Vector3 pos[4] = {
+			Vector3(offset_.x - 0.5f * size_.x, offset_.y - 0.5f * size_.y, 0.0f),
+			Vector3(offset_.x + 0.5f * size_.x, offset_.y - 0.5f * size_.y, 0.0f),
+			Vector3(offset_.x - 0.5f * size_.x, offset_.y + 0.5f * size_.y, 0.0f),
+			Vector3(offset_.x + 0.5f * size_.x, offset_.y + 0.5f * size_.y, 0.0f)
+		};
+
+		float u[2] = { tex_scroll_[0].x, tex_scroll_[0].x + tex_scale_[0].x };
+		float v[2] = { tex_scroll_[0].y + tex_scale_[0].y, tex_scroll_[0].y };
+
+		unsigned char color[4] = {
+			static_cast<unsigned char>(render_data_.color.r * 255.0f),
+			static_cast<unsigned char>(render_data_.color.g * 255.0f),
+			static_cast<unsigned char>(render_data_.color.b * 255.0f),
+			static_cast<unsigned char>(render_data_.color.a * 255.0f)
+		};
+
+		Vector3 world_pos;
+		for (int i = 0; i < 4; ++i)
+		{
+			Matrix4::Multiply(world_pos, world, pos[i]);
+
+			out_vertices[i].position[0] = world_pos.x;
+			out_vertices[i].position[1] = world_pos.y;
+			out_vertices[i].position[2] = world_pos.z;
+			memcpy(out_vertices[i].color, color, sizeof(color));
+			out_vertices[i].tex_coord[0] = u[i % 2];
+			out_vertices[i].tex_coord[1] = v[i / 2];
+		}
+	}
+
+	void SpriteActor::FillBatchInstance(instance_sprite* out_instance)
+	{
+		const Matrix4& world = GetWorldTransform();
+		
+		// unit quad is scaled by size and moved by offset before world transform
+		
+		for (int row = 0; row < 2; ++row)
+		{
+			float m0 = world.Get(row, 0);
+			float m1 = world.Get(row, 1);
+			
+			out_instance->transform[row][0] = m0 * size_.x;
+			out_instance->transform[row][1] = m1 * size_.y;
+			out_instance->transform[row][2] = m0 * offset_.x + m1 * offset_.y + world.Get(row, 3);
+		}
+		
+		out_instance->transform[0][3] = 0.0f;
+		out_instance->transform[1][3] = world.Get(2, 0) * offset_.x + world.Get(2, 1) * offset_.y + world.Get(2, 3);
+		
+		out_instance->tex_rect[0] = tex_scroll_[0].x;
+		out_instance->tex_rect[1] = tex_scroll_[0].y;
+		out_instance->tex_rect[2] = tex_scale_[0].x;
+		out_instance->tex_rect[3] = tex_scale_[0].y;
+		
+		out_instance->color[0] = static_cast<GLubyte>(render_data_.color.r * 255.0f);
+		out_instance->color[1] = static_cast<GLubyte>(render_data_.color.g * 255.0f);
+		out_instance->color[2] = static_cast<GLubyte>(render_data_.color.b * 255.0f);
+		out_instance->color[3] = static_cast<GLubyte>(render_data_.color.a * 255.0f);
+	}
+
+	bool SpriteActor::IsInstanceable()
+	{
+		const Matrix4& world = GetWorldTransform();
+		
+		// instance transform is 2x3 with constant z, quad has to stay in a plane facing z
+		return (world.Get(2, 0) == 0.0f && world.Get(2, 1) == 0.0f &&
+				world.Get(3, 0) == 0.0f && world.Get(3, 1) == 0.0f && world.Get(3, 3) == 1.0f);
+	}
+
 	bool SpriteActor::IsInArea(const Vector3& local_space_pos)
 	{
 		if (local_space_pos.x >= (offset_.x - 0.5f * size_.x - area_border_.x)
@@ -1503,11 +1793,6 @@ namespace ERI {
 	{
 		Root::Ins().renderer()->SetContextAsCurrent();
 
-		if (render_data_.vertex_buffer == 0)
-		{
-			glGenBuffers(1, &render_data_.vertex_buffer);
-		}
-		
 		Vector2 unit_uv_(1.0f, 1.0f);
 		
 		vertex_3_pos_normal_tex v[36] = {
@@ -1565,8 +1850,7 @@ namespace ERI {
 		render_data_.vertex_format = POS_NORMAL_TEX_3;
 		render_data_.vertex_count = 36;
 		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
+		UpdateStaticVertex(v, sizeof(v));
 	}
 
 #pragma mark NumberActor
@@ -1689,11 +1973,6 @@ namespace ERI {
 			vertices_ = static_cast<vertex_2_pos_tex*>(malloc(now_len_max_ * unit_vertex_num * sizeof(vertex_2_pos_tex)));
 		}
 		
-		if (render_data_.vertex_buffer == 0)
-		{
-			glGenBuffers(1, &render_data_.vertex_buffer);
-		}
-		
 		float start_x = (now_len_ - 1) * (size_.x + spacing_) * -0.5f;
 		int start_idx = 0;
 		float scroll_u, scroll_v;
@@ -1742,8 +2021,7 @@ namespace ERI {
 		render_data_.vertex_count = now_len_ * unit_vertex_num;
 		render_data_.vertex_type = GL_TRIANGLES;
 		
-		glBindBuffer(GL_ARRAY_BUFFER, render_data_.vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, render_data_.vertex_count * sizeof(vertex_2_pos_tex), vertices_, GL_DYNAMIC_DRAW);
+		UpdateDynamicVertex(vertices_, render_data_.vertex_count * sizeof(vertex_2_pos_tex));
 	}
 
 }
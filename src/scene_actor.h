@@ -18,12 +18,15 @@
 #include "math_helper.h"
 #include "render_data.h"
 #include "material_data.h"
+#include "geometry_pool.h"
 
 namespace ERI {
 	
 	class Renderer;
 	class SceneMgr;
 	class SceneLayer;
+	class StreamVertex;
+	struct SpatialCell;
 	
 	struct UserData
 	{
@@ -67,6 +70,19 @@ namespace ERI {
 		// render
 				
 		virtual void Render(Renderer* renderer);
+		
+		// render without visible & frustum check
+		void Draw(Renderer* renderer);
+		
+		// batch
+		
+		virtual bool IsBatchable() { return false; }
+		virtual void FillBatchVertices(vertex_3_pos_color_tex* out_vertices) {}
+		virtual void FillBatchInstance(instance_sprite* out_instance) {}
+		virtual bool IsInstanceable() { return false; }
+		
+		// static indexed geometry in geometry pool, see MeshBatch
+		virtual bool IsMultiDrawable() { return false; }
 
 		virtual void SetColor(const Color& color);
 		const Color& GetColor() const;
@@ -76,6 +92,7 @@ namespace ERI {
 		void BlendMultiply();
 		void BlendMultiply2x();
 		void BlendReplace();
+		void BlendPremultiplied(); // color already multiplied by alpha
 		void Blend(ActorBlendType blend_type);
 
 		void AlphaTestGreater(int alpha_value);
@@ -122,6 +139,7 @@ namespace ERI {
 		//
 		
 		float GetViewDepth();
+		float GetViewDepth(const Matrix4& view_matrix); // along view direction of camera, larger is nearer
 		
 		// material
 		// TODO: bad interface, re-design
@@ -180,10 +198,30 @@ namespace ERI {
 		inline const Sphere* bounding_sphere() { return bounding_sphere_; }
 		
 		friend class SceneMgr;
+		friend class SpriteBatch;
+		friend class MeshBatch;
+		friend class RenderQueue;
+		friend class SpatialIndex;
+		friend class SortActorGroup;
+		friend class TransformSystem;
+		friend class FrameSnapshot;
+		friend class DirtyRectRedraw;
 			
 	protected:
 		virtual bool IsInArea(const Vector3& local_space_pos) { return false; }
 		
+		// vertices changing often are written to stream buffer,
+		// or handed over to render thread when pipelined
+		void UpdateDynamicVertex(const void* vertices, int size);
+		
+		// vertices and indices changing rarely are sub-allocated from geometry pool,
+		// vertex format should be set before
+		void UpdateStaticVertex(const void* vertices, int size);
+		void UpdateStaticIndex(const void* indices, int size);
+		
+		// from local bounding and current world transform, radius scaled by its largest axis scale
+		void UpdateWorldBounding();
+		
 		RenderData		render_data_;
 		MaterialData	material_data_;
 
@@ -200,9 +238,22 @@ namespace ERI {
 		Sphere*			bounding_sphere_;
 		Sphere*			bounding_sphere_world_;
 		
+		SpatialCell*	spatial_cell_;
+		int				spatial_slot_;
+		bool			is_spatial_dirty_;
+		
+		int				sort_slot_;
+		
+		int				transform_idx_;
+		unsigned int	transform_version_;
+		
+		StreamVertex*	stream_vertex_;
+		GeometryRange	vertex_range_, index_range_;
+		
 	private:
 		void SetTransformDirty();
 		void SetWorldTransformDirty(bool is_depth_dirty, bool is_child_depth_dirty);
+		void MarkWorldTransformDirty(bool is_depth_dirty);
 		
 		void SetTexture(int idx, const Texture* tex);
 	};
@@ -241,6 +292,10 @@ namespace ERI {
 		void SetViewProjectionNeedUpdate();
 		
 		bool IsInFrustum(const Sphere* sphere);
+		const Plane* GetFrustum();
+		
+		const Matrix4& GetViewMatrix();
+		const Matrix4& GetProjectionMatrix();
 		
 		inline Projection projection() { return projection_; }
 		inline float ortho_zoom() { return ortho_zoom_; }
@@ -366,6 +421,11 @@ namespace ERI {
 
 		void CreateBounding();
 		
+		virtual bool IsBatchable();
+		virtual void FillBatchVertices(vertex_3_pos_color_tex* out_vertices);
+		virtual void FillBatchInstance(instance_sprite* out_instance);
+		virtual bool IsInstanceable();
+		
 		inline const Vector2& size() const { return size_; }
 		inline const Vector2& offset() const { return offset_; }
 		inline const Vector2& tex_scale(int coord_idx = 0) const { ASSERT(coord_idx >= 0 && coord_idx < 2); return tex_scale_[coord_idx]; }
@@ -374,13 +434,20 @@ namespace ERI {
 		inline void set_is_dynamic_draw(bool is_dynamic_draw) { is_dynamic_draw_ = is_dynamic_draw; }
 
 		inline const Vector2& area_border() { return area_border_; }
-		inline void set_area_border(float border) { area_border_.x = area_border_.y = border; }
-		inline void set_area_border(float border_x, float border_y) { area_border_.x = border_x; area_border_.y = border_y; }
+		// bounding covers border too, so it is hit by spatial index query
+		inline void set_area_border(float border) { set_area_border(border, border); }
+		inline void set_area_border(float border_x, float border_y)
+		{
+			area_border_.x = border_x;
+			area_border_.y = border_y;
+			if (bounding_sphere_) CreateBounding();
+		}
 
 	private:
 		virtual bool IsInArea(const Vector3& local_space_pos);
 		
 		void UpdateVertexBuffer();
+		void UploadVertices(const void* vertices, int size);
 
 		Vector2		size_;
 		Vector2		offset_;
@@ -15,10 +15,24 @@
 #include "scene_actor.h"
 #include "renderer.h"
 #include "texture_mgr.h"
+#include "sprite_batch.h"
+#include "mesh_batch.h"
+#include "spatial_index.h"
+#include "transform_system.h"
+#include "worker_pool.h"
+#include "frame_pipeline.h"
+#include "dirty_rect_redraw.h"
+#include "dynamic_resolution.h"
 #include "root.h"
 
 namespace ERI {
 	
+	template<typename T>
+	static bool SortCompareDepth(const T& entry1, const T& entry2)
+	{
+		return entry1.depth < entry2.depth;
+	}
+	
 #pragma mark TextureActorGroup
 	
 	TextureActorGroup::~TextureActorGroup()
@@ -33,6 +47,9 @@ namespace ERI {
 	{
 		is_rendering_ = true;
 		
+		SpriteBatch* batch = is_batch_sprite_ ? Root::Ins().scene_mgr()->sprite_batch() : NULL;
+		MeshBatch* mesh_batch = is_multi_draw_ ? Root::Ins().scene_mgr()->mesh_batch() : NULL;
+		
 		size_t array_num = actor_arrays_.size();
 		for (size_t i = 0; i < array_num; ++i)
 		{
@@ -40,9 +57,55 @@ namespace ERI {
 			{
 				ActorArray& actors = *actor_arrays_[i];
 				size_t actor_num = actors.size();
-				for (size_t j = 0; j < actor_num; ++j)
+				
+				if (is_sort_front_to_back_)
 				{
-					actors[j]->Render(renderer);
+					// within bucket only, buckets still go in their order to keep texture changes few
+					sort_entries_.clear();
+					
+					// default view looks down -z from origin, world z is view depth then
+					CameraActor* cam = Root::Ins().scene_mgr()->current_cam();
+					const Matrix4* view_matrix = cam ? &cam->GetViewMatrix() : NULL;
+					
+					for (size_t j = 0; j < actor_num; ++j)
+					{
+						if (actors[j]->visible() && actors[j]->IsInFrustum())
+						{
+							SortEntry entry;
+							entry.depth = view_matrix ? actors[j]->GetViewDepth(*view_matrix) : actors[j]->GetViewDepth();
+							entry.actor = actors[j];
+							sort_entries_.push_back(entry);
+						}
+					}
+					
+					// back to front ascending, so draw in reverse
+					std::sort(sort_entries_.begin(), sort_entries_.end(), SortCompareDepth<SortEntry>);
+					
+					for (size_t j = sort_entries_.size(); j > 0; --j)
+					{
+						DrawActor(sort_entries_[j - 1].actor, renderer, batch, mesh_batch);
+					}
+					
+					if (batch) batch->Flush(renderer);
+					if (mesh_batch) mesh_batch->Flush(renderer);
+				}
+				else if (batch || mesh_batch)
+				{
+					for (size_t j = 0; j < actor_num; ++j)
+					{
+						if (actors[j]->visible() && actors[j]->IsInFrustum())
+							DrawActor(actors[j], renderer, batch, mesh_batch);
+					}
+					
+					if (batch) batch->Flush(renderer);
+					if (mesh_batch) mesh_batch->Flush(renderer);
+				}
+				else
+				{
+					for (size_t j = 0; j < actor_num; ++j)
+					{
+						actors[j]->Render(renderer);
+					}
 				}
 			}
 		}
@@ -50,6 +113,24 @@ namespace ERI {
 		is_rendering_ = false;
 	}
 	
+	void TextureActorGroup::DrawActor(SceneActor* actor, Renderer* renderer, SpriteBatch* batch, MeshBatch* mesh_batch)
+	{
+		if (mesh_batch && actor->IsMultiDrawable())
+		{
+			if (batch) batch->Flush(renderer);
+			mesh_batch->Add(actor, renderer);
+		}
+		else
+		{
+			if (mesh_batch) mesh_batch->Flush(renderer);
+			
+			if (batch)
+				batch->Add(actor, renderer);
+			else
+				actor->Draw(renderer);
+		}
+	}
+	
 	void TextureActorGroup::AddActor(SceneActor* actor)
 	{
 		ASSERT(actor);
@@ -117,6 +198,23 @@ namespace ERI {
 		return true;
 	}
 	
+	void TextureActorGroup::AddToQueue(RenderQueue* queue, RenderPass pass, bool is_sort_depth)
+	{
+		size_t array_num = actor_arrays_.size();
+		for (size_t i = 0; i < array_num; ++i)
+		{
+			if (actor_arrays_[i] != NULL)
+			{
+				ActorArray& actors = *actor_arrays_[i];
+				size_t actor_num = actors.size();
+				for (size_t j = 0; j < actor_num; ++j)
+				{
+					queue->Add(actors[j], pass, is_sort_depth);
+				}
+			}
+		}
+	}
+	
 	SceneActor* TextureActorGroup::GetHitActor(const Vector3& pos)
 	{
 		SceneActor* actor;
@@ -180,33 +278,13 @@ namespace ERI {
 
 #pragma mark SortActorGroup
 	
-	static bool SortCompareSceneActor(SceneActor* actor1, SceneActor* actor2)
-	{
-		// null actor move to back
-		
-		if (NULL == actor2)
-			return NULL != actor1;
-		
-		if (NULL == actor1)
-			return false;
-		
-		return actor1->GetViewDepth() < actor2->GetViewDepth();
-	}
-	
 	void SortActorGroup::Render(Renderer* renderer)
 	{
 		is_rendering_ = true;
 		
-		if (is_sort_dirty_)
+		if (is_sort_dirty_ || hole_num_ > 0)
 		{
-			std::sort(actors_.begin(), actors_.end(), SortCompareSceneActor);
-			
-			// clean up
-			
-			while (NULL == actors_.back())
-				actors_.pop_back();
-			
-			is_sort_dirty_ = false;
+			Sort();
 		}
 		
 		size_t num = actors_.size();
@@ -224,6 +302,7 @@ namespace ERI {
 		ASSERT(actor);
 		ASSERT(!is_rendering_);
 		
+		actor->sort_slot_ = static_cast<int>(actors_.size());
 		actors_.push_back(actor);
 
 		is_sort_dirty_ = true;
@@ -234,20 +313,95 @@ namespace ERI {
 		ASSERT(actor);
 		ASSERT(!is_rendering_);
 
+		int slot = actor->sort_slot_;
+		
+		ASSERT(slot >= 0 && slot < static_cast<int>(actors_.size()) && actors_[slot] == actor);
+		
+		actors_[slot] = NULL; // clean up when sort
+		actor->sort_slot_ = -1;
+		++hole_num_;
+	}
+	
+	bool SortActorGroup::IsEmpty()
+	{
+		return static_cast<int>(actors_.size()) == hole_num_;
+	}
+
+	void SortActorGroup::AddToQueue(RenderQueue* queue, RenderPass pass, bool is_sort_depth)
+	{
+		// clean up removed actor, order is handled by queue
+		
 		size_t num = actors_.size();
-		for (int i = 0; i < num; ++i)
+		size_t valid_num = 0;
+		for (size_t i = 0; i < num; ++i)
 		{
-			if (actors_[i] == actor)
+			if (actors_[i])
 			{
-				actors_[i] = NULL; // clean up when sort
-				break;
+				actors_[i]->sort_slot_ = static_cast<int>(valid_num);
+				actors_[valid_num++] = actors_[i];
+				
+				queue->Add(actors_[i], pass, is_sort_depth);
 			}
 		}
+		actors_.resize(valid_num);
+		hole_num_ = 0;
+		
+		is_sort_dirty_ = true;
 	}
-	
-	bool SortActorGroup::IsEmpty()
+
+	void SortActorGroup::Sort()
 	{
-		return actors_.empty();
+		// gather depth once and clean up removed actors
+		
+		sort_entries_.clear();
+		
+		size_t num = actors_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			if (actors_[i])
+			{
+				SortEntry entry;
+				entry.depth = actors_[i]->GetViewDepth();
+				entry.actor = actors_[i];
+				sort_entries_.push_back(entry);
+			}
+		}
+		
+		// usually only a few actors moved since last sort, insertion sort handles nearly sorted input well,
+		// fall back to merge sort when too many shifts
+		
+		num = sort_entries_.size();
+		size_t max_shift = num * 8;
+		size_t shift = 0;
+		
+		for (size_t i = 1; i < num && shift <= max_shift; ++i)
+		{
+			SortEntry entry = sort_entries_[i];
+			size_t j = i;
+			while (j > 0 && entry.depth < sort_entries_[j - 1].depth)
+			{
+				sort_entries_[j] = sort_entries_[j - 1];
+				--j;
+			}
+			sort_entries_[j] = entry;
+			
+			shift += i - j;
+		}
+		
+		if (shift > max_shift)
+		{
+			std::stable_sort(sort_entries_.begin(), sort_entries_.end(), SortCompareDepth<SortEntry>);
+		}
+		
+		actors_.resize(num);
+		for (size_t i = 0; i < num; ++i)
+		{
+			actors_[i] = sort_entries_[i].actor;
+			actors_[i]->sort_slot_ = static_cast<int>(i);
+		}
+		
+		hole_num_ = 0;
+		is_sort_dirty_ = false;
 	}
 
 	SceneActor* SortActorGroup::GetHitActor(const Vector3& pos)
@@ -273,9 +427,20 @@ namespace ERI {
 	SceneLayer::SceneLayer(int uid, bool is_sort_alpha, bool is_clear_depth) :
 		id_(uid),
 		cam_(NULL),
+		spatial_index_(NULL),
+		cache_(NULL),
+		cache_sprite_(NULL),
+		cache_cam_(NULL),
 		is_visible_(true),
 		is_sort_alpha_(is_sort_alpha),
-		is_clear_depth_(is_clear_depth)
+		is_clear_depth_(is_clear_depth),
+		is_batch_sprite_(false),
+		is_multi_draw_(false),
+		is_use_render_queue_(false),
+		is_cache_enable_(false),
+		is_cache_dirty_(false),
+		is_rendering_cache_(false),
+		opaque_order_(OPAQUE_ORDER_TEXTURE)
 	{
 		opaque_actors_ = new TextureActorGroup;
 		alpha_test_actors_ = new TextureActorGroup;
@@ -288,6 +453,10 @@ namespace ERI {
 	
 	SceneLayer::~SceneLayer()
 	{
+		ReleaseCache();
+		
+		if (spatial_index_) delete spatial_index_;
+		
 		delete opaque_actors_;
 		delete alpha_test_actors_;
 		delete alpha_blend_actors_;
@@ -295,30 +464,152 @@ namespace ERI {
 	
 	void SceneLayer::Render(Renderer* renderer)
 	{
+		renderer->BeginGpuTimer(GPU_TIMER_LAYER, id_);
+		
 		if (is_clear_depth_)
 			renderer->ClearDepth();
 		
-		// opaque
-		if (!opaque_actors_->IsEmpty())
+		if (cache_ && !is_rendering_cache_)
+		{
+			RenderCache(renderer);
+		}
+		else if (is_use_render_queue_ || spatial_index_ || Root::Ins().scene_mgr()->worker_pool())
 		{
-			renderer->EnableBlend(false);
-			opaque_actors_->Render(renderer);
+			RenderByQueue(renderer);
 		}
+		else
+		{
+			// opaque
+			if (!opaque_actors_->IsEmpty())
+			{
+				renderer->BeginGpuTimer(GPU_TIMER_PASS_OPAQUE);
+				renderer->EnableBlend(false);
+				
+				if (opaque_order_ == OPAQUE_ORDER_DEPTH_PRE_PASS)
+				{
+					renderer->SetDepthPass(DEPTH_PASS_PRE);
+					opaque_actors_->Render(renderer);
+					renderer->SetDepthPass(DEPTH_PASS_SHADE);
+				}
+				
+				renderer->BeginOverdrawCount();
+				opaque_actors_->Render(renderer);
+				renderer->EndOverdrawCount();
 				
-		// alpha test
-		if (!alpha_test_actors_->IsEmpty())
+				if (opaque_order_ == OPAQUE_ORDER_DEPTH_PRE_PASS)
+					renderer->SetDepthPass(DEPTH_PASS_NONE);
+				
+				renderer->EndGpuTimer();
+			}
+			
+			// alpha test
+			if (!alpha_test_actors_->IsEmpty())
+			{
+				renderer->BeginGpuTimer(GPU_TIMER_PASS_ALPHA_TEST);
+				renderer->EnableBlend(true);
+				renderer->EnableAlphaTest(true);
+				alpha_test_actors_->Render(renderer);
+				renderer->EnableAlphaTest(false);
+				renderer->EndGpuTimer();
+			}
+			
+			// alpha blend
+			if (!alpha_blend_actors_->IsEmpty())
+			{
+				renderer->BeginGpuTimer(GPU_TIMER_PASS_ALPHA_BLEND);
+				renderer->EnableBlend(true);
+				alpha_blend_actors_->Render(renderer);
+				renderer->EndGpuTimer();
+			}
+		}
+		
+		renderer->EndGpuTimer();
+	}
+	
+	void SceneLayer::RenderByQueue(Renderer* renderer)
+	{
+		SceneMgr* scene_mgr = Root::Ins().scene_mgr();
+		RenderQueue* queue = scene_mgr->render_queue();
+		
+		if (!FillQueue(queue))
+			return;
+		
+		opaque_actors_->is_rendering_ = true;
+		alpha_test_actors_->is_rendering_ = true;
+		alpha_blend_actors_->is_rendering_ = true;
+		
+		queue->Render(renderer,
+					  is_batch_sprite_ ? scene_mgr->sprite_batch() : NULL,
+					  is_multi_draw_ ? scene_mgr->mesh_batch() : NULL,
+					  opaque_order_ == OPAQUE_ORDER_DEPTH_PRE_PASS);
+		
+		opaque_actors_->is_rendering_ = false;
+		alpha_test_actors_->is_rendering_ = false;
+		alpha_blend_actors_->is_rendering_ = false;
+		
+		queue->Clear();
+	}
+	
+	bool SceneLayer::FillQueue(RenderQueue* queue)
+	{
+		SceneMgr* scene_mgr = Root::Ins().scene_mgr();
+		
+		queue->Clear();
+		
+		if (spatial_index_)
 		{
-			renderer->EnableBlend(true);
-			renderer->EnableAlphaTest(true);
-			alpha_test_actors_->Render(renderer);
-			renderer->EnableAlphaTest(false);
+			AddToQueueBySpatialIndex(queue);
 		}
+		else
+		{
+			opaque_actors_->AddToQueue(queue, PASS_OPAQUE, false);
+			alpha_test_actors_->AddToQueue(queue, PASS_ALPHA_TEST, false);
+			alpha_blend_actors_->AddToQueue(queue, PASS_ALPHA_BLEND, is_sort_alpha_);
+		}
+		
+		// frustum and view matrix are lazily updated, do it before cull on workers
+		CameraActor* cam = cam_ ? cam_ : scene_mgr->default_cam();
+		if (cam) cam->GetFrustum();
+		
+		queue->Cull(cam ? &cam->GetViewMatrix() : NULL, scene_mgr->worker_pool());
+		
+		if (queue->IsEmpty())
+			return false;
 		
-		// alpha blend
-		if (!alpha_blend_actors_->IsEmpty())
+		queue->Sort();
+		
+		return true;
+	}
+	
+	void SceneLayer::AddToQueueBySpatialIndex(RenderQueue* queue)
+	{
+		spatial_index_->Update();
+		
+		CameraActor* cam = cam_ ? cam_ : Root::Ins().scene_mgr()->default_cam();
+		
+		query_actors_.clear();
+		spatial_index_->QueryFrustum(cam ? cam->GetFrustum() : NULL, query_actors_);
+		
+		size_t num = query_actors_.size();
+		for (size_t i = 0; i < num; ++i)
 		{
-			renderer->EnableBlend(true);
-			alpha_blend_actors_->Render(renderer);
+			SceneActor* actor = query_actors_[i];
+			
+			switch (actor->opacity_type())
+			{
+				case OPACITY_OPAQUE:
+					queue->Add(actor, PASS_OPAQUE, false);
+					break;
+				case OPACITY_ALPHA_TEST:
+					queue->Add(actor, PASS_ALPHA_TEST, false);
+					break;
+				case OPACITY_ALPHA_BLEND:
+					queue->Add(actor, PASS_ALPHA_BLEND, is_sort_alpha_);
+					break;
+				default:
+					ASSERT(0);
+					break;
+			}
 		}
 	}
 	
@@ -339,6 +630,11 @@ namespace ERI {
 				ASSERT(0);
 				break;
 		}
+		
+		if (spatial_index_)
+			spatial_index_->Add(actor);
+		
+		SetActorDirty(actor);
 	}
 	
 	void SceneLayer::RemoveActor(SceneActor* actor)
@@ -358,6 +654,14 @@ namespace ERI {
 				ASSERT(0);
 				break;
 		}
+		
+		if (spatial_index_)
+			spatial_index_->Remove(actor);
+		
+		is_cache_dirty_ = true;
+		
+		DirtyRectRedraw* redraw = Root::Ins().scene_mgr()->dirty_rect_redraw();
+		if (redraw) redraw->RemoveActor(actor, this);
 	}
 	
 	void SceneLayer::AdjustActorMaterial(SceneActor* actor, int original_texture_id)
@@ -377,10 +681,15 @@ namespace ERI {
 				ASSERT(0);
 				break;
 		}
+		
+		SetActorDirty(actor);
 	}
 	
 	SceneActor* SceneLayer::GetHitActor(const Vector3& pos)
 	{
+		if (spatial_index_)
+			return GetHitActorBySpatialIndex(pos);
+		
 		SceneActor* actor;
 
 		actor = alpha_blend_actors_->GetHitActor(pos);
@@ -398,6 +707,40 @@ namespace ERI {
 		return NULL;
 	}
 	
+	SceneActor* SceneLayer::GetHitActorBySpatialIndex(const Vector3& pos)
+	{
+		spatial_index_->Update();
+		
+		query_actors_.clear();
+		spatial_index_->QueryPoint(pos, query_actors_);
+		
+		// same priority as group order: alpha blend > alpha test > opaque, then nearer one
+		
+		SceneActor* hit_actor = NULL;
+		int hit_priority = -1;
+		float hit_depth = 0.0f;
+		
+		size_t num = query_actors_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			SceneActor* actor = query_actors_[i]->GetHitActor(pos);
+			if (!actor)
+				continue;
+			
+			int priority = query_actors_[i]->opacity_type();
+			float depth = query_actors_[i]->GetViewDepth();
+			
+			if (priority > hit_priority || (priority == hit_priority && depth > hit_depth))
+			{
+				hit_actor = actor;
+				hit_priority = priority;
+				hit_depth = depth;
+			}
+		}
+		
+		return hit_actor;
+	}
+	
 	void SceneLayer::SetSortAlpha(bool sort_alpha)
 	{
 		if (is_sort_alpha_ == sort_alpha)
@@ -411,9 +754,15 @@ namespace ERI {
 		is_sort_alpha_ = sort_alpha;
 		
 		if (is_sort_alpha_)
+		{
 			alpha_blend_actors_ = new SortActorGroup;
+		}
 		else
+		{
 			alpha_blend_actors_ = new TextureActorGroup;
+			static_cast<TextureActorGroup*>(alpha_blend_actors_)->set_is_batch_sprite(is_batch_sprite_);
+			static_cast<TextureActorGroup*>(alpha_blend_actors_)->set_is_multi_draw(is_multi_draw_);
+		}
 	}
 	
 	void SceneLayer::SetSortDirty()
@@ -423,17 +772,221 @@ namespace ERI {
 			reinterpret_cast<SortActorGroup*>(alpha_blend_actors_)->set_sort_dirty();
 		}
 	}
+	
+	void SceneLayer::SetSpatialIndex(bool enable, float cell_size)
+	{
+		// actors added before would be left out of culling and picking
+		if (!opaque_actors_->IsEmpty() || !alpha_test_actors_->IsEmpty() || !alpha_blend_actors_->IsEmpty())
+		{
+			LOGW("layer %d spatial index not changed, layer is not empty", id_);
+			return;
+		}
+		
+		if (spatial_index_)
+		{
+			delete spatial_index_;
+			spatial_index_ = NULL;
+		}
+		
+		if (enable)
+			spatial_index_ = new SpatialIndex(cell_size);
+	}
+	
+	void SceneLayer::SetSpatialDirty(SceneActor* actor)
+	{
+		if (spatial_index_)
+			spatial_index_->SetDirty(actor);
+	}
+	
+	void SceneLayer::SetActorDirty(SceneActor* actor)
+	{
+		is_cache_dirty_ = true;
+		
+		DirtyRectRedraw* redraw = Root::Ins().scene_mgr()->dirty_rect_redraw();
+		if (redraw) redraw->SetActorDirty(actor, this);
+	}
+	
+	void SceneLayer::SetCache(bool enable)
+	{
+		if (is_cache_enable_ == enable)
+			return;
+		
+		is_cache_enable_ = enable;
+		
+		if (!is_cache_enable_)
+			ReleaseCache();
+	}
+	
+	bool SceneLayer::UpdateCache(Renderer* renderer)
+	{
+		if (!is_cache_enable_)
+			return false;
+		
+		int width = renderer->backing_width();
+		int height = renderer->backing_height();
+		
+		if (cache_ && (cache_->width() != width || cache_->height() != height))
+			ReleaseCache();
+		
+		if (!cache_)
+		{
+			if (!renderer->caps().is_support_non_power_of_2_texture)
+			{
+				LOGW("layer %d cache disabled, screen size texture is not supported", id_);
+				is_cache_enable_ = false;
+				return false;
+			}
+			
+			cache_ = new RenderToTexture(0, 0, width, height);
+			cache_->Init();
+			
+			// frame buffer is bottom up
+			cache_sprite_ = new SpriteActor(static_cast<float>(width), static_cast<float>(height));
+			cache_sprite_->SetMaterial(cache_->texture());
+			cache_sprite_->SetTexScaleScroll(Vector2(1.0f, -1.0f), Vector2(0.0f, 1.0f));
+			cache_sprite_->SetOpacityType(OPACITY_ALPHA_BLEND);
+			
+			// layer was blended into cache with alpha already, don't apply it again
+			cache_sprite_->BlendPremultiplied();
+			cache_sprite_->SetDepthTest(false);
+			cache_sprite_->SetDepthWrite(false);
+			
+			is_cache_dirty_ = true;
+		}
+		
+		CameraActor* cam = cam_ ? cam_ : Root::Ins().scene_mgr()->default_cam();
+		
+		if (cam != cache_cam_)
+		{
+			cache_cam_ = cam;
+			is_cache_dirty_ = true;
+		}
+		
+		if (cam)
+		{
+			const Matrix4& view_matrix = cam->GetViewMatrix();
+			const Matrix4& projection_matrix = cam->GetProjectionMatrix();
+			
+			if (memcmp(view_matrix.m, cache_view_matrix_.m, sizeof(view_matrix.m)) != 0
+				|| memcmp(projection_matrix.m, cache_projection_matrix_.m, sizeof(projection_matrix.m)) != 0)
+			{
+				cache_view_matrix_ = view_matrix;
+				cache_projection_matrix_ = projection_matrix;
+				is_cache_dirty_ = true;
+			}
+		}
+		
+		if (!is_cache_dirty_)
+			return false;
+		
+		// transparent background, so it composites over layers below
+		Color bg_color = renderer->GetBgColor();
+		renderer->SetBgColor(Color(0.0f, 0.0f, 0.0f, 0.0f));
+		
+		// color is blended as usual so it's premultiplied, and alpha accumulates coverage,
+		// blending alpha by src alpha too would leave it squared
+		renderer->EnableBlendSeparateAlpha(true);
+		
+		is_rendering_cache_ = true;
+		cache_->ProcessRender(id_);
+		is_rendering_cache_ = false;
+		
+		renderer->EnableBlendSeparateAlpha(false);
+		
+		renderer->SetBgColor(bg_color);
+		
+		is_cache_dirty_ = false;
+		
+		return true;
+	}
+	
+	void SceneLayer::RenderCache(Renderer* renderer)
+	{
+		// screen size quad in default pixel view
+		Root::Ins().scene_mgr()->ResetCurrentCam();
+		
+		renderer->EnableBlend(true);
+		cache_sprite_->Draw(renderer);
+	}
+	
+	void SceneLayer::ReleaseCache()
+	{
+		if (cache_sprite_)
+		{
+			delete cache_sprite_;
+			cache_sprite_ = NULL;
+		}
+		
+		if (cache_)
+		{
+			delete cache_;
+			cache_ = NULL;
+		}
+		
+		cache_cam_ = NULL;
+		is_cache_dirty_ = false;
+	}
+	
+	void SceneLayer::SetBatchSprite(bool batch_sprite)
+	{
+		is_batch_sprite_ = batch_sprite;
+		
+		static_cast<TextureActorGroup*>(opaque_actors_)->set_is_batch_sprite(is_batch_sprite_);
+		static_cast<TextureActorGroup*>(alpha_test_actors_)->set_is_batch_sprite(is_batch_sprite_);
+		
+		if (!is_sort_alpha_)
+		{
+			static_cast<TextureActorGroup*>(alpha_blend_actors_)->set_is_batch_sprite(is_batch_sprite_);
+		}
+	}
+	
+	void SceneLayer::SetMultiDraw(bool multi_draw)
+	{
+		is_multi_draw_ = multi_draw;
+		
+		static_cast<TextureActorGroup*>(opaque_actors_)->set_is_multi_draw(is_multi_draw_);
+		static_cast<TextureActorGroup*>(alpha_test_actors_)->set_is_multi_draw(is_multi_draw_);
+		
+		if (!is_sort_alpha_)
+		{
+			static_cast<TextureActorGroup*>(alpha_blend_actors_)->set_is_multi_draw(is_multi_draw_);
+		}
+	}
+	
+	void SceneLayer::SetOpaqueOrder(OpaqueOrder order)
+	{
+		opaque_order_ = order;
+		
+		// render queue sorts opaque actors front to back already
+		static_cast<TextureActorGroup*>(opaque_actors_)->set_is_sort_front_to_back(opaque_order_ != OPAQUE_ORDER_TEXTURE);
+	}
 
 #pragma mark SceneMgr
 
 	SceneMgr::SceneMgr() : current_cam_(NULL), default_cam_(NULL)
 	{
+		sprite_batch_ = new SpriteBatch;
+		mesh_batch_ = new MeshBatch;
+		render_queue_ = new RenderQueue;
+		transform_system_ = new TransformSystem;
+		worker_pool_ = NULL;
+		dirty_rect_redraw_ = NULL;
+		dynamic_resolution_ = NULL;
+		
 		CreateLayer(1); // default layer
 	}
 	
 	SceneMgr::~SceneMgr()
 	{
 		ClearLayer();
+		
+		delete sprite_batch_;
+		delete mesh_batch_;
+		delete render_queue_;
+		delete transform_system_;
+		if (worker_pool_) delete worker_pool_;
+		if (dirty_rect_redraw_) delete dirty_rect_redraw_;
+		if (dynamic_resolution_) delete dynamic_resolution_;
 	}
 	
 	void SceneMgr::CreateLayer(int num)
@@ -452,6 +1005,9 @@ namespace ERI {
 	{
 		ASSERT(layer_id < static_cast<int>(layers_.size()));
 
+		if (dirty_rect_redraw_ && layers_[layer_id]->is_visible() != visible)
+			dirty_rect_redraw_->SetFullDirty();
+		
 		layers_[layer_id]->set_is_visible(visible);
 	}
 	
@@ -469,6 +1025,121 @@ namespace ERI {
 		layers_[layer_id]->SetSortAlpha(sort_alpha);
 	}
 	
+	void SceneMgr::SetLayerBatchSprite(int layer_id, bool batch_sprite)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		layers_[layer_id]->SetBatchSprite(batch_sprite);
+	}
+	
+	void SceneMgr::SetLayerMultiDraw(int layer_id, bool multi_draw)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		layers_[layer_id]->SetMultiDraw(multi_draw);
+	}
+	
+	void SceneMgr::SetLayerOpaqueOrder(int layer_id, OpaqueOrder order)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		layers_[layer_id]->SetOpaqueOrder(order);
+	}
+	
+	void SceneMgr::SetLayerRenderQueue(int layer_id, bool use_render_queue)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		layers_[layer_id]->set_is_use_render_queue(use_render_queue);
+	}
+	
+	void SceneMgr::SetLayerSpatialIndex(int layer_id, bool enable, float cell_size /*= 256.0f*/)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		layers_[layer_id]->SetSpatialIndex(enable, cell_size);
+	}
+	
+	void SceneMgr::SetLayerCache(int layer_id, bool enable)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		layers_[layer_id]->SetCache(enable);
+	}
+	
+	void SceneMgr::SetLayerCacheDirty(int layer_id)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		layers_[layer_id]->SetCacheDirty();
+	}
+	
+	void SceneMgr::ReleaseLayerCache()
+	{
+		size_t layer_num = layers_.size();
+		for (int i = 0; i < layer_num; ++i)
+		{
+			layers_[i]->SetCache(false);
+		}
+		
+		// holds offscreen texture too
+		SetDirtyRectRedraw(false);
+		
+		if (dynamic_resolution_)
+			dynamic_resolution_->ReleaseBuffer();
+	}
+	
+	void SceneMgr::SetDirtyRectRedraw(bool enable)
+	{
+		if (enable == (dirty_rect_redraw_ != NULL))
+			return;
+		
+		if (enable)
+		{
+			dirty_rect_redraw_ = new DirtyRectRedraw;
+		}
+		else
+		{
+			delete dirty_rect_redraw_;
+			dirty_rect_redraw_ = NULL;
+		}
+	}
+	
+	void SceneMgr::SetDynamicResolution(int scaled_layer_num, float target_frame_ms /*= 16.7f*/)
+	{
+		if (scaled_layer_num <= 0)
+		{
+			if (dynamic_resolution_)
+			{
+				delete dynamic_resolution_;
+				dynamic_resolution_ = NULL;
+			}
+			return;
+		}
+		
+		if (dynamic_resolution_)
+		{
+			dynamic_resolution_->set_scaled_layer_num(scaled_layer_num);
+			dynamic_resolution_->set_target_frame_ms(target_frame_ms);
+		}
+		else
+		{
+			dynamic_resolution_ = new DynamicResolution(scaled_layer_num, target_frame_ms);
+		}
+	}
+	
+	void SceneMgr::SetWorkerNum(int worker_num)
+	{
+		if (worker_pool_)
+		{
+			delete worker_pool_;
+			worker_pool_ = NULL;
+		}
+		
+		if (worker_num > 0)
+			worker_pool_ = new WorkerPool(worker_num);
+	}
+	
 	void SceneMgr::SetLayerCam(int layer_id, CameraActor* cam)
 	{
 		ASSERT(layer_id < static_cast<int>(layers_.size()));
@@ -512,25 +1183,59 @@ namespace ERI {
 	
 	void SceneMgr::Render(Renderer* renderer)
 	{
-		size_t layer_num = layers_.size();
-		for (int i = 0; i < layer_num; ++i)
+		transform_system_->Update();
+		
+		// dirty caches are rendered before anything else,
+		// render target is cleared again after them in case it was used to render them
+		if (UpdateLayerCache(renderer))
+			renderer->RenderStart();
+		
+		RenderLayers(0, static_cast<int>(layers_.size()), renderer);
+	}
+	
+	void SceneMgr::RenderLayers(int begin_layer_id, int end_layer_id, Renderer* renderer)
+	{
+		ASSERT(begin_layer_id >= 0 && end_layer_id <= static_cast<int>(layers_.size()));
+		
+		for (int i = begin_layer_id; i < end_layer_id; ++i)
 		{
 			if (layers_[i]->is_visible())
-			{
-				SetCurrentCam(layers_[i]->cam() ? layers_[i]->cam() : default_cam_);
-				
-				if (current_cam_)
-				{
-					if (current_cam_->is_projection_need_update())
-						current_cam_->UpdateProjectionMatrix();
-					
-					if (current_cam_->is_view_need_update())
-						current_cam_->UpdateViewMatrix();
-				}
-				
-				layers_[i]->Render(renderer);
-			}
+				RenderLayer(i, renderer);
+		}
+	}
+	
+	bool SceneMgr::UpdateLayerCache(Renderer* renderer)
+	{
+		bool is_updated = false;
+		
+		int layer_num = static_cast<int>(layers_.size());
+		for (int i = 0; i < layer_num; ++i)
+		{
+			if (layers_[i]->is_visible() && layers_[i]->UpdateCache(renderer))
+				is_updated = true;
+		}
+		
+		return is_updated;
+	}
+	
+	void SceneMgr::RenderLayer(int layer_id, Renderer* renderer)
+	{
+		ASSERT(layer_id < static_cast<int>(layers_.size()));
+		
+		SceneLayer* layer = layers_[layer_id];
+		
+		SetCurrentCam(layer->cam() ? layer->cam() : default_cam_);
+		
+		if (current_cam_)
+		{
+			if (current_cam_->is_projection_need_update())
+				current_cam_->UpdateProjectionMatrix();
+			
+			if (current_cam_->is_view_need_update())
+				current_cam_->UpdateViewMatrix();
 		}
+		
+		layer->Render(renderer);
 	}
 
 	Vector3 SceneMgr::ScreenToWorldPos(int screen_x, int screen_y, CameraActor* cam /*= NULL*/)
@@ -601,6 +1306,8 @@ namespace ERI {
 	{
 		// TODO: 3D handle?
 		
+		transform_system_->Update();
+		
 		SceneActor* actor;
 		for (int i = static_cast<int>(layers_.size()) - 1; i >= 0; --i)
 		{
@@ -643,6 +1350,33 @@ namespace ERI {
 		}
 	}
 	
+	void SceneMgr::BuildSnapshot(FrameSnapshot* snapshot)
+	{
+		transform_system_->Update();
+		
+		size_t layer_num = layers_.size();
+		for (int i = 0; i < layer_num; ++i)
+		{
+			if (layers_[i]->is_visible())
+			{
+				snapshot->AddLayer(layers_[i]->cam() ? layers_[i]->cam() : default_cam_, layers_[i]->is_clear_depth());
+				
+				if (layers_[i]->FillQueue(render_queue_))
+					snapshot->AddPackets(render_queue_);
+				
+				render_queue_->Clear();
+			}
+		}
+	}
+	
+	void SceneMgr::ResetCurrentCam()
+	{
+		current_cam_ = NULL;
+		
+		UpdateDefaultProjection();
+		UpdateDefaultView();
+	}
+	
 	void SceneMgr::SetCurrentCam(CameraActor* cam)
 	{
 		if (current_cam_ == cam)
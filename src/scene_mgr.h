@@ -15,12 +15,23 @@
 
 #include "observer.h"
 #include "math_helper.h"
+#include "render_queue.h"
 
 namespace ERI {
 	
 	class SceneActor;
+	class SpriteActor;
 	class CameraActor;
 	class Renderer;
+	class RenderToTexture;
+	class SpriteBatch;
+	class MeshBatch;
+	class SpatialIndex;
+	class TransformSystem;
+	class WorkerPool;
+	class FrameSnapshot;
+	class DirtyRectRedraw;
+	class DynamicResolution;
 	
 	typedef std::vector<SceneActor*> ActorArray;
 
@@ -35,6 +46,9 @@ namespace ERI {
 		virtual void RemoveActor(SceneActor* actor) = 0;
 		virtual void AdjustActorMaterial(SceneActor* actor, int original_texture_id) {}
 		virtual bool IsEmpty() = 0;
+		
+		// add visible actors to render queue
+		virtual void AddToQueue(RenderQueue* queue, RenderPass pass, bool is_sort_depth) = 0;
 
 		// TODO: should remove this fuction
 		virtual SceneActor* GetHitActor(const Vector3& pos) = 0;
@@ -45,6 +59,7 @@ namespace ERI {
 	class TextureActorGroup : public ActorGroup
 	{
 	public:
+		TextureActorGroup() : is_batch_sprite_(false), is_multi_draw_(false), is_sort_front_to_back_(false) {}
 		~TextureActorGroup();
 		
 		void Render(Renderer* renderer);
@@ -52,26 +67,45 @@ namespace ERI {
 		void RemoveActor(SceneActor* actor);
 		void AdjustActorMaterial(SceneActor* actor, int original_texture_id);
 		bool IsEmpty();
+		void AddToQueue(RenderQueue* queue, RenderPass pass, bool is_sort_depth);
 		
 		// TODO: should remove this fuction
 		SceneActor* GetHitActor(const Vector3& pos);
 		
+		inline void set_is_batch_sprite(bool batch_sprite) { is_batch_sprite_ = batch_sprite; }
+		inline void set_is_multi_draw(bool multi_draw) { is_multi_draw_ = multi_draw; }
+		inline void set_is_sort_front_to_back(bool sort_front_to_back) { is_sort_front_to_back_ = sort_front_to_back; }
+		
 	private:
+		struct SortEntry
+		{
+			float		depth;
+			SceneActor*	actor;
+		};
+		
 		void RemoveActorByTextureId(SceneActor* actor, int texture_id);
+		void DrawActor(SceneActor* actor, Renderer* renderer, SpriteBatch* batch, MeshBatch* mesh_batch);
 		
 		std::vector<ActorArray*>	actor_arrays_;
 		std::map<int, int>			texture_map_;
+		
+		std::vector<SortEntry>		sort_entries_; // visible actors of a texture bucket
+		
+		bool	is_batch_sprite_;
+		bool	is_multi_draw_;
+		bool	is_sort_front_to_back_;
 	};
 	
 	class SortActorGroup : public ActorGroup
 	{
 	public:
-		SortActorGroup() : is_sort_dirty_(true) {}
+		SortActorGroup() : hole_num_(0), is_sort_dirty_(true) {}
 		
 		void Render(Renderer* renderer);
 		void AddActor(SceneActor* actor);
 		void RemoveActor(SceneActor* actor);
 		bool IsEmpty();
+		void AddToQueue(RenderQueue* queue, RenderPass pass, bool is_sort_depth);
 		
 		// TODO: should remove this fuction
 		SceneActor* GetHitActor(const Vector3& pos);
@@ -79,10 +113,27 @@ namespace ERI {
 		inline void set_sort_dirty() { is_sort_dirty_ = true; }
 		
 	private:
-		ActorArray	actors_;
-		bool		is_sort_dirty_;
+		struct SortEntry
+		{
+			float		depth;
+			SceneActor*	actor;
+		};
+		
+		void Sort();
+		
+		ActorArray				actors_;
+		std::vector<SortEntry>	sort_entries_;
+		int						hole_num_;
+		bool					is_sort_dirty_;
 	};
 
+	enum OpaqueOrder
+	{
+		OPAQUE_ORDER_TEXTURE,			// texture buckets in the order they are created
+		OPAQUE_ORDER_FRONT_TO_BACK,		// and front to back inside each bucket
+		OPAQUE_ORDER_DEPTH_PRE_PASS		// and a depth only pass first, for expensive fragment shaders
+	};
+	
 	class SceneLayer
 	{
 	public:
@@ -90,6 +141,10 @@ namespace ERI {
 		~SceneLayer();
 
 		void Render(Renderer* renderer);
+		
+		// gather, cull and sort, false if nothing to render
+		bool FillQueue(RenderQueue* queue);
+		
 		void AddActor(SceneActor* actor);
 		void RemoveActor(SceneActor* actor);
 		void AdjustActorMaterial(SceneActor* actor, int original_texture_id);
@@ -99,6 +154,26 @@ namespace ERI {
 		
 		void SetSortAlpha(bool sort_alpha);
 		void SetSortDirty();
+		void SetBatchSprite(bool batch_sprite);
+		void SetMultiDraw(bool multi_draw);
+		void SetOpaqueOrder(OpaqueOrder order);
+		
+		// only while layer is empty, otherwise ignored with a warning
+		void SetSpatialIndex(bool enable, float cell_size);
+		void SetSpatialDirty(SceneActor* actor);
+		
+		// render into offscreen texture once and composite it as a quad until something in layer changes,
+		// offscreen target has no depth buffer so it suits 2D layers like background or HUD,
+		// only used by direct render, pipelined mode draws the layer without it,
+		// translucent content needs separate alpha blend to composite right, which ES1 renderer lacks
+		void SetCache(bool enable);
+		inline void SetCacheDirty() { is_cache_dirty_ = true; }
+		
+		// actor is about to change how it looks
+		void SetActorDirty(SceneActor* actor);
+		
+		// re-render cache if it is dirty, true if rendered
+		bool UpdateCache(Renderer* renderer);
 		
 		inline int id() { return id_; }
 		
@@ -107,9 +182,17 @@ namespace ERI {
 
 		inline bool is_visible() { return is_visible_; }
 		inline void set_is_visible(bool visible) { is_visible_ = visible; }
+		inline bool is_clear_depth() { return is_clear_depth_; }
 		inline void set_is_clear_depth(bool claear_depth) { is_clear_depth_ = claear_depth; }
+		inline void set_is_use_render_queue(bool use_render_queue) { is_use_render_queue_ = use_render_queue; }
 		
 	private:
+		void RenderByQueue(Renderer* renderer);
+		void AddToQueueBySpatialIndex(RenderQueue* queue);
+		SceneActor* GetHitActorBySpatialIndex(const Vector3& pos);
+		void RenderCache(Renderer* renderer);
+		void ReleaseCache();
+		
 		int		id_;
 		
 		ActorGroup*	opaque_actors_;
@@ -118,9 +201,26 @@ namespace ERI {
 		
 		CameraActor*	cam_;
 		
+		SpatialIndex*	spatial_index_;
+		ActorArray		query_actors_;
+		
+		RenderToTexture*	cache_;
+		SpriteActor*		cache_sprite_;
+		CameraActor*		cache_cam_;
+		Matrix4				cache_view_matrix_;
+		Matrix4				cache_projection_matrix_;
+		
 		bool	is_visible_;
 		bool	is_sort_alpha_;
 		bool	is_clear_depth_;
+		bool	is_batch_sprite_;
+		bool	is_multi_draw_;
+		bool	is_use_render_queue_;
+		bool	is_cache_enable_;
+		bool	is_cache_dirty_;
+		bool	is_rendering_cache_;
+		
+		OpaqueOrder	opaque_order_;
 	};
 
 	class SceneMgr
@@ -140,14 +240,45 @@ namespace ERI {
 		void SetLayerVisible(int layer_id, bool visible);
 		void SetLayerClearDepth(int layer_id, bool clear_depth);
 		void SetLayerSortAlpha(int layer_id, bool sort_alpha);
+		void SetLayerBatchSprite(int layer_id, bool batch_sprite);
+		void SetLayerMultiDraw(int layer_id, bool multi_draw);
+		void SetLayerOpaqueOrder(int layer_id, OpaqueOrder order);
+		void SetLayerRenderQueue(int layer_id, bool use_render_queue);
+		void SetLayerSpatialIndex(int layer_id, bool enable, float cell_size = 256.0f);
+		void SetLayerCache(int layer_id, bool enable);
+		void SetLayerCacheDirty(int layer_id);
+		void ReleaseLayerCache();
 		void SetLayerCam(int layer_id, CameraActor* cam);
 		CameraActor* GetLayerCam(int layer_id);
 		void ClearLayer();
+		
+		inline int GetLayerNum() { return static_cast<int>(layers_.size()); }
+		
+		// cull, world transform and sort key of all layers are done on worker threads and calling thread,
+		// layers go through render queue then, 0 to disable
+		void SetWorkerNum(int worker_num);
+		
+		// keep scene offscreen and redraw changed area only, see DirtyRectRedraw
+		void SetDirtyRectRedraw(bool enable);
+		
+		// layers below scaled layer num render at a resolution adapting to target frame time, see DynamicResolution,
+		// 0 to disable, not used while dirty rect redraw is on nor in pipelined mode
+		void SetDynamicResolution(int scaled_layer_num, float target_frame_ms = 16.7f);
 
 		void AddActor(SceneActor* actor, int layer_id = 0);
 		void RemoveActor(SceneActor* actor, int layer_id);
 		
 		void Render(Renderer* renderer);
+		void RenderLayer(int layer_id, Renderer* renderer);
+		
+		// visible layers from begin to before end
+		void RenderLayers(int begin_layer_id, int end_layer_id, Renderer* renderer);
+		
+		// re-render dirty layer caches, true if any rendered
+		bool UpdateLayerCache(Renderer* renderer);
+		
+		// pipelined mode, copy what all layers draw, layer caches are not used
+		void BuildSnapshot(FrameSnapshot* snapshot);
 
 		Vector3 ScreenToWorldPos(int screen_x, int screen_y, CameraActor* cam = NULL);
 		Vector2 WorldToScreenPos(const Vector3& world_pos, CameraActor* cam = NULL);
@@ -157,6 +288,7 @@ namespace ERI {
 		void OnViewportResize(bool need_notify = true);
 		
 		void SetCurrentCam(CameraActor* cam);
+		void ResetCurrentCam();
 	
 		inline CameraActor* current_cam() { return current_cam_; }
 		
@@ -165,6 +297,14 @@ namespace ERI {
 		
 		inline Subject<ResizeInfo>& viewport_resize_subject() { return viewport_resize_subject_; }
 		
+		inline SpriteBatch* sprite_batch() { return sprite_batch_; }
+		inline MeshBatch* mesh_batch() { return mesh_batch_; }
+		inline RenderQueue* render_queue() { return render_queue_; }
+		inline TransformSystem* transform_system() { return transform_system_; }
+		inline WorkerPool* worker_pool() { return worker_pool_; }
+		inline DirtyRectRedraw* dirty_rect_redraw() { return dirty_rect_redraw_; }
+		inline DynamicResolution* dynamic_resolution() { return dynamic_resolution_; }
+		
 	private:
 		void UpdateDefaultView();
 		void UpdateDefaultProjection();
@@ -173,6 +313,14 @@ namespace ERI {
 		CameraActor*				current_cam_;
 		CameraActor*				default_cam_;
 		
+		SpriteBatch*				sprite_batch_;
+		MeshBatch*					mesh_batch_;
+		RenderQueue*				render_queue_;
+		TransformSystem*			transform_system_;
+		WorkerPool*					worker_pool_;
+		DirtyRectRedraw*			dirty_rect_redraw_;
+		DynamicResolution*			dynamic_resolution_;
+		
 		Subject<ResizeInfo>	viewport_resize_subject_;
 	};
 
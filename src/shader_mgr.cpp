@@ -11,9 +11,15 @@
 #ifdef ERI_RENDERER_ES2
 
 #include "renderer_es2.h"
+#include "root.h"
+#include "render_data.h"
+#include "material_data.h"
+#include "math_helper.h"
 #include "sys_helper.h"
 #include "platform_helper.h"
 
+#include <fstream>
+
 namespace ERI
 {
 
@@ -99,9 +105,134 @@ static bool ValidateProgram(GLuint program)
 
 //==============================================================================
 
+// program binary cache, one file per program under write path,
+// key is hash of sources with defines and driver strings,
+// binary from other driver version is rejected by key or by failed link
+
+struct ProgramCacheHeader
+{
+	unsigned int		magic;
+	unsigned int		version;
+	unsigned long long	key;
+	unsigned int		format;
+	int					length;
+};
+
+static const unsigned int kProgramCacheMagic = 0x50495245; // "ERIP"
+static const unsigned int kProgramCacheVersion = 1;
+
+static unsigned long long HashString(const std::string& str, unsigned long long hash)
+{
+	// FNV-1a, terminating null is hashed to separate strings
+	size_t length = str.length() + 1;
+	const char* data = str.c_str();
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+	
+	return hash;
+}
+
+static unsigned long long GetProgramCacheKey(const std::string& vertex_code, const std::string& fragment_code)
+{
+	static std::string driver;
+	if (driver.empty())
+	{
+		driver = std::string((const char*)glGetString(GL_VENDOR)) + " " +
+			(const char*)glGetString(GL_RENDERER) + " " +
+			(const char*)glGetString(GL_VERSION);
+	}
+	
+	unsigned long long hash = 14695981039346656037ULL;
+	hash = HashString(vertex_code, hash);
+	hash = HashString(fragment_code, hash);
+	hash = HashString(driver, hash);
+	
+	return hash;
+}
+
+static std::string GetProgramCachePath(unsigned long long key)
+{
+	char name[64];
+	sprintf(name, "/shader_%08x%08x.bin", static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key));
+	
+	return GetWritePath() + name;
+}
+
+static bool LoadProgramCache(RendererES2* renderer, GLuint program, const std::string& path, unsigned long long key)
+{
+	std::ifstream ifs(path.c_str(), std::ios::in | std::ios::binary);
+	
+	if (ifs.fail())
+		return false;
+	
+	ProgramCacheHeader header;
+	ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+	
+	if (ifs.fail() ||
+		header.magic != kProgramCacheMagic ||
+		header.version != kProgramCacheVersion ||
+		header.key != key ||
+		header.length <= 0)
+	{
+		LOGW("Program cache mismatch: %s", path.c_str());
+		return false;
+	}
+	
+	std::vector<char> binary(header.length);
+	ifs.read(&binary[0], header.length);
+	
+	if (ifs.fail())
+	{
+		LOGW("Program cache truncated: %s", path.c_str());
+		return false;
+	}
+	
+	if (!renderer->LoadProgramBinary(program, header.format, &binary[0], header.length))
+	{
+		LOGW("Program cache rejected by driver: %s", path.c_str());
+		return false;
+	}
+	
+	return true;
+}
+
+static void SaveProgramCache(RendererES2* renderer, GLuint program, const std::string& path, unsigned long long key)
+{
+	ProgramCacheHeader header;
+	std::vector<unsigned char> binary;
+	
+	if (!renderer->GetProgramBinary(program, header.format, binary))
+	{
+		LOGW("Failed to get program binary: %d", program);
+		return;
+	}
+	
+	header.magic = kProgramCacheMagic;
+	header.version = kProgramCacheVersion;
+	header.key = key;
+	header.length = static_cast<int>(binary.size());
+	
+	std::ofstream ofs(path.c_str(), std::ios::out | std::ios::binary);
+	
+	if (ofs.fail())
+	{
+		LOGW("Failed to save program cache: %s", path.c_str());
+		return;
+	}
+	
+	ofs.write(reinterpret_cast<char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<char*>(&binary[0]), binary.size());
+}
+
+//==============================================================================
+
 ShaderProgram::ShaderProgram() : program_(0)
 {
 	uniforms_.resize(UNIFORM_MAX);
+	shadows_.resize(UNIFORM_MAX);
 }
 
 ShaderProgram::~ShaderProgram()
@@ -110,42 +241,75 @@ ShaderProgram::~ShaderProgram()
 }
 
 bool ShaderProgram::Construct(const std::string& vertex_shader_path,
-							 const std::string& fragment_shader_path)
+							 const std::string& fragment_shader_path,
+							 const std::string& defines /*= ""*/)
 {
 	// LOGI("shader program construct vs: %s, fs: %s", vertex_shader_path.c_str(), fragment_shader_path.c_str());
-
-	GLuint vertex_shader;
 	
-	std::string shader_code;
-	if (!GetFileContentString(std::string(GetResourcePath()) + "/" + vertex_shader_path, shader_code))
+	double start_time = GetTimeStamp();
+	
+	std::string vertex_code, fragment_code;
+	
+	if (!GetFileContentString(std::string(GetResourcePath()) + "/" + vertex_shader_path, vertex_code))
 	{
 		LOGW("Failed to load vertex shader: %s", vertex_shader_path.c_str());
 		return false;
 	}
 	
-	if (!CompileShader(&vertex_shader, GL_VERTEX_SHADER, shader_code.c_str()))
+	if (!GetFileContentString(std::string(GetResourcePath()) + "/" + fragment_shader_path, fragment_code))
 	{
-		LOGW("Failed to compile vertex shader: %s", vertex_shader_path.c_str());
+		LOGW("Failed to load fragment shader: %s", fragment_shader_path.c_str());
 		return false;
 	}
 	
-	GLuint fragment_shader;
+	vertex_code = defines + vertex_code;
+	fragment_code = defines + fragment_code;
+	
+	ASSERT(program_ == 0);
+	
+	RendererES2* renderer = Root::Ins().shader_mgr()->renderer();
 	
-	if (!GetFileContentString(std::string(GetResourcePath()) + "/" + fragment_shader_path, shader_code))
+	unsigned long long cache_key = 0;
+	std::string cache_path;
+	
+	if (renderer->is_support_program_binary())
 	{
-		LOGW("Failed to load fragment shader: %s", fragment_shader_path.c_str());
+		cache_key = GetProgramCacheKey(vertex_code, fragment_code);
+		cache_path = GetProgramCachePath(cache_key);
+		
+		program_ = glCreateProgram();
+		
+		if (LoadProgramCache(renderer, program_, cache_path, cache_key))
+		{
+			GetUniformLocations();
+			
+			LOGI("shader program %s %s loaded from cache in %.2f ms",
+				 vertex_shader_path.c_str(), fragment_shader_path.c_str(), (GetTimeStamp() - start_time) * 1000.0);
+			
+			return true;
+		}
+		
+		glDeleteProgram(program_);
+		program_ = 0;
+	}
+	
+	GLuint vertex_shader;
+	
+	if (!CompileShader(&vertex_shader, GL_VERTEX_SHADER, vertex_code.c_str()))
+	{
+		LOGW("Failed to compile vertex shader: %s", vertex_shader_path.c_str());
 		return false;
 	}
 	
-	if (!CompileShader(&fragment_shader, GL_FRAGMENT_SHADER, shader_code.c_str()))
+	GLuint fragment_shader;
+	
+	if (!CompileShader(&fragment_shader, GL_FRAGMENT_SHADER, fragment_code.c_str()))
 	{
 		LOGW("Failed to compile fragment shader: %s", fragment_shader_path.c_str());
 		glDeleteShader(vertex_shader);
 		return false;
 	}
 	
-	ASSERT(program_ == 0);
-	
 	// create shader program
 	program_ = glCreateProgram();
 
@@ -162,6 +326,10 @@ bool ShaderProgram::Construct(const std::string& vertex_shader_path,
 	glBindAttribLocation(program_, ATTRIB_COLOR, "a_color");
 	glBindAttribLocation(program_, ATTRIB_TEXCOORD0, "a_texcoord0");
 	glBindAttribLocation(program_, ATTRIB_TEXCOORD1, "a_texcoord1");
+	glBindAttribLocation(program_, ATTRIB_INSTANCE_TRANSFORM0, "a_instance_transform0");
+	glBindAttribLocation(program_, ATTRIB_INSTANCE_TRANSFORM1, "a_instance_transform1");
+	glBindAttribLocation(program_, ATTRIB_INSTANCE_TEX_RECT, "a_instance_tex_rect");
+	glBindAttribLocation(program_, ATTRIB_DRAW_IDX, "a_draw_idx");
 	
 	// link program
 	if (!LinkProgram(program_))
@@ -174,21 +342,7 @@ bool ShaderProgram::Construct(const std::string& vertex_shader_path,
 		return false;
 	}
 	
-	// get uniform locations
-	uniforms_[UNIFORM_MODEL_VIEW_PROJ_MATRIX] = glGetUniformLocation(program_, "model_view_proj_matrix");
-	uniforms_[UNIFORM_MODEL_VIEW_MATRIX] = glGetUniformLocation(program_, "model_view_matrix");
-	uniforms_[UNIFORM_TEX_USE_COORD_INDEX] = glGetUniformLocation(program_, "tex_use_coord_idx");
-	uniforms_[UNIFORM_TEX0] = glGetUniformLocation(program_, "tex[0]");
-	uniforms_[UNIFORM_TEX1] = glGetUniformLocation(program_, "tex[1]");
-	uniforms_[UNIFORM_TEX_MATRIX_ENABLE] = glGetUniformLocation(program_, "tex_matrix_enable");
-	uniforms_[UNIFORM_TEX_MATRIX0] = glGetUniformLocation(program_, "tex_matrix[0]");
-	uniforms_[UNIFORM_TEX_MATRIX1] = glGetUniformLocation(program_, "tex_matrix[1]");
-	uniforms_[UNIFORM_FOG_ENABLE] = glGetUniformLocation(program_, "fog_enable");
-	uniforms_[UNIFORM_FOG_MODE] = glGetUniformLocation(program_, "fog_mode");
-	uniforms_[UNIFORM_FOG_START] = glGetUniformLocation(program_, "fog_start");
-	uniforms_[UNIFORM_FOG_END] = glGetUniformLocation(program_, "fog_end");
-	uniforms_[UNIFORM_FOG_DENSITY] = glGetUniformLocation(program_, "fog_density");
-	uniforms_[UNIFORM_FOG_COLOR] = glGetUniformLocation(program_, "fog_color");
+	GetUniformLocations();
 	
 	// release vertex and fragment shaders
 	if (vertex_shader)
@@ -202,19 +356,144 @@ bool ShaderProgram::Construct(const std::string& vertex_shader_path,
 	// glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTES, &n);
 	// LOGI("GL_ACTIVE_ATTRIBUTES: %d", n);
 	
+	if (!cache_path.empty())
+		SaveProgramCache(renderer, program_, cache_path, cache_key);
+	
+	LOGI("shader program %s %s compiled in %.2f ms",
+		 vertex_shader_path.c_str(), fragment_shader_path.c_str(), (GetTimeStamp() - start_time) * 1000.0);
+	
 	return true;
 }
+
+void ShaderProgram::GetUniformLocations()
+{
+	uniforms_[UNIFORM_MODEL_VIEW_PROJ_MATRIX] = glGetUniformLocation(program_, "model_view_proj_matrix");
+	uniforms_[UNIFORM_MODEL_VIEW_MATRIX] = glGetUniformLocation(program_, "model_view_matrix");
+	uniforms_[UNIFORM_TEX_USE_COORD_INDEX] = glGetUniformLocation(program_, "tex_use_coord_idx");
+	uniforms_[UNIFORM_TEX0] = glGetUniformLocation(program_, "tex[0]");
+	uniforms_[UNIFORM_TEX1] = glGetUniformLocation(program_, "tex[1]");
+	uniforms_[UNIFORM_TEX_MATRIX_ENABLE] = glGetUniformLocation(program_, "tex_matrix_enable");
+	uniforms_[UNIFORM_TEX_MATRIX0] = glGetUniformLocation(program_, "tex_matrix[0]");
+	uniforms_[UNIFORM_TEX_MATRIX1] = glGetUniformLocation(program_, "tex_matrix[1]");
+	uniforms_[UNIFORM_FOG_ENABLE] = glGetUniformLocation(program_, "fog_enable");
+	uniforms_[UNIFORM_FOG_MODE] = glGetUniformLocation(program_, "fog_mode");
+	uniforms_[UNIFORM_FOG_START] = glGetUniformLocation(program_, "fog_start");
+	uniforms_[UNIFORM_FOG_END] = glGetUniformLocation(program_, "fog_end");
+	uniforms_[UNIFORM_FOG_DENSITY] = glGetUniformLocation(program_, "fog_density");
+	uniforms_[UNIFORM_FOG_COLOR] = glGetUniformLocation(program_, "fog_color");
+	uniforms_[UNIFORM_COLOR] = glGetUniformLocation(program_, "color");
+	uniforms_[UNIFORM_ALPHA_TEST_REF] = glGetUniformLocation(program_, "alpha_test_ref");
+	uniforms_[UNIFORM_MODEL_VIEW_PROJ_MATRICES] = glGetUniformLocation(program_, "model_view_proj_matrices[0]");
+}
   
 void ShaderProgram::SetCustomUniform(const std::string& name, float value)
 {
-	int loc = glGetUniformLocation(program_, name.c_str());
-	glUniform1f(loc, value);
+	SetUniform1f(GetCustomUniformSlot(name), value);
 }
   
 void ShaderProgram::SetCustomUniform(const std::string& name, const Vector2& value)
 {
-	int loc = glGetUniformLocation(program_, name.c_str());
-	glUniform2f(loc, value.x, value.y);
+	SetUniform2f(GetCustomUniformSlot(name), value.x, value.y);
+}
+
+int ShaderProgram::GetCustomUniformSlot(const std::string& name)
+{
+	std::map<std::string, int>::iterator it = custom_slots_.find(name);
+	if (it != custom_slots_.end())
+		return it->second;
+	
+	int slot = static_cast<int>(uniforms_.size());
+	
+	uniforms_.push_back(glGetUniformLocation(program_, name.c_str()));
+	shadows_.push_back(UniformShadow());
+	custom_slots_[name] = slot;
+	
+	return slot;
+}
+
+void ShaderProgram::SetUniform1i(int slot, int value)
+{
+	if (IsUniformChanged(slot, &value, sizeof(value)))
+		glUniform1i(uniforms_[slot], value);
+}
+
+void ShaderProgram::SetUniform1iv(int slot, int count, const int* values)
+{
+	if (IsUniformChanged(slot, values, count * sizeof(int)))
+		glUniform1iv(uniforms_[slot], count, values);
+}
+
+void ShaderProgram::SetUniform1f(int slot, float value)
+{
+	if (IsUniformChanged(slot, &value, sizeof(value)))
+		glUniform1f(uniforms_[slot], value);
+}
+
+void ShaderProgram::SetUniform2f(int slot, float x, float y)
+{
+	float values[2] = { x, y };
+	if (IsUniformChanged(slot, values, sizeof(values)))
+		glUniform2f(uniforms_[slot], x, y);
+}
+
+void ShaderProgram::SetUniform4f(int slot, float x, float y, float z, float w)
+{
+	float values[4] = { x, y, z, w };
+	if (IsUniformChanged(slot, values, sizeof(values)))
+		glUniform4f(uniforms_[slot], x, y, z, w);
+}
+
+void ShaderProgram::SetUniformMatrix4fv(int slot, const float* values)
+{
+	if (IsUniformChanged(slot, values, 16 * sizeof(float)))
+		glUniformMatrix4fv(uniforms_[slot], 1, GL_FALSE, values);
+}
+
+void ShaderProgram::SetUniformMatrix4fv(int slot, int count, const float* values)
+{
+	ASSERT(slot >= 0 && slot < static_cast<int>(shadows_.size()));
+	
+	RenderStats& stats = Root::Ins().renderer()->current_stats();
+	
+	if (uniforms_[slot] < 0)
+	{
+		++stats.uniform_skipped;
+		return;
+	}
+	
+	shadows_[slot].size = 0;
+	
+	++stats.uniform_issued;
+	glUniformMatrix4fv(uniforms_[slot], count, GL_FALSE, values);
+}
+
+bool ShaderProgram::IsUniformChanged(int slot, const void* data, int size)
+{
+	ASSERT(slot >= 0 && slot < static_cast<int>(shadows_.size()));
+	ASSERT(static_cast<size_t>(size) <= sizeof(shadows_[slot].data));
+	
+	RenderStats& stats = Root::Ins().renderer()->current_stats();
+	
+	// not used by this program
+	if (uniforms_[slot] < 0)
+	{
+		++stats.uniform_skipped;
+		return false;
+	}
+	
+	UniformShadow& shadow = shadows_[slot];
+	
+	if (shadow.size == size && memcmp(shadow.data, data, size) == 0)
+	{
+		++stats.uniform_skipped;
+		return false;
+	}
+	
+	memcpy(shadow.data, data, size);
+	shadow.size = size;
+	
+	++stats.uniform_issued;
+	return true;
 }
 
 bool ShaderProgram::Validate()
@@ -230,7 +509,7 @@ bool ShaderProgram::Validate()
 
 //==============================================================================
 
-ShaderMgr::ShaderMgr() : default_program_(NULL), current_program_(NULL)
+ShaderMgr::ShaderMgr(RendererES2* renderer) : renderer_(renderer), default_program_(NULL), current_program_(NULL), instanced_sprite_program_(NULL)
 {
 }
 
@@ -239,6 +518,13 @@ ShaderMgr::~ShaderMgr()
 	std::map<std::string, ShaderProgram*>::iterator it = program_map_.begin();
 	for (; it != program_map_.end(); ++it)
 		delete it->second;
+	
+	std::map<unsigned int, ShaderProgram*>::iterator variant_it = variant_map_.begin();
+	for (; variant_it != variant_map_.end(); ++variant_it)
+	{
+		if (variant_it->second)
+			delete variant_it->second;
+	}
 }
 
 ShaderProgram* ShaderMgr::Create(const std::string& name,
@@ -284,6 +570,185 @@ void ShaderMgr::Use(ShaderProgram* program)
 	ASSERT(current_program_);
 }
 
+void ShaderMgr::Use(const RenderData& data)
+{
+	if (data.program || variant_vertex_shader_path_.empty())
+	{
+		Use(data.program);
+		return;
+	}
+	
+	Use(GetVariant(data));
+}
+
+bool ShaderMgr::UseMultiDraw(const RenderData& data)
+{
+	if (data.program || variant_vertex_shader_path_.empty())
+		return false;
+	
+	ShaderProgram* program = GetVariant(data, true);
+	if (NULL == program)
+		return false;
+	
+	Use(program);
+	
+	return true;
+}
+
+void ShaderMgr::SetVariantTemplate(const std::string& vertex_shader_path,
+								   const std::string& fragment_shader_path)
+{
+	ASSERT(variant_map_.empty());
+	
+	variant_vertex_shader_path_ = vertex_shader_path;
+	variant_fragment_shader_path_ = fragment_shader_path;
+}
+
+enum VariantKey
+{
+	VARIANT_TEX0_COORD_SHIFT = 0, // 2 bits, coord index + 1
+	VARIANT_TEX1_COORD_SHIFT = 2, // 2 bits, coord index + 1
+	VARIANT_TEX_MATRIX = 1 << 4,
+	VARIANT_FOG_MODE_SHIFT = 5, // 2 bits, fog mode + 1
+	VARIANT_VERTEX_COLOR = 1 << 7,
+	VARIANT_ALPHA_TEST = 1 << 8,
+	VARIANT_MULTI_DRAW = 1 << 9,
+	VARIANT_ALPHA_TEST_FUNC_SHIFT = 10 // 3 bits, func - GL_NEVER
+};
+
+// fragment fails alpha test, opposite of alpha test func indexed from GL_NEVER
+static const char* kAlphaTestFails[] =
+{
+	"true",
+	"(a >= alpha_test_ref)",
+	"(a != alpha_test_ref)",
+	"(a > alpha_test_ref)",
+	"(a <= alpha_test_ref)",
+	"(a == alpha_test_ref)",
+	"(a < alpha_test_ref)",
+	"false"
+};
+
+unsigned int ShaderMgr::GetProgramKey(const RenderData& data) const
+{
+	if (data.program || variant_vertex_shader_path_.empty())
+	{
+		const ShaderProgram* program = data.program ? data.program : default_program_;
+		return program ? program->program() : 0;
+	}
+	
+	// variant may not be compiled yet, its key stands for it
+	return 0x80000000 | GetVariantKey(data, false);
+}
+
+unsigned int ShaderMgr::GetVariantKey(const RenderData& data, bool is_multi_draw) const
+{
+	ASSERT(data.material_ref);
+	
+	const MaterialData* material = data.material_ref;
+	
+	unsigned int key = 0;
+	
+	for (int i = 0; i < 2 && i < material->used_unit; ++i)
+	{
+		int coord_idx = material->texture_units[i].coord_idx;
+		ASSERT(coord_idx >= 0 && coord_idx < 2);
+		
+		key |= (coord_idx + 1) << (i == 0 ? VARIANT_TEX0_COORD_SHIFT : VARIANT_TEX1_COORD_SHIFT);
+	}
+	
+	if (key != 0 && data.is_tex_transform)
+		key |= VARIANT_TEX_MATRIX;
+	
+	if (material->accept_fog)
+	{
+		FogMode fog_mode = renderer_->fog_mode();
+		key |= (fog_mode + 1) << VARIANT_FOG_MODE_SHIFT;
+	}
+	
+	if (IsVertexColorFormat(data.vertex_format))
+		key |= VARIANT_VERTEX_COLOR;
+	
+	if (material->opacity_type == OPACITY_ALPHA_TEST)
+	{
+		ASSERT(data.alpha_test_func >= GL_NEVER && data.alpha_test_func <= GL_ALWAYS);
+		
+		key |= VARIANT_ALPHA_TEST;
+		key |= (data.alpha_test_func - GL_NEVER) << VARIANT_ALPHA_TEST_FUNC_SHIFT;
+	}
+	
+	if (is_multi_draw)
+		key |= VARIANT_MULTI_DRAW;
+	
+	return key;
+}
+
+ShaderProgram* ShaderMgr::GetVariant(const RenderData& data, bool is_multi_draw /*= false*/)
+{
+	ASSERT(!variant_vertex_shader_path_.empty());
+	
+	unsigned int key = GetVariantKey(data, is_multi_draw);
+	
+	std::map<unsigned int, ShaderProgram*>::iterator it = variant_map_.find(key);
+	if (it != variant_map_.end())
+		return it->second;
+	
+	std::string defines;
+	char line[64];
+	
+	int tex0_coord = (key >> VARIANT_TEX0_COORD_SHIFT) & 3;
+	int tex1_coord = (key >> VARIANT_TEX1_COORD_SHIFT) & 3;
+	int fog_mode = (key >> VARIANT_FOG_MODE_SHIFT) & 3;
+	
+	if (tex0_coord)
+	{
+		sprintf(line, "#define TEX0_COORD_IDX %d\n", tex0_coord - 1);
+		defines += line;
+	}
+	if (tex1_coord)
+	{
+		sprintf(line, "#define TEX1_COORD_IDX %d\n", tex1_coord - 1);
+		defines += line;
+	}
+	if (key & VARIANT_TEX_MATRIX) defines += "#define TEX_MATRIX\n";
+	if (fog_mode)
+	{
+		sprintf(line, "#define FOG_MODE %d\n", fog_mode);
+		defines += line;
+	}
+	if (key & VARIANT_VERTEX_COLOR) defines += "#define VERTEX_COLOR\n";
+	if (key & VARIANT_ALPHA_TEST)
+	{
+		defines += "#define ALPHA_TEST\n";
+		
+		sprintf(line, "#define ALPHA_TEST_FAIL(a) %s\n", kAlphaTestFails[(key >> VARIANT_ALPHA_TEST_FUNC_SHIFT) & 7]);
+		defines += line;
+	}
+	if (key & VARIANT_MULTI_DRAW)
+	{
+		sprintf(line, "#define MULTI_DRAW %d\n", Renderer::kMaxMultiDraw);
+		defines += line;
+		
+		// one call for all draws, shader reads draw index from gl_DrawIDARB
+		if (renderer_->caps().is_support_multi_draw) defines += "#define MULTI_DRAW_ID\n";
+	}
+	
+	ShaderProgram* program = new ShaderProgram;
+	
+	if (!program->Construct(variant_vertex_shader_path_, variant_fragment_shader_path_, defines))
+	{
+		LOGW("Failed to construct shader variant 0x%x, use default program", key);
+		
+		// don't retry every draw
+		delete program;
+		program = NULL;
+	}
+	
+	variant_map_[key] = program;
+	
+	return program;
+}
+
 }
 
 #endif // ERI_RENDERER_ES2
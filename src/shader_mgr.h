@@ -18,6 +18,8 @@
 namespace ERI
 {
 	struct Vector2;
+	struct RenderData;
+	class RendererES2;
 
 enum UNIFORM_INDEX
 {
@@ -35,6 +37,9 @@ enum UNIFORM_INDEX
 	UNIFORM_FOG_END,
 	UNIFORM_FOG_DENSITY,
 	UNIFORM_FOG_COLOR,
+	UNIFORM_COLOR,
+	UNIFORM_ALPHA_TEST_REF,
+	UNIFORM_MODEL_VIEW_PROJ_MATRICES,
 	UNIFORM_MAX
 };
 
@@ -45,7 +50,11 @@ enum ATTRIB_INDEX
 	ATTRIB_COLOR,
 	ATTRIB_TEXCOORD0,
 	ATTRIB_TEXCOORD1,
-	ATTRIB_MAX
+	ATTRIB_INSTANCE_TRANSFORM0,
+	ATTRIB_INSTANCE_TRANSFORM1,
+	ATTRIB_INSTANCE_TEX_RECT,
+	ATTRIB_DRAW_IDX = ATTRIB_INSTANCE_TEX_RECT, // multi draw variants have no instance attributes
+	ATTRIB_MAX // es2 guarantees 8 only
 };
 
 class ShaderProgram
@@ -54,26 +63,57 @@ public:
 	ShaderProgram();
 	~ShaderProgram();
 	
+	// defines are "#define ..." lines put before both shader sources
 	bool Construct(const std::string& vertex_shader_path,
-				   const std::string& fragment_shader_path);
+				   const std::string& fragment_shader_path,
+				   const std::string& defines = "");
   
 	void SetCustomUniform(const std::string& name, float value);
 	void SetCustomUniform(const std::string& name, const Vector2& value);
 	
+	// slot for SetUniform*, location is queried once per name
+	int GetCustomUniformSlot(const std::string& name);
+	
+	// upload through shadow copy of program uniform values, glUniform* is skipped
+	// if value is same as last uploaded one, slot is UNIFORM_INDEX or custom slot
+	void SetUniform1i(int slot, int value);
+	void SetUniform1iv(int slot, int count, const int* values);
+	void SetUniform1f(int slot, float value);
+	void SetUniform2f(int slot, float x, float y);
+	void SetUniform4f(int slot, float x, float y, float z, float w);
+	void SetUniformMatrix4fv(int slot, const float* values);
+	
+	// matrix array, larger than shadow so always uploaded
+	void SetUniformMatrix4fv(int slot, int count, const float* values);
+	
 	bool Validate();
 	
 	inline unsigned int program() const { return program_; }
 	inline const std::vector<int>& uniforms() const { return uniforms_; }
 	
 private:
+	struct UniformShadow
+	{
+		UniformShadow() : size(0) {}
+		
+		int size;
+		unsigned char data[64];
+	};
+	
+	void GetUniformLocations();
+	
+	bool IsUniformChanged(int slot, const void* data, int size);
+	
 	unsigned int program_;
 	std::vector<int> uniforms_;
+	std::vector<UniformShadow> shadows_;
+	std::map<std::string, int> custom_slots_;
 };
 
 class ShaderMgr
 {
 public:
-	ShaderMgr();
+	ShaderMgr(RendererES2* renderer);
 	~ShaderMgr();
 	
 	ShaderProgram* Create(const std::string& name,
@@ -83,16 +123,53 @@ public:
 	ShaderProgram* Get(const std::string& name);
 	void Use(ShaderProgram* program);
 	
+	// use program of render data, or if it has none, the variant matching it
+	// when variant template is set, default program otherwise
+	void Use(const RenderData& data);
+	
+	// use multi draw variant matching data, see Renderer::RenderMulti,
+	// false if data has its own program or variant is not available
+	bool UseMultiDraw(const RenderData& data);
+	
+	// variants of template are compiled with defines on first use and cached,
+	// see demo/shaders/template.vsh for defines
+	void SetVariantTemplate(const std::string& vertex_shader_path,
+							const std::string& fragment_shader_path);
+	
+	ShaderProgram* GetVariant(const RenderData& data, bool is_multi_draw = false);
+	
+	// stands for program which Use(data) binds, without compiling it or touching gl,
+	// program name or variant key so only good for sorting and grouping
+	unsigned int GetProgramKey(const RenderData& data) const;
+	
+	inline int variant_num() const { return static_cast<int>(variant_map_.size()); }
+	
 	inline ShaderProgram* default_program() { return default_program_; }
 	inline void set_default_program(ShaderProgram* program) { default_program_ = program; }
 	
 	inline ShaderProgram* current_program() { return current_program_; }
 	
+	// program for instanced sprites, which are drawn without instancing if it's not set
+	inline ShaderProgram* instanced_sprite_program() { return instanced_sprite_program_; }
+	inline void set_instanced_sprite_program(ShaderProgram* program) { instanced_sprite_program_ = program; }
+	
+	// held directly, root renderer may be a wrapper of it
+	inline RendererES2* renderer() { return renderer_; }
+	
 private:
+	unsigned int GetVariantKey(const RenderData& data, bool is_multi_draw) const;
+	
+	RendererES2* renderer_;
+	
 	std::map<std::string, ShaderProgram*> program_map_;
 	
+	std::string variant_vertex_shader_path_;
+	std::string variant_fragment_shader_path_;
+	std::map<unsigned int, ShaderProgram*> variant_map_;
+	
 	ShaderProgram* default_program_;
 	ShaderProgram* current_program_;
+	ShaderProgram* instanced_sprite_program_;
 };
 
 }
@@ -0,0 +1,293 @@
+//
+//  spatial_index.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "spatial_index.h"
+
+#include <cmath>
+
+#include "scene_actor.h"
+
+namespace ERI
+{
+	static bool IsAABoxOutsideFrustum(const Vector3& min, const Vector3& max, const Plane* frustum)
+	{
+		Vector3 positive;
+
+		for (int p = 0; p < 6; ++p)
+		{
+			const Vector3& normal = frustum[p].normal;
+
+			positive.x = normal.x >= 0.0f ? max.x : min.x;
+			positive.y = normal.y >= 0.0f ? max.y : min.y;
+			positive.z = normal.z >= 0.0f ? max.z : min.z;
+
+			if (normal.DotProduct(positive) + frustum[p].d < 0.0f)
+				return true;
+		}
+
+		return false;
+	}
+
+	SpatialIndex::SpatialIndex(float cell_size) :
+		cell_size_(cell_size),
+		max_radius_(0.0f)
+	{
+		ASSERT(cell_size_ > 0.0f);
+	}
+
+	SpatialIndex::~SpatialIndex()
+	{
+		for (CellMap::iterator it = cells_.begin(); it != cells_.end(); ++it)
+		{
+			size_t num = it->second->actors.size();
+			for (size_t i = 0; i < num; ++i)
+			{
+				it->second->actors[i]->spatial_cell_ = NULL;
+			}
+
+			delete it->second;
+		}
+
+		size_t num = unbounded_cell_.actors.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			unbounded_cell_.actors[i]->spatial_cell_ = NULL;
+		}
+
+		num = dirty_actors_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			dirty_actors_[i]->is_spatial_dirty_ = false;
+		}
+	}
+
+	void SpatialIndex::Add(SceneActor* actor)
+	{
+		ASSERT(actor);
+		ASSERT(!actor->spatial_cell_);
+
+		AddToCell(actor, &unbounded_cell_);
+		SetDirty(actor);
+	}
+
+	void SpatialIndex::Remove(SceneActor* actor)
+	{
+		ASSERT(actor);
+		ASSERT(actor->spatial_cell_);
+
+		if (actor->is_spatial_dirty_)
+		{
+			size_t num = dirty_actors_.size();
+			for (size_t i = 0; i < num; ++i)
+			{
+				if (dirty_actors_[i] == actor)
+				{
+					dirty_actors_[i] = dirty_actors_[num - 1];
+					dirty_actors_.pop_back();
+					break;
+				}
+			}
+
+			actor->is_spatial_dirty_ = false;
+		}
+
+		RemoveFromCell(actor);
+	}
+
+	void SpatialIndex::SetDirty(SceneActor* actor)
+	{
+		if (!actor->is_spatial_dirty_)
+		{
+			actor->is_spatial_dirty_ = true;
+			dirty_actors_.push_back(actor);
+		}
+	}
+
+	void SpatialIndex::Update()
+	{
+		size_t num = dirty_actors_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			SceneActor* actor = dirty_actors_[i];
+			actor->is_spatial_dirty_ = false;
+
+			if (NULL == actor->bounding_sphere_world_)
+			{
+				if (actor->spatial_cell_ != &unbounded_cell_)
+				{
+					RemoveFromCell(actor);
+					AddToCell(actor, &unbounded_cell_);
+				}
+				continue;
+			}
+
+			actor->GetWorldTransform();
+
+			const Sphere& sphere = *actor->bounding_sphere_world_;
+
+			SpatialCell* cell = GetCell(GetCellCoord(sphere.center));
+			if (actor->spatial_cell_ != cell)
+			{
+				RemoveFromCell(actor);
+				AddToCell(actor, cell);
+			}
+
+			if (cell->actors.size() == 1)
+			{
+				cell->max_radius = sphere.radius;
+				cell->min_z = sphere.center.z - sphere.radius;
+				cell->max_z = sphere.center.z + sphere.radius;
+			}
+			else
+			{
+				cell->max_radius = Max(cell->max_radius, sphere.radius);
+				cell->min_z = Min(cell->min_z, sphere.center.z - sphere.radius);
+				cell->max_z = Max(cell->max_z, sphere.center.z + sphere.radius);
+			}
+
+			max_radius_ = Max(max_radius_, sphere.radius);
+		}
+
+		dirty_actors_.clear();
+	}
+
+	void SpatialIndex::QueryFrustum(const Plane* frustum, std::vector<SceneActor*>& out_actors)
+	{
+		size_t num = unbounded_cell_.actors.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			SceneActor* actor = unbounded_cell_.actors[i];
+
+			// bounding created after add, move to grid next update
+			if (actor->bounding_sphere_world_)
+				SetDirty(actor);
+
+			out_actors.push_back(actor);
+		}
+
+		Vector3 min, max;
+
+		for (CellMap::iterator it = cells_.begin(); it != cells_.end(); ++it)
+		{
+			SpatialCell* cell = it->second;
+
+			if (cell->actors.empty())
+				continue;
+
+			if (frustum)
+			{
+				min.x = it->first.first * cell_size_ - cell->max_radius;
+				min.y = it->first.second * cell_size_ - cell->max_radius;
+				min.z = cell->min_z;
+				max.x = (it->first.first + 1) * cell_size_ + cell->max_radius;
+				max.y = (it->first.second + 1) * cell_size_ + cell->max_radius;
+				max.z = cell->max_z;
+
+				if (IsAABoxOutsideFrustum(min, max, frustum))
+					continue;
+			}
+
+			out_actors.insert(out_actors.end(), cell->actors.begin(), cell->actors.end());
+		}
+	}
+
+	void SpatialIndex::QueryPoint(const Vector3& world_pos, std::vector<SceneActor*>& out_actors)
+	{
+		out_actors.insert(out_actors.end(), unbounded_cell_.actors.begin(), unbounded_cell_.actors.end());
+
+		CellCoord center = GetCellCoord(world_pos);
+		int range = static_cast<int>(ceilf(max_radius_ / cell_size_));
+
+		std::vector<SpatialCell*> check_cells;
+
+		if ((2 * range + 1) * (2 * range + 1) > static_cast<int>(cells_.size()))
+		{
+			for (CellMap::iterator it = cells_.begin(); it != cells_.end(); ++it)
+			{
+				check_cells.push_back(it->second);
+			}
+		}
+		else
+		{
+			for (int x = center.first - range; x <= center.first + range; ++x)
+			{
+				for (int y = center.second - range; y <= center.second + range; ++y)
+				{
+					CellMap::iterator it = cells_.find(CellCoord(x, y));
+					if (it != cells_.end())
+						check_cells.push_back(it->second);
+				}
+			}
+		}
+
+		size_t cell_num = check_cells.size();
+		for (size_t i = 0; i < cell_num; ++i)
+		{
+			std::vector<SceneActor*>& actors = check_cells[i]->actors;
+			size_t num = actors.size();
+			for (size_t j = 0; j < num; ++j)
+			{
+				const Sphere& sphere = *actors[j]->bounding_sphere_world_;
+				float dx = sphere.center.x - world_pos.x;
+				float dy = sphere.center.y - world_pos.y;
+
+				if (dx * dx + dy * dy <= sphere.radius * sphere.radius)
+					out_actors.push_back(actors[j]);
+			}
+		}
+	}
+
+	void SpatialIndex::AddToCell(SceneActor* actor, SpatialCell* cell)
+	{
+		actor->spatial_cell_ = cell;
+		actor->spatial_slot_ = static_cast<int>(cell->actors.size());
+		cell->actors.push_back(actor);
+	}
+
+	void SpatialIndex::RemoveFromCell(SceneActor* actor)
+	{
+		SpatialCell* cell = actor->spatial_cell_;
+		ASSERT(cell);
+
+		int slot = actor->spatial_slot_;
+		ASSERT(cell->actors[slot] == actor);
+
+		SceneActor* last = cell->actors.back();
+		cell->actors[slot] = last;
+		last->spatial_slot_ = slot;
+		cell->actors.pop_back();
+
+		actor->spatial_cell_ = NULL;
+		actor->spatial_slot_ = -1;
+
+		if (cell->actors.empty())
+		{
+			cell->max_radius = 0.0f;
+			cell->min_z = cell->max_z = 0.0f;
+		}
+	}
+
+	SpatialCell* SpatialIndex::GetCell(const CellCoord& coord)
+	{
+		CellMap::iterator it = cells_.find(coord);
+		if (it != cells_.end())
+			return it->second;
+
+		SpatialCell* cell = new SpatialCell;
+		cells_.insert(std::make_pair(coord, cell));
+		return cell;
+	}
+
+	SpatialIndex::CellCoord SpatialIndex::GetCellCoord(const Vector3& pos)
+	{
+		return CellCoord(static_cast<int>(floorf(pos.x / cell_size_)),
+						 static_cast<int>(floorf(pos.y / cell_size_)));
+	}
+}
@@ -0,0 +1,76 @@
+//
+//  spatial_index.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_SPATIAL_INDEX_H
+#define ERI_SPATIAL_INDEX_H
+
+#include <vector>
+#include <map>
+
+#include "math_helper.h"
+
+namespace ERI
+{
+	class SceneActor;
+
+	struct SpatialCell
+	{
+		SpatialCell() : max_radius(0.0f), min_z(0.0f), max_z(0.0f) {}
+
+		std::vector<SceneActor*>	actors;
+
+		// loose bound of actors in this cell
+		float	max_radius;
+		float	min_z, max_z;
+	};
+
+	// Loose grid on world xy plane.
+	// Each actor lives in the cell which contains its bounding sphere center,
+	// cells are expanded by the largest radius they hold when queried.
+	// Actors without bounding sphere are kept in unbounded cell and always returned.
+
+	class SpatialIndex
+	{
+	public:
+		SpatialIndex(float cell_size);
+		~SpatialIndex();
+
+		void Add(SceneActor* actor);
+		void Remove(SceneActor* actor);
+		void SetDirty(SceneActor* actor);
+		void Update();
+
+		// candidates which may be in frustum, frustum NULL means all
+		void QueryFrustum(const Plane* frustum, std::vector<SceneActor*>& out_actors);
+
+		// candidates whose bounding circle contains world pos
+		void QueryPoint(const Vector3& world_pos, std::vector<SceneActor*>& out_actors);
+
+		inline float cell_size() { return cell_size_; }
+
+	private:
+		typedef std::pair<int, int> CellCoord;
+		typedef std::map<CellCoord, SpatialCell*> CellMap;
+
+		void AddToCell(SceneActor* actor, SpatialCell* cell);
+		void RemoveFromCell(SceneActor* actor);
+		SpatialCell* GetCell(const CellCoord& coord);
+		CellCoord GetCellCoord(const Vector3& pos);
+
+		float		cell_size_;
+
+		CellMap		cells_;
+		SpatialCell	unbounded_cell_;
+
+		std::vector<SceneActor*>	dirty_actors_;
+
+		float		max_radius_;
+	};
+}
+
+#endif // ERI_SPATIAL_INDEX_H
@@ -0,0 +1,239 @@
+//
+//  sprite_batch.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "sprite_batch.h"
+
+#include "root.h"
+#include "renderer.h"
+#include "scene_actor.h"
+
+#ifdef ERI_RENDERER_ES2
+#include "shader_mgr.h"
+#endif
+
+namespace ERI
+{
+	SpriteBatch::SpriteBatch() :
+		quad_num_(0),
+		instances_(NULL),
+		instance_buffer_(0)
+	{
+		vertices_ = new vertex_3_pos_color_tex[kMaxQuad * 4];
+
+		render_data_.vertex_type = GL_TRIANGLES;
+		render_data_.vertex_format = POS_COLOR_TEX_3;
+		render_data_.apply_identity_model_matrix = true;
+
+		instance_render_data_.vertex_type = GL_TRIANGLE_STRIP;
+		instance_render_data_.vertex_format = POS_TEX_2;
+		instance_render_data_.vertex_count = 4;
+		instance_render_data_.apply_identity_model_matrix = true;
+		instance_render_data_.disable_vertex_array = true;
+	}
+
+	SpriteBatch::~SpriteBatch()
+	{
+		delete [] vertices_;
+		if (instances_) delete [] instances_;
+
+		if (instance_buffer_) Root::Ins().renderer()->ReleaseBuffer(instance_buffer_);
+	}
+
+	void SpriteBatch::Add(SceneActor* actor, Renderer* renderer)
+	{
+		ASSERT(actor);
+
+		if (!actor->IsBatchable())
+		{
+			Flush(renderer);
+			actor->Draw(renderer);
+			return;
+		}
+
+		if (quad_num_ > 0 && (quad_num_ >= kMaxQuad || !IsSameState(actor)))
+			Flush(renderer);
+
+		actors_[quad_num_] = actor;
+		++quad_num_;
+	}
+
+	void SpriteBatch::Flush(Renderer* renderer)
+	{
+		if (quad_num_ == 0)
+			return;
+
+		if (quad_num_ == 1) // single sprite use its own vertex buffer
+		{
+			actors_[0]->Draw(renderer);
+		}
+		else
+		{
+			if (IsInstanceable(renderer))
+				RenderInstances(renderer);
+			else
+				RenderVertices(renderer);
+
+			RenderStats& stats = renderer->current_stats();
+			++stats.batch_draw_call;
+			stats.batched_actor += quad_num_;
+		}
+
+		quad_num_ = 0;
+	}
+
+	bool SpriteBatch::IsInstanceable(Renderer* renderer)
+	{
+#ifdef ERI_RENDERER_ES2
+		const RenderData& data = actors_[0]->render_data_;
+		const MaterialData& material = actors_[0]->material_data_;
+
+		// instanced program samples first texture only and replaces default program only,
+		// it has no alpha test nor fog
+		if (!renderer->caps().is_support_instancing ||
+			NULL == Root::Ins().shader_mgr() ||
+			NULL == Root::Ins().shader_mgr()->instanced_sprite_program() ||
+			NULL != data.program ||
+			1 != material.used_unit ||
+			(OPACITY_ALPHA_TEST == material.opacity_type && GL_ALWAYS != data.alpha_test_func) ||
+			material.accept_fog)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < quad_num_; ++i)
+		{
+			if (!actors_[i]->IsInstanceable())
+				return false;
+		}
+
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void SpriteBatch::CopyState(RenderData& data)
+	{
+		const RenderData& ref = actors_[0]->render_data_;
+
+		data.blend_src_factor = ref.blend_src_factor;
+		data.blend_dst_factor = ref.blend_dst_factor;
+		data.alpha_premultiplied = ref.alpha_premultiplied;
+		data.alpha_test_func = ref.alpha_test_func;
+		data.alpha_test_ref = ref.alpha_test_ref;
+		data.depth_test_func = ref.depth_test_func;
+		data.material_ref = &actors_[0]->material_data_;
+	}
+
+	void SpriteBatch::RenderVertices(Renderer* renderer)
+	{
+		for (int i = 0; i < quad_num_; ++i)
+		{
+			actors_[i]->FillBatchVertices(&vertices_[i * 4]);
+		}
+
+		if (render_data_.vertex_buffer == 0)
+			CreateBuffer();
+
+		renderer->UpdateBuffer(render_data_.vertex_buffer, BUFFER_VERTEX, vertices_, sizeof(vertex_3_pos_color_tex) * quad_num_ * 4, BUFFER_USAGE_DYNAMIC);
+
+		render_data_.vertex_count = quad_num_ * 4;
+		render_data_.index_count = quad_num_ * 6;
+		render_data_.program = actors_[0]->render_data_.program;
+		CopyState(render_data_);
+
+#ifdef ERI_RENDERER_ES2
+		if (Root::Ins().shader_mgr())
+			Root::Ins().shader_mgr()->Use(render_data_);
+#endif
+
+		renderer->EnableMaterial(render_data_.material_ref);
+		renderer->Render(&render_data_);
+	}
+
+	void SpriteBatch::RenderInstances(Renderer* renderer)
+	{
+#ifdef ERI_RENDERER_ES2
+		if (instance_buffer_ == 0)
+			CreateInstanceBuffer();
+
+		for (int i = 0; i < quad_num_; ++i)
+		{
+			actors_[i]->FillBatchInstance(&instances_[i]);
+		}
+
+		renderer->UpdateBuffer(instance_buffer_, BUFFER_VERTEX, instances_, sizeof(instance_sprite) * quad_num_, BUFFER_USAGE_DYNAMIC);
+
+		instance_render_data_.program = Root::Ins().shader_mgr()->instanced_sprite_program();
+		CopyState(instance_render_data_);
+
+		Root::Ins().shader_mgr()->Use(instance_render_data_.program);
+
+		renderer->EnableMaterial(instance_render_data_.material_ref);
+		renderer->RenderInstanced(&instance_render_data_, instance_buffer_, quad_num_);
+#endif
+	}
+
+	bool SpriteBatch::IsSameState(SceneActor* actor)
+	{
+		return actors_[0]->render_data_.IsSameState(actor->render_data_) &&
+			actors_[0]->material_data_.IsSameState(actor->material_data_);
+	}
+
+	void SpriteBatch::CreateBuffer()
+	{
+		Renderer* renderer = Root::Ins().renderer();
+
+		render_data_.vertex_buffer = renderer->GenerateBuffer();
+
+		// 2 - 3
+		// | \ |
+		// 0 - 1
+
+		unsigned short* indices = new unsigned short[kMaxQuad * 6];
+		for (int i = 0; i < kMaxQuad; ++i)
+		{
+			unsigned short base = static_cast<unsigned short>(i * 4);
+			indices[i * 6 + 0] = base;
+			indices[i * 6 + 1] = base + 1;
+			indices[i * 6 + 2] = base + 2;
+			indices[i * 6 + 3] = base + 2;
+			indices[i * 6 + 4] = base + 1;
+			indices[i * 6 + 5] = base + 3;
+		}
+
+		render_data_.index_buffer = renderer->GenerateBuffer();
+		renderer->UpdateBuffer(render_data_.index_buffer, BUFFER_INDEX, indices, sizeof(unsigned short) * kMaxQuad * 6, BUFFER_USAGE_STATIC);
+
+		delete [] indices;
+	}
+
+	void SpriteBatch::CreateInstanceBuffer()
+	{
+		instances_ = new instance_sprite[kMaxQuad];
+
+		Renderer* renderer = Root::Ins().renderer();
+
+		instance_buffer_ = renderer->GenerateBuffer();
+
+		// unit quad as strip, uv is derived from position in instanced program
+
+		vertex_2_pos_tex v[] =
+		{
+			{ -0.5f, -0.5f, 0.0f, 1.0f },
+			{ 0.5f, -0.5f, 1.0f, 1.0f },
+			{ -0.5f, 0.5f, 0.0f, 0.0f },
+			{ 0.5f, 0.5f, 1.0f, 0.0f }
+		};
+
+		instance_render_data_.vertex_buffer = renderer->GenerateBuffer();
+		renderer->UpdateBuffer(instance_render_data_.vertex_buffer, BUFFER_VERTEX, v, sizeof(v), BUFFER_USAGE_STATIC);
+	}
+}
@@ -0,0 +1,57 @@
+//
+//  sprite_batch.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_SPRITE_BATCH_H
+#define ERI_SPRITE_BATCH_H
+
+#include "render_data.h"
+
+namespace ERI
+{
+	class Renderer;
+	class SceneActor;
+
+	// Collect batchable sprites which share same render state and draw them with one draw call.
+	// With instancing support and instanced sprite program set, a shared unit quad is drawn
+	// once per sprite with per instance transform, uv rect and color,
+	// otherwise quads are transformed to world space on cpu and drawn indexed.
+
+	class SpriteBatch
+	{
+	public:
+		SpriteBatch();
+		~SpriteBatch();
+
+		// actor should be visible and in frustum
+		void Add(SceneActor* actor, Renderer* renderer);
+		void Flush(Renderer* renderer);
+
+	private:
+		bool IsSameState(SceneActor* actor);
+		bool IsInstanceable(Renderer* renderer);
+		void CopyState(RenderData& data);
+		void RenderVertices(Renderer* renderer);
+		void RenderInstances(Renderer* renderer);
+		void CreateBuffer();
+		void CreateInstanceBuffer();
+
+		static const int kMaxQuad = 4096;
+
+		SceneActor*				actors_[kMaxQuad];
+		int						quad_num_;
+
+		vertex_3_pos_color_tex*	vertices_;
+		instance_sprite*		instances_;
+
+		RenderData		render_data_;
+		RenderData		instance_render_data_;
+		GLuint			instance_buffer_;
+	};
+}
+
+#endif // ERI_SPRITE_BATCH_H
@@ -0,0 +1,240 @@
+//
+//  stream_buffer.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "stream_buffer.h"
+
+#include "root.h"
+#include "renderer.h"
+#include "render_data.h"
+
+namespace ERI
+{
+	// keep vertex attribute offsets aligned
+	static const int kWriteAlign = 16;
+
+#pragma mark StreamBuffer
+
+	StreamBuffer::StreamBuffer(int frame_size) :
+		buffer_(0),
+		frame_size_(frame_size),
+		frame_idx_(0),
+		used_size_(0),
+		last_used_size_(0),
+		overflow_size_(0),
+		frame_id_(1)
+	{
+		ASSERT(frame_size_ > 0);
+
+		for (int i = 0; i < kFrameNum; ++i)
+		{
+			fences_[i] = NULL;
+		}
+
+		CreateBuffer();
+	}
+
+	StreamBuffer::~StreamBuffer()
+	{
+		Renderer* renderer = Root::Ins().renderer();
+
+		for (int i = 0; i < kFrameNum; ++i)
+		{
+			if (fences_[i]) renderer->DeleteFence(fences_[i]);
+		}
+
+		if (buffer_) renderer->ReleaseBuffer(buffer_);
+	}
+
+	int StreamBuffer::Write(const void* data, int size)
+	{
+		ASSERT(size >= 0);
+
+		int aligned_size = (size + kWriteAlign - 1) & ~(kWriteAlign - 1);
+
+		if (used_size_ + aligned_size > frame_size_)
+		{
+			overflow_size_ += aligned_size;
+			return -1;
+		}
+
+		int offset = frame_idx_ * frame_size_ + used_size_;
+
+		Root::Ins().renderer()->UpdateBufferRange(buffer_, BUFFER_VERTEX, offset, data, size);
+
+		used_size_ += aligned_size;
+
+		return offset;
+	}
+
+	void StreamBuffer::NextFrame(Renderer* renderer)
+	{
+		fences_[frame_idx_] = renderer->CreateFence();
+
+		last_used_size_ = used_size_;
+		used_size_ = 0;
+		++frame_id_;
+
+		if (overflow_size_ > 0)
+		{
+			int need_size = last_used_size_ + overflow_size_;
+			while (frame_size_ < need_size)
+				frame_size_ *= 2;
+
+			overflow_size_ = 0;
+
+			LOGI("stream buffer grow to %d bytes per frame", frame_size_);
+
+			// new storage, parts in flight keep reading old one
+			for (int i = 0; i < kFrameNum; ++i)
+			{
+				if (fences_[i])
+				{
+					renderer->DeleteFence(fences_[i]);
+					fences_[i] = NULL;
+				}
+			}
+
+			frame_idx_ = 0;
+			CreateBuffer();
+			return;
+		}
+
+		frame_idx_ = (frame_idx_ + 1) % kFrameNum;
+
+		if (fences_[frame_idx_])
+		{
+			renderer->WaitFence(fences_[frame_idx_]);
+			renderer->DeleteFence(fences_[frame_idx_]);
+			fences_[frame_idx_] = NULL;
+		}
+		else if (0 == frame_idx_)
+		{
+			// no fence, orphan whole buffer when ring wraps
+			renderer->UpdateBuffer(buffer_, BUFFER_VERTEX, NULL, frame_size_ * kFrameNum, BUFFER_USAGE_DYNAMIC);
+		}
+	}
+
+	void StreamBuffer::CreateBuffer()
+	{
+		Renderer* renderer = Root::Ins().renderer();
+
+		if (0 == buffer_)
+			buffer_ = renderer->GenerateBuffer();
+
+		renderer->UpdateBuffer(buffer_, BUFFER_VERTEX, NULL, frame_size_ * kFrameNum, BUFFER_USAGE_DYNAMIC);
+	}
+
+#pragma mark StreamVertex
+
+	StreamVertex::StreamVertex() :
+		frame_id_(0),
+		is_written_(false),
+		is_settled_(false),
+		own_buffer_(0)
+	{
+	}
+
+	StreamVertex::~StreamVertex()
+	{
+		ASSERT2(0 == own_buffer_, "release before delete!");
+	}
+
+	void StreamVertex::Update(RenderData& data, const void* vertices, int size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(vertices);
+		vertices_.assign(bytes, bytes + size);
+
+		Write(data);
+	}
+
+	void StreamVertex::Prepare(RenderData& data)
+	{
+		if (!is_written_ || is_settled_)
+			return;
+
+		// unchanged since last frame, likely to stay so
+		StreamBuffer* stream_buffer = Root::Ins().stream_buffer();
+		if (stream_buffer && frame_id_ != stream_buffer->frame_id())
+			Settle(data);
+	}
+
+	void StreamVertex::Release(RenderData& data)
+	{
+		// render data should not delete shared buffer
+		if (is_written_)
+		{
+			data.vertex_buffer = 0;
+			data.vertex_offset = 0;
+		}
+
+		if (own_buffer_)
+		{
+			Root::Ins().renderer()->ReleaseBuffer(own_buffer_);
+			own_buffer_ = 0;
+		}
+
+		is_written_ = false;
+		is_settled_ = false;
+	}
+
+	void StreamVertex::Write(RenderData& data)
+	{
+		StreamBuffer* stream_buffer = Root::Ins().stream_buffer();
+
+		int size = static_cast<int>(vertices_.size());
+		const void* vertices = size > 0 ? &vertices_[0] : NULL;
+
+		int offset = stream_buffer ? stream_buffer->Write(vertices, size) : -1;
+
+		if (offset >= 0)
+		{
+			data.vertex_buffer = stream_buffer->buffer();
+			data.vertex_offset = offset;
+		}
+		else
+		{
+			Renderer* renderer = Root::Ins().renderer();
+
+			if (0 == own_buffer_)
+				own_buffer_ = renderer->GenerateBuffer();
+
+			renderer->UpdateBuffer(own_buffer_, BUFFER_VERTEX, vertices, size, BUFFER_USAGE_DYNAMIC);
+
+			data.vertex_buffer = own_buffer_;
+			data.vertex_offset = 0;
+		}
+
+		// offset changes every frame, can't be kept in vertex array object
+		data.disable_vertex_array = true;
+
+		frame_id_ = stream_buffer ? stream_buffer->frame_id() : 0;
+		is_written_ = true;
+		is_settled_ = false;
+	}
+
+	void StreamVertex::Settle(RenderData& data)
+	{
+		Renderer* renderer = Root::Ins().renderer();
+
+		if (0 == own_buffer_)
+			own_buffer_ = renderer->GenerateBuffer();
+
+		int size = static_cast<int>(vertices_.size());
+		renderer->UpdateBuffer(own_buffer_, BUFFER_VERTEX, size > 0 ? &vertices_[0] : NULL, size, BUFFER_USAGE_STATIC);
+
+		data.vertex_buffer = own_buffer_;
+		data.vertex_offset = 0;
+		data.disable_vertex_array = false;
+
+		std::vector<unsigned char>().swap(vertices_);
+
+		is_settled_ = true;
+	}
+}
@@ -0,0 +1,96 @@
+//
+//  stream_buffer.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_STREAM_BUFFER_H
+#define ERI_STREAM_BUFFER_H
+
+#include "pch.h"
+
+#include <vector>
+
+namespace ERI
+{
+	class Renderer;
+	struct RenderData;
+
+	// Ring of one vertex buffer shared by dynamic vertices, split to one part per frame in flight.
+	// Data written in a frame goes to its own part, so buffer storage the gpu may still read is never touched.
+	//
+	// With fence support, reusing a part waits on the fence inserted when its frame ended,
+	// otherwise whole buffer is orphaned when the ring wraps.
+	// Part overflowed in a frame is grown at next frame.
+
+	class StreamBuffer
+	{
+	public:
+		StreamBuffer(int frame_size);
+		~StreamBuffer();
+
+		// return byte offset in buffer, -1 if part of current frame is full
+		int Write(const void* data, int size);
+
+		// call after frame commands are all issued
+		void NextFrame(Renderer* renderer);
+
+		inline GLuint buffer() { return buffer_; }
+		inline unsigned int frame_id() { return frame_id_; }
+
+		// bytes written in last frame
+		inline int used_size() { return last_used_size_; }
+
+	private:
+		static const int kFrameNum = 3;
+
+		void CreateBuffer();
+
+		GLuint	buffer_;
+		int		frame_size_;
+		int		frame_idx_;
+		int		used_size_;
+		int		last_used_size_;
+		int		overflow_size_;
+
+		void*	fences_[kFrameNum];
+
+		unsigned int	frame_id_;
+	};
+
+	// Dynamic vertices of one render data, written to stream buffer in the frame they change.
+	// If they are drawn unchanged in a later frame, where old part may be reused already,
+	// they are moved to its own buffer once and drawn from there until next update.
+	// Falls back to its own buffer if stream buffer is full.
+
+	class StreamVertex
+	{
+	public:
+		StreamVertex();
+		~StreamVertex();
+
+		void Update(RenderData& data, const void* vertices, int size);
+
+		// call before data is drawn
+		void Prepare(RenderData& data);
+
+		// detach buffers from data before it is released
+		void Release(RenderData& data);
+
+	private:
+		void Write(RenderData& data);
+		void Settle(RenderData& data);
+
+		std::vector<unsigned char>	vertices_; // kept until settled
+
+		unsigned int	frame_id_;
+		bool			is_written_;
+		bool			is_settled_;
+
+		GLuint			own_buffer_;
+	};
+}
+
+#endif // ERI_STREAM_BUFFER_H
@@ -16,6 +16,12 @@
 
 #include <fstream>
 
+#if ERI_PLATFORM == ERI_PLATFORM_WIN
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
 #include "platform_helper.h"
 
 namespace ERI
@@ -160,6 +166,25 @@ bool IsFileExist(const std::string& path)
 	return true;
 }
 
+double GetTimeStamp()
+{
+#if ERI_PLATFORM == ERI_PLATFORM_WIN
+	static LARGE_INTEGER frequency;
+	if (0 == frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+#else
+	timeval now;
+	gettimeofday(&now, NULL);
+	
+	return now.tv_sec + now.tv_usec * 0.000001;
+#endif
+}
+
 FileReader::FileReader() : info_(NULL)
 {
 }
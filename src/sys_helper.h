@@ -32,6 +32,9 @@ bool GetFileContentString(const std::string& path, std::string& out_content);
   
 bool IsFileExist(const std::string& path);
 
+// seconds from an arbitrary start, for measuring durations
+double GetTimeStamp();
+
 struct FileReaderInfo;
 class FileReader
 {
@@ -36,6 +36,7 @@
 #include "scene_mgr.h"
 #include "scene_actor.h"
 #include "root.h"
+#include "frame_pipeline.h"
 
 namespace ERI {
 	
@@ -83,6 +84,8 @@ namespace ERI {
 	
 	void Texture::ReleaseFromRenderer()
 	{
+		RendererLock lock;
+		
 		Root::Ins().renderer()->ReleaseTexture(id);
 		id = 0;
 	}
@@ -233,7 +236,12 @@ namespace ERI {
 			return it->second;
 		}
 
-		unsigned int texture_id = Root::Ins().renderer()->GenerateTexture(data, width, height, pixel_format);
+		unsigned int texture_id;
+		{
+			RendererLock lock;
+			texture_id = Root::Ins().renderer()->GenerateTexture(data, width, height, pixel_format);
+		}
+		
 		if (texture_id == 0)
 			return NULL;
 		
@@ -267,6 +275,8 @@ namespace ERI {
 	{
 		ASSERT(tex && tex->id > 0 && data);
 		
+		RendererLock lock;
+		
 		Root::Ins().renderer()->UpdateTexture(tex->id, data, tex->width, tex->height, RGBA);
 	}
 
@@ -320,7 +330,9 @@ namespace ERI {
 		pixel_format_(RGBA),
 		render_cam_(render_cam),
 		default_cam_(NULL),
-		out_copy_pixels_(NULL)
+		out_copy_pixels_(NULL),
+		read_pixels_func_(NULL),
+		read_pixels_data_(NULL)
 	{
 	}
 	
@@ -405,6 +417,11 @@ namespace ERI {
 		{
 			Root::Ins().renderer()->CopyPixels(out_copy_pixels_, 0, 0, width_, height_, pixel_format_);
 		}
+		
+		if (read_pixels_func_)
+		{
+			Root::Ins().renderer()->ReadPixelsAsync(0, 0, width_, height_, pixel_format_, read_pixels_func_, read_pixels_data_);
+		}
 	
 		//
 		
@@ -422,9 +439,20 @@ namespace ERI {
 	
 	void RenderToTexture::ProcessRender()
 	{
+		Root::Ins().renderer()->BeginGpuTimer(GPU_TIMER_RENDER_TO_TEXTURE);
 		PreProcess();
 		Root::Ins().scene_mgr()->Render(Root::Ins().renderer());
 		PostProcess();
+		Root::Ins().renderer()->EndGpuTimer();
+	}
+	
+	void RenderToTexture::ProcessRender(int layer_id)
+	{
+		Root::Ins().renderer()->BeginGpuTimer(GPU_TIMER_RENDER_TO_TEXTURE, layer_id);
+		PreProcess();
+		Root::Ins().scene_mgr()->RenderLayer(layer_id, Root::Ins().renderer());
+		PostProcess();
+		Root::Ins().renderer()->EndGpuTimer();
 	}
 	
 	void RenderToTexture::CopyPixels(void* out_copy_pixels)
@@ -432,4 +460,10 @@ namespace ERI {
 		out_copy_pixels_ = out_copy_pixels;
 	}
 	
+	void RenderToTexture::CopyPixelsAsync(ReadPixelsFunc func, void* data)
+	{
+		read_pixels_func_ = func;
+		read_pixels_data_ = data;
+	}
+	
 }
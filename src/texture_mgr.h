@@ -183,9 +183,14 @@ namespace ERI {
 		void Release();
     
 		void ProcessRender();
+		void ProcessRender(int layer_id);
 		
+		// pixels of each following render are read into out_copy_pixels at once, NULL to stop
 		void CopyPixels(void* out_copy_pixels);
 		
+		// or delivered to func a frame or two later without stall, see Renderer::ReadPixelsAsync, NULL to stop
+		void CopyPixelsAsync(ReadPixelsFunc func, void* data);
+		
 		inline const Texture* texture() { return texture_; }
 		inline void set_pixel_format(PixelFormat format) { pixel_format_ = format; }
 		
@@ -207,6 +212,8 @@ namespace ERI {
 		CameraActor *render_cam_, *default_cam_;
 		
 		void*			out_copy_pixels_;
+		ReadPixelsFunc	read_pixels_func_;
+		void*			read_pixels_data_;
 	};
 	
 }
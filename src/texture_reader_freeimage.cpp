@@ -15,6 +15,7 @@
 
 #include "root.h"
 #include "renderer.h"
+#include "frame_pipeline.h"
 #include "platform_helper.h"
 
 namespace ERI {
@@ -100,6 +101,8 @@ namespace ERI {
 
 	void TextureReaderFreeImage::Generate()
 	{
+		RendererLock lock;
+		
 		texture_id_ = Root::Ins().renderer()->GenerateTexture(texture_data_, width_, height_, RGBA);
 	}
 
@@ -17,6 +17,7 @@
 
 #include "root.h"
 #include "renderer.h"
+#include "frame_pipeline.h"
 #include "sys_helper.h"
 
 // for iOS simulator build
@@ -294,6 +295,8 @@ namespace ERI {
 	
 	void TextureReaderLibPNG::Generate()
 	{
+		RendererLock lock;
+		
 		texture_id_ = Root::Ins().renderer()->GenerateTexture(texture_data_, width_, height_, RGBA);
 	}
 }
@@ -0,0 +1,112 @@
+//
+//  thread_helper.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "thread_helper.h"
+
+namespace ERI
+{
+#ifdef ERI_USE_THREAD
+
+#pragma mark Thread
+
+	Thread::Thread() :
+		func_(NULL),
+		data_(NULL),
+		is_started_(false)
+	{
+	}
+
+	Thread::~Thread()
+	{
+		ASSERT(!is_started_);
+	}
+
+	bool Thread::Start(ThreadFunc func, void* data)
+	{
+		ASSERT(!is_started_);
+		ASSERT(func);
+
+		func_ = func;
+		data_ = data;
+
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+		handle_ = ::CreateThread(NULL, 0, ThreadMain, this, 0, NULL);
+		is_started_ = (NULL != handle_);
+#  else
+		is_started_ = (0 == pthread_create(&handle_, NULL, ThreadMain, this));
+#  endif
+
+		return is_started_;
+	}
+
+	void Thread::Join()
+	{
+		if (!is_started_)
+			return;
+
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+		WaitForSingleObject(handle_, INFINITE);
+		CloseHandle(handle_);
+#  else
+		pthread_join(handle_, NULL);
+#  endif
+
+		is_started_ = false;
+	}
+
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+	DWORD WINAPI Thread::ThreadMain(LPVOID arg)
+#  else
+	void* Thread::ThreadMain(void* arg)
+#  endif
+	{
+		Thread* thread = static_cast<Thread*>(arg);
+		thread->func_(thread->data_);
+		return 0;
+	}
+
+#pragma mark Mutex
+
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+
+	Mutex::Mutex() { InitializeCriticalSection(&mutex_); }
+	Mutex::~Mutex() { DeleteCriticalSection(&mutex_); }
+	void Mutex::Lock() { EnterCriticalSection(&mutex_); }
+	void Mutex::Unlock() { LeaveCriticalSection(&mutex_); }
+
+#  else
+
+	Mutex::Mutex() { pthread_mutex_init(&mutex_, NULL); }
+	Mutex::~Mutex() { pthread_mutex_destroy(&mutex_); }
+	void Mutex::Lock() { pthread_mutex_lock(&mutex_); }
+	void Mutex::Unlock() { pthread_mutex_unlock(&mutex_); }
+
+#  endif
+
+#pragma mark Condition
+
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+
+	Condition::Condition() { InitializeConditionVariable(&cond_); }
+	Condition::~Condition() {}
+	void Condition::Wait(Mutex& mutex) { SleepConditionVariableCS(&cond_, &mutex.mutex_, INFINITE); }
+	void Condition::NotifyAll() { WakeAllConditionVariable(&cond_); }
+
+#  else
+
+	Condition::Condition() { pthread_cond_init(&cond_, NULL); }
+	Condition::~Condition() { pthread_cond_destroy(&cond_); }
+	void Condition::Wait(Mutex& mutex) { pthread_cond_wait(&cond_, &mutex.mutex_); }
+	void Condition::NotifyAll() { pthread_cond_broadcast(&cond_); }
+
+#  endif
+
+#endif // ERI_USE_THREAD
+}
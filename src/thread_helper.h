@@ -0,0 +1,126 @@
+//
+//  thread_helper.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_THREAD_HELPER_H
+#define ERI_THREAD_HELPER_H
+
+#include "pch.h"
+
+#if ERI_PLATFORM != ERI_PLATFORM_EMSCRIPTEN
+#define ERI_USE_THREAD
+#endif
+
+#ifdef ERI_USE_THREAD
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+#    include <windows.h>
+#  else
+#    include <pthread.h>
+#  endif
+#endif
+
+namespace ERI
+{
+#ifdef ERI_USE_THREAD
+
+	typedef void (*ThreadFunc)(void* data);
+
+	class Thread
+	{
+	public:
+		Thread();
+		~Thread();
+
+		bool Start(ThreadFunc func, void* data);
+		void Join();
+
+		inline bool is_started() { return is_started_; }
+
+	private:
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+		static DWORD WINAPI ThreadMain(LPVOID arg);
+		HANDLE		handle_;
+#  else
+		static void* ThreadMain(void* arg);
+		pthread_t	handle_;
+#  endif
+
+		ThreadFunc	func_;
+		void*		data_;
+		bool		is_started_;
+	};
+
+	class Mutex
+	{
+	public:
+		Mutex();
+		~Mutex();
+
+		void Lock();
+		void Unlock();
+
+	private:
+		friend class Condition;
+
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+		CRITICAL_SECTION	mutex_;
+#  else
+		pthread_mutex_t		mutex_;
+#  endif
+	};
+
+	class Condition
+	{
+	public:
+		Condition();
+		~Condition();
+
+		// mutex should be locked
+		void Wait(Mutex& mutex);
+		void NotifyAll();
+
+	private:
+#  if ERI_PLATFORM == ERI_PLATFORM_WIN
+		CONDITION_VARIABLE	cond_;
+#  else
+		pthread_cond_t		cond_;
+#  endif
+	};
+
+#else
+
+	// no thread support, lock is no-op and thread can't start
+
+	typedef void (*ThreadFunc)(void* data);
+
+	class Thread
+	{
+	public:
+		bool Start(ThreadFunc func, void* data) { return false; }
+		void Join() {}
+
+		inline bool is_started() { return false; }
+	};
+
+	class Mutex
+	{
+	public:
+		void Lock() {}
+		void Unlock() {}
+	};
+
+	class Condition
+	{
+	public:
+		void Wait(Mutex& mutex) { ASSERT(0); }
+		void NotifyAll() {}
+	};
+
+#endif // ERI_USE_THREAD
+}
+
+#endif // ERI_THREAD_HELPER_H
@@ -0,0 +1,176 @@
+//
+//  frame_replay.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//  Replay a frame capture and time it.
+//
+//  frame_replay <capture> [-repeat n] [-headless] [-shader vsh fsh] [-instanced vsh fsh]
+//
+//  Window and GL context come from SDL framework if built with ERI_USE_SDL,
+//  otherwise or with -headless, null renderer runs without GPU.
+//  Shader paths are relative to resource path, -shader sets variant template,
+//  -instanced sets instanced sprite program, instanced draws are skipped without it.
+//
+//  No project builds it, on linux with SDL2, GLEW and libpng, run in src as one command:
+//
+//  g++ -DERI_RENDERER_ES2 -I. -I../demo/3rd/rapidxml `sdl2-config --cflags` `pkg-config --cflags libpng`
+//      *.cpp linux/*.cpp tools/frame_replay.cpp
+//      `sdl2-config --libs` `pkg-config --libs libpng` -lGLEW -lGL -lpthread -o frame_replay
+//
+//  elsewhere add it to a command line target with the library sources.
+//
+
+#include "pch.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#include "root.h"
+#include "renderer.h"
+#include "frame_capture.h"
+#include "framework_sdl.h"
+
+#ifdef ERI_RENDERER_ES2
+#include "shader_mgr.h"
+#endif
+
+static void PrintUsage()
+{
+	printf("usage: frame_replay <capture> [-repeat n] [-headless] [-shader vsh fsh] [-instanced vsh fsh]\n");
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const char* capture_path = argv[1];
+	int repeat = 1;
+	bool is_headless = false;
+#ifdef ERI_RENDERER_ES2
+	const char* shader_paths[2] = { NULL, NULL };
+	const char* instanced_paths[2] = { NULL, NULL };
+#endif
+
+	for (int i = 2; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc)
+		{
+			repeat = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-headless") == 0)
+		{
+			is_headless = true;
+		}
+#ifdef ERI_RENDERER_ES2
+		else if (strcmp(argv[i], "-shader") == 0 && i + 2 < argc)
+		{
+			shader_paths[0] = argv[++i];
+			shader_paths[1] = argv[++i];
+		}
+		else if (strcmp(argv[i], "-instanced") == 0 && i + 2 < argc)
+		{
+			instanced_paths[0] = argv[++i];
+			instanced_paths[1] = argv[++i];
+		}
+#endif
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (repeat < 1) repeat = 1;
+
+	ERI::FrameReplay replay;
+
+	if (!replay.Load(capture_path))
+		return 1;
+
+	printf("capture %s: %d frames, %d x %d\n", capture_path, replay.frame_num(), replay.capture_width(), replay.capture_height());
+
+#ifdef ERI_USE_SDL
+	Framework* framework = NULL;
+	if (!is_headless)
+	{
+		framework = new Framework(replay.capture_width(), replay.capture_height(), "frame_replay");
+		framework->Run();
+	}
+#else
+	is_headless = true;
+#endif
+
+	if (is_headless)
+		ERI::Root::Ins().Init(true, true);
+
+	ERI::Renderer* renderer = ERI::Root::Ins().renderer();
+	renderer->Resize(replay.capture_width(), replay.capture_height());
+
+	printf("renderer: %s\n", renderer->caps().version.c_str());
+
+#ifdef ERI_RENDERER_ES2
+	ERI::ShaderMgr* shader_mgr = ERI::Root::Ins().shader_mgr();
+	if (shader_mgr)
+	{
+		if (shader_paths[0])
+			shader_mgr->SetVariantTemplate(shader_paths[0], shader_paths[1]);
+
+		if (instanced_paths[0])
+			shader_mgr->set_instanced_sprite_program(shader_mgr->Create("instanced_sprite", instanced_paths[0], instanced_paths[1]));
+	}
+#endif
+
+	int result = 0;
+
+	for (int i = 0; i < repeat; ++i)
+	{
+		if (!replay.Replay(renderer))
+		{
+			result = 1;
+			break;
+		}
+
+		const std::vector<double>& frame_ms = replay.frame_ms();
+		if (frame_ms.empty())
+			continue;
+
+		double total_ms = 0.0;
+		for (size_t j = 0; j < frame_ms.size(); ++j)
+			total_ms += frame_ms[j];
+
+		printf("replay %d: avg %.3f ms, min %.3f ms, max %.3f ms, last frame draw call %d",
+			   i,
+			   total_ms / frame_ms.size(),
+			   *std::min_element(frame_ms.begin(), frame_ms.end()),
+			   *std::max_element(frame_ms.begin(), frame_ms.end()),
+			   renderer->stats().draw_call);
+
+		if (replay.skipped_draw() > 0)
+			printf(", skipped %d instanced draws", replay.skipped_draw());
+
+		printf("\n");
+	}
+
+	replay.Release();
+
+#ifdef ERI_USE_SDL
+	if (framework)
+	{
+		delete framework;
+		return result;
+	}
+#endif
+
+	ERI::Root::DestroyIns();
+
+	return result;
+}
@@ -0,0 +1,206 @@
+//
+//  transform_system.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "transform_system.h"
+
+#include "scene_actor.h"
+
+namespace ERI
+{
+	TransformSystem::TransformSystem() :
+		version_(1),
+		is_order_dirty_(false),
+		has_dirty_(false),
+		is_updating_(false)
+	{
+	}
+
+	TransformSystem::~TransformSystem()
+	{
+		size_t num = nodes_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			nodes_[i]->transform_idx_ = -1;
+		}
+	}
+
+	void TransformSystem::Register(SceneActor* actor)
+	{
+		ASSERT(actor);
+		ASSERT(actor->transform_idx_ < 0);
+
+		actor->transform_idx_ = static_cast<int>(nodes_.size());
+		nodes_.push_back(actor);
+		parent_indices_.push_back(-1);
+		dirty_flags_.push_back(0);
+
+		is_order_dirty_ = true;
+	}
+
+	void TransformSystem::Unregister(SceneActor* actor)
+	{
+		ASSERT(actor);
+
+		int idx = actor->transform_idx_;
+
+		ASSERT(idx >= 0 && idx < static_cast<int>(nodes_.size()) && nodes_[idx] == actor);
+
+		int last = static_cast<int>(nodes_.size()) - 1;
+		if (idx < last)
+		{
+			nodes_[idx] = nodes_[last];
+			dirty_flags_[idx] = dirty_flags_[last];
+			nodes_[idx]->transform_idx_ = idx;
+		}
+
+		nodes_.pop_back();
+		parent_indices_.pop_back();
+		dirty_flags_.pop_back();
+
+		actor->transform_idx_ = -1;
+
+		is_order_dirty_ = true;
+	}
+
+	void TransformSystem::SetChildsDirty(SceneActor* actor, bool is_depth_dirty)
+	{
+		ASSERT(actor->transform_idx_ >= 0);
+
+		dirty_flags_[actor->transform_idx_] |= is_depth_dirty ? (CHILD_DIRTY | CHILD_DEPTH_DIRTY) : CHILD_DIRTY;
+
+		has_dirty_ = true;
+		++version_;
+	}
+
+	void TransformSystem::CheckAncestorDirty(SceneActor* actor)
+	{
+		if (is_updating_ || !has_dirty_ || actor->transform_version_ == version_)
+			return;
+
+		actor->transform_version_ = version_;
+
+		bool is_dirty = false;
+		bool is_depth_dirty = false;
+
+		for (SceneActor* ancestor = actor->parent_; ancestor; ancestor = ancestor->parent_)
+		{
+			if (ancestor->transform_idx_ >= 0)
+			{
+				unsigned char flags = dirty_flags_[ancestor->transform_idx_];
+				if (flags & CHILD_DIRTY)
+				{
+					is_dirty = true;
+					if (flags & CHILD_DEPTH_DIRTY)
+					{
+						is_depth_dirty = true;
+						break;
+					}
+				}
+			}
+		}
+
+		if (is_dirty)
+		{
+			actor->render_data_.need_update_world_model_matrix = true;
+			actor->render_data_.need_update_inv_world_model_matrix = true;
+
+			if (is_depth_dirty)
+				actor->is_view_depth_dirty_ = true;
+		}
+	}
+
+	void TransformSystem::Update()
+	{
+		if (is_order_dirty_)
+			RebuildOrder();
+
+		if (!has_dirty_)
+			return;
+
+		is_updating_ = true;
+
+		size_t num = nodes_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			SceneActor* actor = nodes_[i];
+
+			int parent_idx = parent_indices_[i];
+			if (parent_idx >= 0 && (dirty_flags_[parent_idx] & CHILD_DIRTY))
+			{
+				bool is_depth_dirty = (dirty_flags_[parent_idx] & CHILD_DEPTH_DIRTY) != 0;
+
+				actor->MarkWorldTransformDirty(is_depth_dirty);
+
+				if (!actor->childs_.empty())
+					dirty_flags_[i] |= dirty_flags_[parent_idx];
+			}
+
+			// parent is updated before, no recursion here
+			if (actor->render_data_.need_update_world_model_matrix)
+				actor->GetWorldTransform();
+		}
+
+		if (num > 0)
+			memset(&dirty_flags_[0], 0, num);
+
+		has_dirty_ = false;
+		is_updating_ = false;
+	}
+
+	void TransformSystem::RebuildOrder()
+	{
+		size_t num = nodes_.size();
+
+		tmp_nodes_.clear();
+		tmp_dirty_flags_.clear();
+
+		for (size_t i = 0; i < num; ++i)
+		{
+			SceneActor* root = nodes_[i];
+			if (root->parent_ && root->parent_->transform_idx_ >= 0)
+				continue;
+
+			stack_.push_back(root);
+
+			while (!stack_.empty())
+			{
+				SceneActor* actor = stack_.back();
+				stack_.pop_back();
+
+				tmp_nodes_.push_back(actor);
+				tmp_dirty_flags_.push_back(dirty_flags_[actor->transform_idx_]);
+
+				for (int j = static_cast<int>(actor->childs_.size()) - 1; j >= 0; --j)
+				{
+					if (actor->childs_[j]->transform_idx_ >= 0)
+						stack_.push_back(actor->childs_[j]);
+				}
+			}
+		}
+
+		ASSERT(tmp_nodes_.size() == num);
+
+		nodes_.swap(tmp_nodes_);
+		dirty_flags_.swap(tmp_dirty_flags_);
+
+		for (size_t i = 0; i < num; ++i)
+		{
+			nodes_[i]->transform_idx_ = static_cast<int>(i);
+		}
+
+		for (size_t i = 0; i < num; ++i)
+		{
+			SceneActor* parent = nodes_[i]->parent_;
+			parent_indices_[i] = (parent && parent->transform_idx_ >= 0) ? parent->transform_idx_ : -1;
+		}
+
+		is_order_dirty_ = false;
+	}
+}
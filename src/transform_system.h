@@ -0,0 +1,64 @@
+//
+//  transform_system.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_TRANSFORM_SYSTEM_H
+#define ERI_TRANSFORM_SYSTEM_H
+
+#include <vector>
+
+namespace ERI
+{
+	class SceneActor;
+
+	// Flat hierarchy of actors which have parent or childs.
+	// Nodes are kept in parent before child order with parent index and dirty flags in their own arrays,
+	// so moving an actor only flags it and one linear pass per frame propagates to whole subtrees.
+
+	class TransformSystem
+	{
+	public:
+		TransformSystem();
+		~TransformSystem();
+
+		void Register(SceneActor* actor);
+		void Unregister(SceneActor* actor);
+
+		inline void SetOrderDirty() { is_order_dirty_ = true; }
+
+		void SetChildsDirty(SceneActor* actor, bool is_depth_dirty);
+
+		// mark actor dirty if any ancestor moved but not propagated yet
+		void CheckAncestorDirty(SceneActor* actor);
+
+		void Update();
+
+	private:
+		enum DirtyFlag
+		{
+			CHILD_DIRTY = 0x1,
+			CHILD_DEPTH_DIRTY = 0x2
+		};
+
+		void RebuildOrder();
+
+		std::vector<SceneActor*>	nodes_;
+		std::vector<int>			parent_indices_;
+		std::vector<unsigned char>	dirty_flags_;
+
+		std::vector<SceneActor*>	tmp_nodes_;
+		std::vector<unsigned char>	tmp_dirty_flags_;
+		std::vector<SceneActor*>	stack_;
+
+		unsigned int	version_;
+		bool			is_order_dirty_;
+		bool			has_dirty_;
+		bool			is_updating_;
+	};
+}
+
+#endif // ERI_TRANSFORM_SYSTEM_H
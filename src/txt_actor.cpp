@@ -12,6 +12,7 @@
 
 #include "root.h"
 #include "font_mgr.h"
+#include "scene_mgr.h"
 
 #include "platform_helper.h"
 
@@ -98,11 +99,6 @@ class SpriteTxtMeshConstructor : public TxtMeshConstructor
     owner_->width_ = Round(width / resolution_scale);
     owner_->height_ = Round(height / resolution_scale);
     
-    if (owner_->render_data_.vertex_buffer == 0)
-    {
-      glGenBuffers(1, &owner_->render_data_.vertex_buffer);
-    }
-		    
     float size_scale = font->GetSizeScale(owner_->font_size_);
 
     Vector2 size(Round(owner_->width_ * size_scale),
@@ -137,8 +133,7 @@ class SpriteTxtMeshConstructor : public TxtMeshConstructor
     owner_->render_data_.vertex_format = POS_TEX_2;
     owner_->render_data_.vertex_count = 4;
     
-    glBindBuffer(GL_ARRAY_BUFFER, owner_->render_data_.vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
+    owner_->UpdateStaticVertex(v, sizeof(v));
   }
   
  private:
@@ -187,11 +182,6 @@ class AtlasTxtMeshConstructor : public TxtMeshConstructor
       vertices_ = static_cast<vertex_2_pos_tex*>(malloc(now_len_max_ * unit_vertex_num * sizeof(vertex_2_pos_tex)));
     }
     
-    if (owner_->render_data_.vertex_buffer == 0)
-    {
-      glGenBuffers(1, &owner_->render_data_.vertex_buffer);
-    }
-    
     float inv_tex_width = 1.0f / font->texture()->width;
     float inv_tex_height = 1.0f / font->texture()->height;
     float size_scale = font->GetSizeScale(owner_->font_size_);
@@ -301,11 +291,8 @@ class AtlasTxtMeshConstructor : public TxtMeshConstructor
     owner_->render_data_.vertex_count = (now_len_ - invisible_num) * unit_vertex_num;
     owner_->render_data_.vertex_type = GL_TRIANGLES;
     
-    glBindBuffer(GL_ARRAY_BUFFER, owner_->render_data_.vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER,
-                 owner_->render_data_.vertex_count * sizeof(vertex_2_pos_tex),
-                 vertices_,
-                 GL_DYNAMIC_DRAW);
+    owner_->UpdateDynamicVertex(vertices_,
+                                owner_->render_data_.vertex_count * sizeof(vertex_2_pos_tex));
   }
   
  private:
@@ -360,7 +347,7 @@ void TxtActor::SetIsUtf8(bool is_utf8)
   data_.is_utf8 = is_utf8;
   
   if (!data_.str.empty())
-    mesh_constructor_->Construct();
+    ConstructMesh();
 }
 
 void TxtActor::SetIsAntiAlias(bool is_anti_alias)
@@ -371,7 +358,7 @@ void TxtActor::SetIsAntiAlias(bool is_anti_alias)
   data_.is_anti_alias = is_anti_alias;
   
   if (!data_.str.empty())
-    mesh_constructor_->Construct();
+    ConstructMesh();
 }
 
 void TxtActor::SetResolutionScale(float resolution_scale)
@@ -382,7 +369,7 @@ void TxtActor::SetResolutionScale(float resolution_scale)
   resolution_scale_ = resolution_scale;
   
   if (!data_.str.empty())
-    mesh_constructor_->Construct();
+    ConstructMesh();
 }
 
 void TxtActor::SetMaxWidth(float max_width, LineBreakMode line_break /*= LB_DEFAULT*/)
@@ -396,14 +383,14 @@ void TxtActor::SetMaxWidth(float max_width, LineBreakMode line_break /*= LB_DEFA
   data_.line_break = line_break;
   
   if (!data_.str.empty())
-    mesh_constructor_->Construct();
+    ConstructMesh();
 }
 
 void TxtActor::SetTxt(const std::string& txt)
 {
   data_.str = txt;
   
-  mesh_constructor_->Construct();
+  ConstructMesh();
 }
   
 void TxtActor::SetForceLineHeight(float force_line_height, bool construct /*= false*/)
@@ -416,7 +403,17 @@ void TxtActor::SetForceLineHeight(float force_line_height, bool construct /*= fa
   force_line_height_ = force_line_height;
   
   if (construct)
-    mesh_constructor_->Construct();
+    ConstructMesh();
+}
+
+void TxtActor::ConstructMesh()
+{
+  // area before and after rebuild
+  if (layer_) layer_->SetActorDirty(this);
+  
+  mesh_constructor_->Construct();
+  
+  if (layer_) layer_->SetActorDirty(this);
 }
 
 bool TxtActor::IsInArea(const Vector3& local_space_pos)
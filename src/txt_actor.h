@@ -45,6 +45,8 @@ class TxtActor : public SceneActor
   inline const Font* font() const { return font_ref_; }
 
  private:
+  void ConstructMesh();
+  
   virtual bool IsInArea(const Vector3& local_space_pos);
   
   const Font* font_ref_;
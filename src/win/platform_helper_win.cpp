@@ -27,6 +27,11 @@ namespace ERI
 		return path;
 	}
 
+	std::string GetWritePath()
+	{
+		return GetHomePath();
+	}
+
 	int GetUnicodeFromUTF8(const std::string& str, int max_buff_length, uint32_t* buff)
 	{
 		// TODO: implement ...
@@ -0,0 +1,161 @@
+//
+//  worker_pool.cpp
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#include "pch.h"
+
+#include "worker_pool.h"
+
+namespace ERI
+{
+#ifdef ERI_USE_THREAD
+
+	WorkerPool::WorkerPool(int worker_num) :
+		func_(NULL),
+		data_(NULL),
+		count_(0),
+		chunk_size_(0),
+		chunk_num_(0),
+		next_chunk_(0),
+		done_chunk_(0),
+		generation_(0),
+		is_quit_(false)
+	{
+		for (int i = 0; i < worker_num; ++i)
+		{
+			Thread* thread = new Thread;
+			if (!thread->Start(WorkerMain, this))
+			{
+				delete thread;
+				LOGW("WorkerPool create thread failed, %d workers only", i);
+				break;
+			}
+
+			threads_.push_back(thread);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		mutex_.Lock();
+		is_quit_ = true;
+		work_cond_.NotifyAll();
+		mutex_.Unlock();
+
+		size_t num = threads_.size();
+		for (size_t i = 0; i < num; ++i)
+		{
+			threads_[i]->Join();
+			delete threads_[i];
+		}
+	}
+
+	void WorkerPool::ParallelFor(int count, int chunk_size, JobFunc func, void* data)
+	{
+		ASSERT(func && chunk_size > 0);
+
+		if (count <= 0)
+			return;
+
+		if (threads_.empty() || count <= chunk_size)
+		{
+			func(data, 0, count);
+			return;
+		}
+
+		mutex_.Lock();
+
+		func_ = func;
+		data_ = data;
+		count_ = count;
+		chunk_size_ = chunk_size;
+		chunk_num_ = (count + chunk_size - 1) / chunk_size;
+		next_chunk_ = 0;
+		done_chunk_ = 0;
+		++generation_;
+
+		work_cond_.NotifyAll();
+
+		RunChunks();
+
+		while (done_chunk_ < chunk_num_)
+			done_cond_.Wait(mutex_);
+
+		func_ = NULL;
+		data_ = NULL;
+
+		mutex_.Unlock();
+	}
+
+	void WorkerPool::WorkerMain(void* data)
+	{
+		WorkerPool* pool = static_cast<WorkerPool*>(data);
+
+		unsigned int generation = 0;
+
+		pool->mutex_.Lock();
+
+		while (true)
+		{
+			while (!pool->is_quit_ && generation == pool->generation_)
+				pool->work_cond_.Wait(pool->mutex_);
+
+			if (pool->is_quit_)
+				break;
+
+			generation = pool->generation_;
+
+			pool->RunChunks();
+		}
+
+		pool->mutex_.Unlock();
+	}
+
+	void WorkerPool::RunChunks()
+	{
+		// called with lock held, job itself runs unlocked
+
+		while (next_chunk_ < chunk_num_)
+		{
+			int begin = next_chunk_ * chunk_size_;
+			int end = begin + chunk_size_;
+			if (end > count_) end = count_;
+
+			++next_chunk_;
+
+			JobFunc func = func_;
+			void* data = data_;
+
+			mutex_.Unlock();
+			func(data, begin, end);
+			mutex_.Lock();
+
+			if (++done_chunk_ == chunk_num_)
+				done_cond_.NotifyAll();
+		}
+	}
+
+#else // ERI_USE_THREAD
+
+	WorkerPool::WorkerPool(int worker_num)
+	{
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+	}
+
+	void WorkerPool::ParallelFor(int count, int chunk_size, JobFunc func, void* data)
+	{
+		ASSERT(func && chunk_size > 0);
+
+		if (count > 0)
+			func(data, 0, count);
+	}
+
+#endif // ERI_USE_THREAD
+}
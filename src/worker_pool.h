@@ -0,0 +1,64 @@
+//
+//  worker_pool.h
+//  eri
+//
+//  Created by exe on 10/17/26.
+//
+//
+
+#ifndef ERI_WORKER_POOL_H
+#define ERI_WORKER_POOL_H
+
+#include "pch.h"
+
+#include <vector>
+
+#include "thread_helper.h"
+
+namespace ERI
+{
+	// Fixed worker threads for data parallel jobs.
+	// ParallelFor splits range into chunks which are taken by workers and calling thread,
+	// and returns after all chunks are done. Without thread support it runs inline.
+
+	class WorkerPool
+	{
+	public:
+		typedef void (*JobFunc)(void* data, int begin, int end);
+
+		WorkerPool(int worker_num);
+		~WorkerPool();
+
+		void ParallelFor(int count, int chunk_size, JobFunc func, void* data);
+
+		inline int worker_num() { return static_cast<int>(threads_.size()); }
+
+	private:
+#ifdef ERI_USE_THREAD
+		static void WorkerMain(void* data);
+
+		void RunChunks();
+
+		std::vector<Thread*>	threads_;
+
+		Mutex		mutex_;
+		Condition	work_cond_;
+		Condition	done_cond_;
+
+		JobFunc		func_;
+		void*		data_;
+		int			count_;
+		int			chunk_size_;
+		int			chunk_num_;
+		int			next_chunk_;
+		int			done_chunk_;
+
+		unsigned int	generation_;
+		bool			is_quit_;
+#else
+		std::vector<int>	threads_;
+#endif
+	};
+}
+
+#endif // ERI_WORKER_POOL_H